@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <fmt/format.h>
+#include "common.hh"
+#include "file_io.hh"
+#include "accuraterip.hh"
+
+
+
+namespace gpsxre
+{
+
+static std::pair<uint32_t, uint32_t> accuraterip_range(uint32_t samples_count, bool first, bool last)
+{
+	uint32_t range_start = first ? ACCURATERIP_SKIP_SAMPLES - 1 : 0;
+	uint32_t range_end = last ? (samples_count > ACCURATERIP_SKIP_SAMPLES ? samples_count - ACCURATERIP_SKIP_SAMPLES : 0) : samples_count;
+
+	return std::pair(range_start, std::max(range_start, range_end));
+}
+
+
+uint32_t accuraterip_v1(const uint32_t *samples, uint32_t samples_count, bool first, bool last)
+{
+	auto range = accuraterip_range(samples_count, first, last);
+
+	uint32_t crc = 0;
+	for(uint32_t i = range.first; i < range.second; ++i)
+		crc += samples[i] * (i + 1);
+
+	return crc;
+}
+
+
+uint32_t accuraterip_v2(const uint32_t *samples, uint32_t samples_count, bool first, bool last)
+{
+	auto range = accuraterip_range(samples_count, first, last);
+
+	uint32_t crc = 0;
+	for(uint32_t i = range.first; i < range.second; ++i)
+	{
+		uint64_t product = (uint64_t)samples[i] * (i + 1);
+		crc += (uint32_t)product + (uint32_t)(product >> 32);
+	}
+
+	return crc;
+}
+
+
+// C(o) = sum((i + 1) * s[i + o]), T(o) = sum(s[i + o]), i in [range_start .. range_end)
+// C(o + 1) = C(o) - T(o) - range_start * s[range_start + o] + range_end * s[range_end + o]
+// T(o + 1) = T(o) - s[range_start + o] + s[range_end + o]
+std::vector<uint32_t> accuraterip_v1_sweep(const uint32_t *samples, uint32_t samples_count, bool first, bool last, uint32_t offset_range)
+{
+	auto range = accuraterip_range(samples_count, first, last);
+
+	std::vector<uint32_t> crcs(2 * offset_range + 1);
+
+	const uint32_t *s = samples - offset_range;
+	uint32_t crc = 0;
+	uint32_t total = 0;
+	for(uint32_t i = range.first; i < range.second; ++i)
+	{
+		crc += s[i] * (i + 1);
+		total += s[i];
+	}
+
+	for(uint32_t o = 0; o < crcs.size(); ++o)
+	{
+		crcs[o] = crc;
+
+		if(o + 1 == crcs.size())
+			break;
+
+		uint32_t sample_out = s[range.first + o];
+		uint32_t sample_in = s[range.second + o];
+		crc = crc - total - range.first * sample_out + range.second * sample_in;
+		total = total - sample_out + sample_in;
+	}
+
+	return crcs;
+}
+
+
+void accuraterip_disc_id(uint32_t &id1, uint32_t &id2, uint32_t &cddb_id, const std::vector<int32_t> &track_offsets)
+{
+	id1 = 0;
+	id2 = 0;
+	cddb_id = 0;
+
+	if(track_offsets.size() < 2)
+		return;
+
+	uint32_t n = 0;
+	for(uint32_t i = 0; i < track_offsets.size(); ++i)
+	{
+		id1 += track_offsets[i];
+		id2 += std::max(track_offsets[i], 1) * (i + 1);
+
+		// lead-out doesn't participate in CDDB digit sum
+		if(i + 1 < track_offsets.size())
+		{
+			for(uint32_t seconds = (track_offsets[i] - MSF_LBA_SHIFT) / 75; seconds; seconds /= 10)
+				n += seconds % 10;
+		}
+	}
+
+	uint32_t tracks_count = (uint32_t)track_offsets.size() - 1;
+	uint32_t length = (track_offsets.back() - MSF_LBA_SHIFT) / 75 - (track_offsets.front() - MSF_LBA_SHIFT) / 75;
+	cddb_id = (n % 0xFF) << 24 | length << 8 | tracks_count;
+}
+
+
+std::vector<AccurateRipEntry> accuraterip_load(const std::filesystem::path &db_path)
+{
+	std::vector<AccurateRipEntry> entries;
+
+	std::vector<uint8_t> db = read_vector(db_path);
+
+	auto read_u32 = [&db](uint32_t offset) { return (uint32_t)db[offset] | (uint32_t)db[offset + 1] << 8 | (uint32_t)db[offset + 2] << 16 | (uint32_t)db[offset + 3] << 24; };
+
+	constexpr uint32_t HEADER_SIZE = 13;
+	constexpr uint32_t TRACK_SIZE = 9;
+	for(uint32_t offset = 0; offset + HEADER_SIZE <= db.size();)
+	{
+		AccurateRipEntry &e = entries.emplace_back();
+
+		uint8_t tracks_count = db[offset];
+		e.id1 = read_u32(offset + 1);
+		e.id2 = read_u32(offset + 5);
+		e.cddb_id = read_u32(offset + 9);
+		offset += HEADER_SIZE;
+
+		if(offset + tracks_count * TRACK_SIZE > db.size())
+			throw_line(fmt::format("unexpected end of AccurateRip database file ({})", db_path.filename().string()));
+
+		for(uint8_t i = 0; i < tracks_count; ++i)
+		{
+			e.tracks.push_back(AccurateRipEntry::Track{db[offset], read_u32(offset + 1), read_u32(offset + 5)});
+			offset += TRACK_SIZE;
+		}
+	}
+
+	return entries;
+}
+
+}
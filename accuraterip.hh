@@ -0,0 +1,48 @@
+#pragma once
+
+
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include "cd.hh"
+
+
+
+namespace gpsxre
+{
+
+// first and last disc tracks skip 5 sectors worth of samples to tolerate drive offsets
+constexpr uint32_t ACCURATERIP_SKIP_SAMPLES = 5 * CD_DATA_SIZE_SAMPLES;
+
+struct AccurateRipEntry
+{
+	uint32_t id1;
+	uint32_t id2;
+	uint32_t cddb_id;
+
+	struct Track
+	{
+		uint8_t confidence;
+		uint32_t crc;
+		uint32_t crc450;
+	};
+	std::vector<Track> tracks;
+};
+
+// samples are 32-bit stereo samples (left channel is the low word)
+uint32_t accuraterip_v1(const uint32_t *samples, uint32_t samples_count, bool first, bool last);
+uint32_t accuraterip_v2(const uint32_t *samples, uint32_t samples_count, bool first, bool last);
+
+// v1 checksum for every offset in [-offset_range .. +offset_range], element 0 is -offset_range
+// samples points to the track start and has to be readable in [-offset_range .. samples_count + offset_range)
+// running sums make the cost O(samples + offsets)
+std::vector<uint32_t> accuraterip_v1_sweep(const uint32_t *samples, uint32_t samples_count, bool first, bool last, uint32_t offset_range);
+
+// track_offsets: LBA of every audio track start followed by lead-out LBA
+void accuraterip_disc_id(uint32_t &id1, uint32_t &id2, uint32_t &cddb_id, const std::vector<int32_t> &track_offsets);
+
+// dBAR-ttt-xxxxxxxx-xxxxxxxx-xxxxxxxx.bin response file
+std::vector<AccurateRipEntry> accuraterip_load(const std::filesystem::path &db_path);
+
+}
@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "common.hh"
+#include "file_io.hh"
+#include "logger.hh"
+#include "protection.hh"
+#include "redumper.hh"
+#include "signal.hh"
+#include "split.hh"
+#include "thread_pool.hh"
+#include "batch.hh"
+
+
+
+namespace gpsxre
+{
+
+enum class BatchStatus
+{
+	SUCCESS,
+	FAILED,
+	RESUMED,
+	INTERRUPTED
+};
+
+
+static const std::map<BatchStatus, std::string> BATCH_STATUS_STRING =
+{
+	{BatchStatus::SUCCESS, "SUCCESS"},
+	{BatchStatus::FAILED, "FAILED"},
+	{BatchStatus::RESUMED, "RESUMED"},
+	{BatchStatus::INTERRUPTED, "INTERRUPTED"}
+};
+
+
+struct BatchJob
+{
+	std::string image_prefix;
+	BatchStatus status;
+	std::vector<std::pair<std::string, double>> durations;
+	double duration;
+	std::string error;
+};
+
+
+static std::vector<std::string> batch_images(const std::filesystem::path &input)
+{
+	std::vector<std::string> images;
+
+	if(std::filesystem::is_directory(input))
+	{
+		for(auto const &e : std::filesystem::recursive_directory_iterator(input))
+			if(e.is_regular_file() && e.path().extension() == ".scram")
+				images.push_back((e.path().parent_path() / e.path().stem()).string());
+
+		std::sort(images.begin(), images.end());
+	}
+	else
+	{
+		std::ifstream ifs(input);
+		if(!ifs.is_open())
+			throw_line(fmt::format("unable to open file ({})", input.filename().string()));
+
+		std::set<std::string> unique;
+		std::string line;
+		while(std::getline(ifs, line))
+		{
+			line.erase(0, line.find_first_not_of(" \t"));
+			line.erase(line.find_last_not_of(" \t\r") + 1);
+			if(line.empty() || line[0] == '#')
+				continue;
+
+			std::string extension(".scram");
+			if(line.length() > extension.length() && !line.compare(line.length() - extension.length(), extension.length(), extension))
+				line.erase(line.length() - extension.length());
+
+			if(unique.insert(line).second)
+				images.push_back(line);
+		}
+	}
+
+	return images;
+}
+
+
+// journal line: status, seconds, image prefix (tab separated), only successful jobs are skipped on resume
+static std::set<std::string> batch_journal_load(const std::filesystem::path &journal_path)
+{
+	std::set<std::string> completed;
+
+	std::ifstream ifs(journal_path);
+	std::string line;
+	while(std::getline(ifs, line))
+	{
+		auto tokens = tokenize(line, "\t", nullptr);
+		// incomplete trailing line after a hard kill is ignored
+		if(tokens.size() == 3 && tokens[0] == enum_to_string(BatchStatus::SUCCESS, BATCH_STATUS_STRING))
+			completed.insert(tokens[2]);
+	}
+
+	return completed;
+}
+
+
+static void batch_job_run(BatchJob &job, const Options &options, const std::list<std::string> &modes, ThreadPool &analysis_pool)
+{
+	auto job_start = std::chrono::steady_clock::now();
+
+	Options job_options(options);
+	std::filesystem::path image_prefix(job.image_prefix);
+	job_options.image_path = image_prefix.parent_path().string();
+	job_options.image_name = image_prefix.filename().string();
+	job_options.positional = modes;
+
+	try
+	{
+		LogRedirect log_redirect(job.image_prefix + ".log");
+
+		LOG("{}\n", redumper_version());
+		LOG("command: {}\n", options.command);
+
+		try
+		{
+			for(auto const &m : modes)
+			{
+				LOG("*** MODE: {}", m);
+
+				auto start = std::chrono::steady_clock::now();
+
+				if(m == "protection")
+					redumper_protection(job_options);
+				else if(m == "split")
+					redumper_split(job_options);
+				else if(m == "info")
+					redumper_info(job_options, &analysis_pool);
+
+				job.durations.emplace_back(m, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			}
+		}
+		catch(const std::exception &e)
+		{
+			LOG("error: {}", e.what());
+			throw;
+		}
+
+		job.status = BatchStatus::SUCCESS;
+	}
+	catch(const std::exception &e)
+	{
+		job.status = BatchStatus::FAILED;
+		job.error = e.what();
+	}
+	catch(...)
+	{
+		job.status = BatchStatus::FAILED;
+		job.error = "unhandled exception";
+	}
+
+	job.duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - job_start).count();
+}
+
+
+void redumper_batch(const Options &options)
+{
+	if(options.batch_input.empty())
+		throw_line("batch input is not provided");
+
+	std::list<std::string> modes;
+	for(auto const &m : tokenize(options.batch_modes, ",", nullptr))
+	{
+		if(m != "protection" && m != "split" && m != "info")
+			throw_line(fmt::format("unsupported batch mode ({})", m));
+		modes.push_back(m);
+	}
+	if(modes.empty())
+		throw_line("no batch modes provided");
+
+	auto images = batch_images(options.batch_input);
+
+	std::filesystem::path journal_path((std::filesystem::path(options.image_path) / options.image_name).string() + ".journal");
+	auto completed = batch_journal_load(journal_path);
+
+	std::vector<BatchJob> jobs(images.size());
+	uint32_t pending = 0;
+	for(uint32_t i = 0; i < images.size(); ++i)
+	{
+		jobs[i].image_prefix = images[i];
+		jobs[i].duration = 0;
+		if(completed.find(images[i]) == completed.end())
+		{
+			jobs[i].status = BatchStatus::INTERRUPTED;
+			++pending;
+		}
+		else
+			jobs[i].status = BatchStatus::RESUMED;
+	}
+
+	std::ofstream journal(journal_path, std::ofstream::app);
+	if(!journal.is_open())
+		throw_line(fmt::format("unable to open file ({})", journal_path.filename().string()));
+
+	// process wide limit, reset on any exit
+	IOLimit io_limit(options.batch_io_jobs);
+
+	// info analyzers of all jobs share one pool, job workers only wait on it
+	ThreadPool analysis_pool;
+	ThreadPool pool(options.batch_jobs);
+
+	LOG("batch input: {}", options.batch_input);
+	LOG("batch modes: {}", options.batch_modes);
+	LOG("jobs: {} (resumed: {}), workers: {}, analysis workers: {}, I/O limit: {}", jobs.size(), jobs.size() - pending, pool.ThreadsCount(), analysis_pool.ThreadsCount(),
+		options.batch_io_jobs ? std::to_string(options.batch_io_jobs) : "unlimited");
+	LOG("");
+
+	auto batch_start = std::chrono::steady_clock::now();
+
+	// on interrupt, running jobs are finished and the rest is left for the next run
+	Signal::GetInstance().Engage();
+
+	std::mutex journal_mutex;
+	std::atomic<uint32_t> finished(0);
+	std::vector<std::future<void>> futures;
+	for(auto &j : jobs)
+	{
+		if(j.status == BatchStatus::RESUMED)
+			continue;
+
+		futures.push_back(pool.Enqueue([&j, &options, &modes, &analysis_pool, &journal, &journal_mutex, &finished, pending]()
+		{
+			if(Signal::GetInstance().Interrupt())
+				return;
+
+			batch_job_run(j, options, modes, analysis_pool);
+
+			auto status = enum_to_string(j.status, BATCH_STATUS_STRING);
+			{
+				std::lock_guard<std::mutex> lock(journal_mutex);
+				journal << fmt::format("{}\t{:.3f}\t{}", status, j.duration, j.image_prefix) << std::endl;
+			}
+
+			LOG("[{:{}}/{}] {}: {} ({:.1f}s){}", ++finished, std::to_string(pending).length(), pending, status, j.image_prefix, j.duration,
+				j.error.empty() ? "" : fmt::format(", {}", j.error));
+		}));
+	}
+	for(auto &f : futures)
+		f.get();
+
+	bool interrupted = Signal::GetInstance().Interrupt();
+	Signal::GetInstance().Disengage();
+
+	double batch_duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+
+	std::map<BatchStatus, uint32_t> counts;
+	LOG("");
+	LOG("batch summary:");
+	for(auto const &j : jobs)
+	{
+		++counts[j.status];
+
+		std::string timing;
+		for(auto const &d : j.durations)
+			timing += fmt::format("{}{}: {:.1f}s", timing.empty() ? "" : ", ", d.first, d.second);
+
+		LOG("  {:<11} {:>8.1f}s  {}{}{}", enum_to_string(j.status, BATCH_STATUS_STRING), j.duration, j.image_prefix,
+			timing.empty() ? "" : fmt::format(" ({})", timing), j.error.empty() ? "" : fmt::format(" [{}]", j.error));
+	}
+	LOG("total: {}, success: {}, failed: {}, resumed: {}, interrupted: {}, time: {:.1f}s", jobs.size(), counts[BatchStatus::SUCCESS],
+		counts[BatchStatus::FAILED], counts[BatchStatus::RESUMED], counts[BatchStatus::INTERRUPTED], batch_duration);
+
+	if(interrupted)
+		throw_line("batch interrupted, rerun with the same options to resume");
+	if(counts[BatchStatus::FAILED])
+		throw_line(fmt::format("batch finished with failed jobs (failed: {})", counts[BatchStatus::FAILED]));
+}
+
+}
@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cd.hh"
+#include "common.hh"
+#include "crc16_gsm.hh"
+#include "crc32.hh"
+#include "ecc_edc.hh"
+#include "endian.hh"
+#include "file_io.hh"
+#include "md5.hh"
+#include "scrambler.hh"
+#include "sector_state.hh"
+#include "sha1.hh"
+#include "subcode.hh"
+
+
+
+using namespace gpsxre;
+
+
+
+// result accumulator, keeps the compiler from discarding benchmarked work
+static volatile uint64_t g_sink = 0;
+
+
+struct Benchmark
+{
+	std::string name;
+	// bytes processed per operation, 0 if throughput doesn't make sense
+	uint64_t bytes;
+	std::function<uint64_t()> func;
+};
+
+
+struct BenchmarkResult
+{
+	std::string name;
+	uint64_t bytes;
+	uint64_t iterations;
+	double ns_per_op;
+	double mb_per_s;
+};
+
+
+class Random
+{
+public:
+	Random(uint32_t seed)
+		: _seed(seed)
+	{
+		;
+	}
+
+	uint32_t operator()()
+	{
+		_seed = _seed * 1103515245 + 12345;
+		return _seed >> 8;
+	}
+
+private:
+	uint32_t _seed;
+};
+
+
+// valid scrambled mode 1 sector with random user data
+static std::vector<uint8_t> generate_data_sector(int32_t lba, Random &random)
+{
+	std::vector<uint8_t> data(CD_DATA_SIZE);
+	auto &sector = *(Sector *)data.data();
+
+	memcpy(sector.sync, CD_DATA_SYNC, sizeof(CD_DATA_SYNC));
+	sector.header.address = LBA_to_BCDMSF(lba);
+	sector.header.mode = 1;
+	for(auto &b : sector.mode1.user_data)
+		b = (uint8_t)random();
+	sector.mode1.edc = EDC().ComputeBlock(0, data.data(), offsetof(Sector, mode1.edc));
+	memset(sector.mode1.intermediate, 0, sizeof(sector.mode1.intermediate));
+	sector.mode1.ecc = ECC().Generate(sector, false);
+
+	Scrambler().Process(data.data(), data.data());
+
+	return data;
+}
+
+
+static ChannelQ generate_q(int32_t lba)
+{
+	ChannelQ Q;
+	memset(&Q, 0, sizeof(Q));
+
+	Q.control_adr = (uint8_t)ChannelQ::Control::DATA << 4 | 1;
+	Q.mode1.tno = 1;
+	Q.mode1.index = 1;
+	Q.mode1.msf = LBA_to_BCDMSF(lba);
+	Q.mode1.a_msf = LBA_to_BCDMSF(lba - MSF_LBA_SHIFT);
+	Q.crc = endian_swap(crc16_gsm(Q.raw, sizeof(Q.raw)));
+
+	return Q;
+}
+
+
+// interleaved P-W subcode with the given Q and pause P
+static std::vector<uint8_t> generate_subcode(const ChannelQ &Q)
+{
+	std::vector<uint8_t> subcode(CD_SUBCODE_SIZE);
+
+	auto q = (const uint8_t *)&Q;
+	for(uint32_t i = 0; i < CD_SUBCODE_SIZE; ++i)
+		subcode[i] = (q[i / CHAR_BIT] >> (CHAR_BIT - 1 - i % CHAR_BIT) & 1) << (uint8_t)Subchannel::Q;
+
+	return subcode;
+}
+
+
+static BenchmarkResult run_benchmark(const Benchmark &benchmark, std::chrono::nanoseconds batch_time, uint32_t batches_count)
+{
+	using clock = std::chrono::steady_clock;
+
+	// warm up caches and lookup tables
+	g_sink = g_sink + benchmark.func();
+
+	// calibrate iterations count so that one batch takes at least batch_time
+	uint64_t iterations = 1;
+	for(;;)
+	{
+		auto start = clock::now();
+		for(uint64_t i = 0; i < iterations; ++i)
+			g_sink = g_sink + benchmark.func();
+		if(clock::now() - start >= batch_time || iterations >= (1ULL << 32))
+			break;
+		iterations *= 2;
+	}
+
+	// median of batches is robust against scheduling noise
+	std::vector<double> batches;
+	for(uint32_t b = 0; b < batches_count; ++b)
+	{
+		auto start = clock::now();
+		for(uint64_t i = 0; i < iterations; ++i)
+			g_sink = g_sink + benchmark.func();
+		batches.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / iterations);
+	}
+	std::sort(batches.begin(), batches.end());
+
+	BenchmarkResult result;
+	result.name = benchmark.name;
+	result.bytes = benchmark.bytes;
+	result.iterations = iterations;
+	result.ns_per_op = batches[batches.size() / 2];
+	result.mb_per_s = benchmark.bytes ? benchmark.bytes / result.ns_per_op * 1000000000. / (1024 * 1024) : 0.;
+
+	return result;
+}
+
+
+static std::string results_json(const std::vector<BenchmarkResult> &results)
+{
+	std::string json = "{\n";
+	json += fmt::format("\t\"version\": \"{}.{}.{} build_{}\",\n", XSTRINGIFY(REDUMPER_VERSION_MAJOR), XSTRINGIFY(REDUMPER_VERSION_MINOR), XSTRINGIFY(REDUMPER_VERSION_PATCH),
+		XSTRINGIFY(REDUMPER_VERSION_BUILD));
+	json += "\t\"benchmarks\": [\n";
+	for(uint32_t i = 0; i < results.size(); ++i)
+	{
+		auto const &r = results[i];
+		json += fmt::format("\t\t{{ \"name\": \"{}\", \"bytes_per_op\": {}, \"iterations\": {}, \"ns_per_op\": {:.3f}, \"mb_per_s\": {:.3f} }}{}\n", r.name, r.bytes, r.iterations, r.ns_per_op,
+			r.mb_per_s, i + 1 < results.size() ? "," : "");
+	}
+	json += "\t]\n}\n";
+
+	return json;
+}
+
+
+int main(int argc, char *argv[])
+{
+	std::string json_path;
+	std::string filter;
+	uint32_t batch_ms = 50;
+	uint32_t batches_count = 7;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if(arg.rfind("--json=", 0) == 0)
+			json_path = arg.substr(7);
+		else if(arg.rfind("--filter=", 0) == 0)
+			filter = arg.substr(9);
+		else if(arg.rfind("--batch-ms=", 0) == 0)
+			batch_ms = std::stoul(arg.substr(11));
+		else if(arg.rfind("--batches=", 0) == 0)
+			batches_count = std::max(1UL, std::stoul(arg.substr(10)));
+		else
+		{
+			std::cout << "usage: benchmarks [--json=<path>] [--filter=<substring>] [--batch-ms=<ms>] [--batches=<count>]" << std::endl;
+			return 1;
+		}
+	}
+
+	// synthetic data, fixed seed so that every run processes the same input
+	Random random(0x5EC7043);
+
+	constexpr uint32_t sectors_count = 1024;
+	constexpr int32_t lba_base = 1000;
+
+	std::vector<uint8_t> scrambled;
+	for(uint32_t i = 0; i < sectors_count; ++i)
+	{
+		auto sector = generate_data_sector(lba_base + i, random);
+		scrambled.insert(scrambled.end(), sector.begin(), sector.end());
+	}
+	std::vector<uint8_t> descrambled(scrambled);
+	Scrambler scrambler;
+	for(uint32_t i = 0; i < sectors_count; ++i)
+		scrambler.Process(&descrambled[i * CD_DATA_SIZE], &descrambled[i * CD_DATA_SIZE]);
+
+	// sparse C2 errors, typical of a slightly damaged disc
+	std::vector<uint8_t> c2(CD_C2_SIZE);
+	for(auto &c : c2)
+		c = random() % 64 ? 0 : (uint8_t)(1 << random() % 8);
+
+	// program area Q with 1% damaged entries
+	std::vector<ChannelQ> subq(10000);
+	for(uint32_t i = 0; i < subq.size(); ++i)
+	{
+		subq[i] = generate_q(lba_base + i);
+		if(random() % 100 == 0)
+			subq[i].raw[random() % sizeof(subq[i].raw)] ^= 1 << random() % 8;
+	}
+	auto subcode = generate_subcode(subq.front());
+
+	// file backed scram for read_entry
+	auto scram_path = std::filesystem::temp_directory_path() / fmt::format("redumper_benchmarks_{}.scram", (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count());
+	{
+		std::ofstream ofs(scram_path, std::ofstream::binary);
+		ofs.write((const char *)scrambled.data(), scrambled.size());
+	}
+	std::fstream scram_fs(scram_path, std::fstream::in | std::fstream::binary);
+
+	std::vector<uint8_t> sector(CD_DATA_SIZE);
+	std::vector<State> state(CD_DATA_SIZE_SAMPLES);
+	std::vector<ChannelQ> subq_work(subq.size());
+	std::vector<uint8_t> subchannel(CD_SUBCODE_SIZE / CHAR_BIT);
+	ECC ecc;
+	EDC edc;
+	uint32_t index = 0;
+
+	std::vector<Benchmark> benchmarks = {
+		{ "Scrambler::Process", CD_DATA_SIZE,
+			[&]()
+			{
+				scrambler.Process(sector.data(), &scrambled[index++ % sectors_count * CD_DATA_SIZE]);
+				return sector[100];
+			} },
+		{ "Scrambler::Descramble", CD_DATA_SIZE,
+			[&]()
+			{
+				memcpy(sector.data(), &scrambled[index++ % sectors_count * CD_DATA_SIZE], CD_DATA_SIZE);
+				return (uint64_t)scrambler.Descramble(sector.data(), nullptr);
+			} },
+		{ "ECC::Generate", CD_DATA_SIZE,
+			[&]()
+			{
+				auto &s = *(Sector *)&descrambled[index++ % sectors_count * CD_DATA_SIZE];
+				return (uint64_t)ecc.Generate(s, false).q_parity[0];
+			} },
+		{ "EDC::ComputeBlock", offsetof(Sector, mode1.edc),
+			[&]() { return (uint64_t)edc.ComputeBlock(0, &descrambled[index++ % sectors_count * CD_DATA_SIZE], offsetof(Sector, mode1.edc)); } },
+		{ "crc32", CD_DATA_SIZE, [&]() { return (uint64_t)crc32(&descrambled[index++ % sectors_count * CD_DATA_SIZE], CD_DATA_SIZE); } },
+		{ "crc16_gsm", sizeof(ChannelQ::raw),
+			[&]()
+			{
+				auto &Q = subq[index++ % subq.size()];
+				return (uint64_t)crc16_gsm(Q.raw, sizeof(Q.raw));
+			} },
+		{ "MD5", descrambled.size(),
+			[&]()
+			{
+				MD5 md5;
+				md5.Update(descrambled.data(), descrambled.size());
+				return (uint64_t)md5.Final()[0];
+			} },
+		{ "SHA1", descrambled.size(),
+			[&]()
+			{
+				SHA1 sha1;
+				sha1.Update(descrambled.data(), descrambled.size());
+				return (uint64_t)sha1.Final()[0];
+			} },
+		{ "subcode_extract_channel", CD_SUBCODE_SIZE,
+			[&]()
+			{
+				subcode_extract_channel(subchannel.data(), subcode.data(), Subchannel::Q);
+				return (uint64_t)subchannel[0];
+			} },
+		{ "state_from_c2", CD_C2_SIZE,
+			[&]()
+			{
+				std::fill(state.begin(), state.end(), State::SUCCESS);
+				return (uint64_t)state_from_c2(state, c2.data());
+			} },
+		{ "read_entry", CD_DATA_SIZE,
+			[&]()
+			{
+				read_entry(scram_fs, sector.data(), CD_DATA_SIZE, index++ % sectors_count, 1, 0, 0);
+				return sector[100];
+			} },
+		{ "correct_program_subq", subq.size() * sizeof(ChannelQ),
+			[&]()
+			{
+				subq_work = subq;
+				return (uint64_t)correct_program_subq(subq_work.data(), (uint32_t)subq_work.size());
+			} }
+	};
+
+	std::vector<BenchmarkResult> results;
+	for(auto const &b : benchmarks)
+	{
+		if(!filter.empty() && b.name.find(filter) == std::string::npos)
+			continue;
+
+		std::cout << fmt::format("{:<24}... ", b.name) << std::flush;
+		auto r = run_benchmark(b, std::chrono::milliseconds(batch_ms), batches_count);
+		std::cout << fmt::format("{:>12.1f} ns/op", r.ns_per_op);
+		if(r.bytes)
+			std::cout << fmt::format(", {:>9.1f} MB/s", r.mb_per_s);
+		std::cout << std::endl;
+
+		results.push_back(r);
+	}
+
+	scram_fs.close();
+	std::filesystem::remove(scram_path);
+
+	if(!json_path.empty())
+	{
+		std::ofstream ofs(json_path);
+		ofs << results_json(results);
+		if(ofs.fail())
+		{
+			std::cout << fmt::format("error: unable to write JSON ({})", json_path) << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include "hex_bin.hh"
+#include "profiler.hh"
 
 
 
@@ -26,6 +27,8 @@ public:
 
 	void Update(const uint8_t *data, uint64_t size)
 	{
+		PROFILE_SCOPE_BYTES("hash", size);
+
 		auto data_end = data + size;
 
 		if(!_tail.empty())
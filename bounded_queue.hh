@@ -0,0 +1,113 @@
+#pragma once
+
+
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include "common.hh"
+
+
+
+namespace gpsxre
+{
+
+// lock-free bounded multi-producer multi-consumer queue (D. Vyukov), every cell carries a sequence number
+// which tells whether it is ready to be written or read for the current lap
+template<typename T>
+class BoundedQueue
+{
+public:
+	// capacity has to be a power of 2
+	BoundedQueue(uint32_t capacity)
+		: _cells(std::make_unique<Cell[]>(capacity))
+		, _mask(capacity - 1)
+		, _enqueuePosition(0)
+		, _dequeuePosition(0)
+	{
+		if(capacity < 2 || (capacity & _mask))
+			throw_line(fmt::format("queue capacity is not a power of 2 ({})", capacity));
+
+		for(uint64_t i = 0; i < capacity; ++i)
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	BoundedQueue(BoundedQueue const &) = delete;
+	void operator=(BoundedQueue const &) = delete;
+
+	// returns false if queue is full
+	bool Push(T &&value)
+	{
+		Cell *cell;
+		uint64_t position = _enqueuePosition.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			cell = &_cells[position & _mask];
+			uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+			int64_t diff = (int64_t)sequence - (int64_t)position;
+			if(!diff)
+			{
+				if(_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if(diff < 0)
+				return false;
+			else
+				position = _enqueuePosition.load(std::memory_order_relaxed);
+		}
+
+		cell->value = std::move(value);
+		cell->sequence.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// returns false if queue is empty or the oldest element is still being written
+	bool Pop(T &value)
+	{
+		Cell *cell;
+		uint64_t position = _dequeuePosition.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			cell = &_cells[position & _mask];
+			uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+			int64_t diff = (int64_t)sequence - (int64_t)(position + 1);
+			if(!diff)
+			{
+				if(_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if(diff < 0)
+				return false;
+			else
+				position = _dequeuePosition.load(std::memory_order_relaxed);
+		}
+
+		value = std::move(cell->value);
+		cell->sequence.store(position + _mask + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	bool Empty() const
+	{
+		return _dequeuePosition.load(std::memory_order_acquire) == _enqueuePosition.load(std::memory_order_acquire);
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<uint64_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Cell[]> _cells;
+	uint64_t _mask;
+
+	// separate cache lines for producers and consumers
+	alignas(64) std::atomic<uint64_t> _enqueuePosition;
+	alignas(64) std::atomic<uint64_t> _dequeuePosition;
+};
+
+}
@@ -135,16 +135,6 @@ std::string ranges_to_string(const std::vector<std::pair<int32_t, int32_t>> &ran
 }
 
 
-const std::pair<int32_t, int32_t> *inside_range(int32_t lba, const std::vector<std::pair<int32_t, int32_t>> &ranges)
-{
-	for(auto const &r : ranges)
-		if(lba >= r.first && lba < r.second)
-			return &r;
-
-	return nullptr;
-}
-
-
 std::string system_date_time(std::string fmt)
 {
 	auto time_now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
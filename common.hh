@@ -11,6 +11,7 @@
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include "simd.hh"
 
 
 
@@ -92,11 +93,9 @@ void clean_write(T *dst, size_t dst_offset, size_t size, T data)
 template<typename T>
 bool is_zeroed(const T *data, uint64_t size)
 {
-	for(uint32_t i = 0; i < size; ++i)
-		if(data[i])
-			return false;
+	static_assert(std::is_integral_v<T>);
 
-	return true;
+	return simd_is_zeroed((const uint8_t *)data, size * sizeof(T));
 }
 
 template<typename T, class = typename std::enable_if_t<std::is_unsigned_v<T>>>
@@ -199,12 +198,9 @@ uint32_t bits_count(T value)
 template<typename T>
 uint64_t bit_diff(const T *data1, const T *data2, uint64_t count)
 {
-	uint64_t diff = 0;
+	static_assert(std::is_integral_v<T>);
 
-	for(uint64_t i = 0; i < count; ++i)
-		diff += bits_count(data1[i] ^ data2[i]);
-
-	return diff;
+	return simd_diff_bits_count((const uint8_t *)data1, (const uint8_t *)data2, count * sizeof(T));
 }
 
 template<typename T>
@@ -247,13 +243,7 @@ T string_to_enum(std::string value, const std::map<T, std::string> &dictionary)
 template<typename T>
 T diff_bytes_count(const uint8_t *data1, const uint8_t *data2, T size)
 {
-	T diff = 0;
-
-	for(T i = 0; i < size; ++i)
-		if(data1[i] != data2[i])
-			++diff;
-
-	return diff;
+	return (T)simd_diff_bytes_count(data1, data2, size);
 }
 
 template<typename T>
@@ -283,7 +273,6 @@ std::string str_uppercase(const std::string &str);
 void replace_all_occurences(std::string &str, const std::string &from, const std::string &to);
 std::vector<std::pair<int32_t, int32_t>> string_to_ranges(const std::string &str);
 std::string ranges_to_string(const std::vector<std::pair<int32_t, int32_t>> &ranges);
-const std::pair<int32_t, int32_t> *inside_range(int32_t lba, const std::vector<std::pair<int32_t, int32_t>> &ranges);
 std::string system_date_time(std::string fmt);
 std::string track_extract_basename(std::string str);
 
@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "cd.hh"
+#include "common.hh"
+#include "file_io.hh"
+#include "logger.hh"
+#include "redumper.hh"
+#include "split.hh"
+#include "toc.hh"
+#include "compare.hh"
+
+
+
+namespace gpsxre
+{
+
+struct CompareDump
+{
+	std::filesystem::path scra_path;
+	std::fstream scm_fs;
+	std::fstream state_fs;
+	uint32_t sectors_count;
+	// LBA ranges searched for data sync, [first .. second)
+	std::vector<std::pair<int32_t, int32_t>> data_ranges;
+};
+
+
+struct CompareRange
+{
+	uint64_t start;
+	uint64_t end;
+	uint64_t samples;
+};
+
+
+static void compare_dump_open(CompareDump &dump, const std::string &image_prefix)
+{
+	std::filesystem::path scm_path(image_prefix + ".scram");
+	std::filesystem::path scp_path(image_prefix + ".scrap");
+	std::filesystem::path state_path(image_prefix + ".state");
+
+	dump.scra_path = !std::filesystem::exists(scm_path) && std::filesystem::exists(scp_path) ? scp_path : scm_path;
+	dump.sectors_count = check_file(state_path, CD_DATA_SIZE_SAMPLES);
+
+	dump.scm_fs.open(dump.scra_path, std::fstream::in | std::fstream::binary);
+	if(!dump.scm_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", dump.scra_path.filename().string()));
+
+	dump.state_fs.open(state_path, std::fstream::in | std::fstream::binary);
+	if(!dump.state_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", state_path.filename().string()));
+
+	// without TOC the whole dump is searched
+	int32_t lba_end = LBA_START + (int32_t)dump.sectors_count;
+	std::filesystem::path toc_path(image_prefix + ".toc");
+	if(!std::filesystem::exists(toc_path))
+	{
+		dump.data_ranges.emplace_back(LBA_START, lba_end);
+		return;
+	}
+
+	// only data tracks have sync, audio discs don't need a scan of the whole dump
+	std::vector<TOC::Session::Track> tracks;
+	TOC toc(read_vector(toc_path), false);
+	for(auto const &s : toc.sessions)
+		tracks.insert(tracks.end(), s.tracks.begin(), s.tracks.end());
+	for(uint32_t i = 0; i < tracks.size(); ++i)
+	{
+		auto &t = tracks[i];
+		if(t.track_number == bcd_decode(CD_LEADOUT_TRACK_NUMBER) || !(t.control & (uint8_t)ChannelQ::Control::DATA))
+			continue;
+
+		int32_t track_end = std::min(i + 1 < tracks.size() ? tracks[i + 1].lba_start : lba_end, lba_end);
+		if(t.lba_start < track_end)
+			dump.data_ranges.emplace_back(t.lba_start, track_end);
+	}
+}
+
+
+static int32_t compare_offset_by_sync(CompareDump &dump)
+{
+	int32_t write_offset = std::numeric_limits<int32_t>::max();
+
+	for(auto const &r : dump.data_ranges)
+	{
+		write_offset = track_offset_by_sync(r.first, r.second, dump.scm_fs);
+		if(write_offset != std::numeric_limits<int32_t>::max())
+			break;
+	}
+
+	return write_offset;
+}
+
+
+static bool compare_state_good(State s)
+{
+	return s != State::ERROR_SKIP && s != State::ERROR_C2;
+}
+
+
+// audio discs don't have sync, exact match search of a window of good non-silent samples from the first dump,
+// all candidate offsets are evaluated nearest first and the best scoring one is picked
+static bool compare_offset_by_window(int32_t &offset, CompareDump &dump1, CompareDump &dump2)
+{
+	constexpr uint32_t window_sectors = 2;
+	constexpr uint32_t window_samples = window_sectors * CD_DATA_SIZE_SAMPLES;
+	constexpr int32_t offset_range = OFFSET_DEVIATION_MAX;
+
+	std::vector<uint32_t> window(window_samples);
+	std::vector<State> window_state(window_samples);
+
+	// start searching in the middle of the dump, lead-in and pre-gap are usually silent
+	bool found = false;
+	uint32_t window_index = 0;
+	for(uint32_t i = dump1.sectors_count / 2; i + window_sectors <= dump1.sectors_count && !found; i += window_sectors)
+	{
+		read_entry(dump1.scm_fs, (uint8_t *)window.data(), CD_DATA_SIZE, i, window_sectors, 0, 0);
+		read_entry(dump1.state_fs, (uint8_t *)window_state.data(), CD_DATA_SIZE_SAMPLES, i, window_sectors, 0, (uint8_t)State::ERROR_SKIP);
+
+		if(!std::all_of(window_state.begin(), window_state.end(), compare_state_good))
+			continue;
+
+		if((uint32_t)std::count(window.begin(), window.end(), 0) > window_samples / 4)
+			continue;
+
+		window_index = i;
+		found = true;
+	}
+
+	if(!found)
+		return false;
+
+	std::vector<uint32_t> area(window_samples + 2 * offset_range);
+	read_entry(dump2.scm_fs, (uint8_t *)area.data(), CD_SAMPLE_SIZE, window_index * CD_DATA_SIZE_SAMPLES, (uint32_t)area.size(), offset_range * (int32_t)CD_SAMPLE_SIZE, 0);
+
+	uint32_t best_score = 0;
+	for(int32_t i = 0; i <= 2 * offset_range; ++i)
+	{
+		// 0, 1, -1, 2, -2 ...
+		int32_t o = i % 2 ? (i + 1) / 2 : -i / 2;
+
+		const uint32_t *candidate = &area[offset_range + o];
+		uint32_t score = 0;
+		for(uint32_t j = 0; j < window_samples; ++j)
+			score += window[j] == candidate[j];
+
+		if(score > best_score)
+		{
+			best_score = score;
+			offset = o;
+
+			if(score == window_samples)
+				break;
+		}
+	}
+
+	// require at least a half of the window to match to rule out accidental similarity
+	return best_score >= window_samples / 2;
+}
+
+
+static void compare_range_add(std::vector<CompareRange> &ranges, uint64_t sample_index)
+{
+	constexpr uint64_t merge_gap = CD_DATA_SIZE_SAMPLES;
+
+	// differences separated by less than a sector are reported as one range
+	if(!ranges.empty() && sample_index - ranges.back().end < merge_gap)
+	{
+		ranges.back().end = sample_index + 1;
+		++ranges.back().samples;
+	}
+	else
+		ranges.push_back(CompareRange{sample_index, sample_index + 1, 1});
+}
+
+
+static void compare_ranges_print(const std::vector<CompareRange> &ranges, const std::string &name)
+{
+	uint64_t samples = 0;
+	for(auto const &r : ranges)
+		samples += r.samples;
+
+	LOG("{} differences (ranges: {}, samples: {})", name, ranges.size(), samples);
+	for(auto const &r : ranges)
+	{
+		auto lba_first = (int32_t)(r.start / CD_DATA_SIZE_SAMPLES) + LBA_START;
+		auto lba_last = (int32_t)((r.end - 1) / CD_DATA_SIZE_SAMPLES) + LBA_START;
+		LOG("  LBA: [{:6} .. {:6}], samples: [{:9} .. {:9}), differing samples: {}", lba_first, lba_last, r.start, r.end, r.samples);
+	}
+}
+
+
+void redumper_compare(const Options &options)
+{
+	if(options.image_name.empty())
+		throw_line("no image name provided");
+	if(options.compare_image.empty())
+		throw_line("no image to compare with provided");
+
+	std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
+
+	CompareDump dump1;
+	CompareDump dump2;
+	compare_dump_open(dump1, image_prefix);
+	compare_dump_open(dump2, options.compare_image);
+
+	LOG("dump 1: {} (sectors: {})", dump1.scra_path.string(), dump1.sectors_count);
+	LOG("dump 2: {} (sectors: {})", dump2.scra_path.string(), dump2.sectors_count);
+
+	// dump 1 sample i corresponds to dump 2 sample i + offset
+	int32_t offset = 0;
+	if(options.force_offset)
+	{
+		offset = *options.force_offset;
+		LOG("relative offset: {:+} (forced)", offset);
+	}
+	else
+	{
+		int32_t write_offset1 = compare_offset_by_sync(dump1);
+		int32_t write_offset2 = write_offset1 == std::numeric_limits<int32_t>::max() ? write_offset1 : compare_offset_by_sync(dump2);
+		if(write_offset2 != std::numeric_limits<int32_t>::max())
+		{
+			offset = write_offset2 - write_offset1;
+			LOG("relative offset: {:+} (data sync, write offsets: {:+} / {:+})", offset, write_offset1, write_offset2);
+		}
+		else if(compare_offset_by_window(offset, dump1, dump2))
+			LOG("relative offset: {:+} (sample window match)", offset);
+		else
+			LOG("warning: unable to detect relative offset, comparing as is");
+	}
+	LOG("");
+
+	// compare in sample space of the first dump, only overlapping samples participate
+	uint64_t samples_count1 = (uint64_t)dump1.sectors_count * CD_DATA_SIZE_SAMPLES;
+	uint64_t samples_count2 = (uint64_t)dump2.sectors_count * CD_DATA_SIZE_SAMPLES;
+	uint64_t overlap_start = (uint64_t)std::max<int64_t>(0, -(int64_t)offset);
+	uint64_t overlap_end = (uint64_t)std::clamp<int64_t>((int64_t)samples_count2 - offset, 0, (int64_t)samples_count1);
+
+	std::vector<CompareRange> ranges_good;
+	std::vector<CompareRange> ranges_error;
+	uint64_t samples_compared = 0;
+
+	constexpr uint32_t chunk_sectors = 1024;
+	std::vector<uint32_t> data1(chunk_sectors * CD_DATA_SIZE_SAMPLES);
+	std::vector<uint32_t> data2(chunk_sectors * CD_DATA_SIZE_SAMPLES);
+	std::vector<State> state1(chunk_sectors * CD_DATA_SIZE_SAMPLES);
+	std::vector<State> state2(chunk_sectors * CD_DATA_SIZE_SAMPLES);
+
+	for(uint32_t s = (uint32_t)(overlap_start / CD_DATA_SIZE_SAMPLES); (uint64_t)s * CD_DATA_SIZE_SAMPLES < overlap_end; s += chunk_sectors)
+	{
+		uint32_t sectors = std::min(chunk_sectors, dump1.sectors_count - s);
+		uint32_t samples = sectors * CD_DATA_SIZE_SAMPLES;
+
+		read_entry(dump1.scm_fs, (uint8_t *)data1.data(), CD_DATA_SIZE, s, sectors, 0, 0);
+		read_entry(dump2.scm_fs, (uint8_t *)data2.data(), CD_DATA_SIZE, s, sectors, -offset * (int32_t)CD_SAMPLE_SIZE, 0);
+
+		uint64_t chunk_start = (uint64_t)s * CD_DATA_SIZE_SAMPLES;
+		uint32_t first = (uint32_t)(std::max(chunk_start, overlap_start) - chunk_start);
+		uint32_t last = (uint32_t)(std::min(chunk_start + samples, overlap_end) - chunk_start);
+		samples_compared += last - first;
+
+		// identical chunks are the common case, state is only needed to classify differences
+		if(!memcmp(&data1[first], &data2[first], (last - first) * CD_SAMPLE_SIZE))
+			continue;
+
+		read_entry(dump1.state_fs, (uint8_t *)state1.data(), CD_DATA_SIZE_SAMPLES, s, sectors, 0, (uint8_t)State::ERROR_SKIP);
+		read_entry(dump2.state_fs, (uint8_t *)state2.data(), CD_DATA_SIZE_SAMPLES, s, sectors, -offset, (uint8_t)State::ERROR_SKIP);
+
+		for(uint32_t i = first; i < last; ++i)
+		{
+			if(data1[i] == data2[i])
+				continue;
+
+			if(compare_state_good(state1[i]) && compare_state_good(state2[i]))
+				compare_range_add(ranges_good, chunk_start + i);
+			else
+				compare_range_add(ranges_error, chunk_start + i);
+		}
+	}
+
+	LOG("compared samples: {} (dump 1 samples: [{} .. {}))", samples_compared, overlap_start, overlap_end);
+	LOG("");
+	compare_ranges_print(ranges_good, "good vs good");
+	LOG("");
+	compare_ranges_print(ranges_error, "C2/SKIP");
+	LOG("");
+
+	if(ranges_good.empty() && ranges_error.empty())
+		LOG("dumps are identical");
+	else if(ranges_good.empty())
+		LOG("dumps differ only in erroneous areas");
+	else
+		LOG("warning: dumps disagree in areas both dumps consider good");
+}
+
+}
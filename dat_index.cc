@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <sstream>
+#include "common.hh"
+#include "file_io.hh"
+#include "logger.hh"
+#include "dat_index.hh"
+
+
+
+namespace gpsxre
+{
+
+static std::string xml_attribute(const std::string &tag, const std::string &name)
+{
+	std::string value;
+
+	auto key = fmt::format(" {}=\"", name);
+	auto start = tag.find(key);
+	if(start != std::string::npos)
+	{
+		start += key.length();
+		auto end = tag.find('"', start);
+		if(end != std::string::npos)
+			value = tag.substr(start, end - start);
+	}
+
+	replace_all_occurences(value, "&quot;", "\"");
+	replace_all_occurences(value, "&apos;", "'");
+	replace_all_occurences(value, "&lt;", "<");
+	replace_all_occurences(value, "&gt;", ">");
+	replace_all_occurences(value, "&amp;", "&");
+
+	return value;
+}
+
+
+static bool sha1_from_string(uint8_t *sha1, const std::string &str)
+{
+	if(str.length() != 2 * sizeof(DatIndex::Rom::sha1))
+		return false;
+
+	for(uint32_t i = 0; i < sizeof(DatIndex::Rom::sha1); ++i)
+	{
+		auto byte = str.substr(i * 2, 2);
+		if(byte.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+			return false;
+		sha1[i] = (uint8_t)std::stoul(byte, nullptr, 16);
+	}
+
+	return true;
+}
+
+
+static uint64_t dat_number(const std::string &value, int base, uint64_t max, const std::string &name, const std::filesystem::path &dat_path, uint32_t line_number)
+{
+	if(value.empty())
+		return 0;
+
+	bool valid = value.find_first_not_of(base == 16 ? "0123456789abcdefABCDEF" : "0123456789") == std::string::npos;
+
+	uint64_t number = 0;
+	if(valid)
+	{
+		try
+		{
+			number = std::stoull(value, nullptr, base);
+		}
+		catch(const std::out_of_range &)
+		{
+			valid = false;
+		}
+	}
+
+	if(!valid || number > max)
+		throw_line(fmt::format("malformed DAT file, invalid {} attribute ({}:{}, value: {})", name, dat_path.filename().string(), line_number, value));
+
+	return number;
+}
+
+
+void DatIndex::Build(const std::filesystem::path &index_path, const std::filesystem::path &dat_path)
+{
+	std::vector<std::filesystem::path> dat_files;
+	if(std::filesystem::is_directory(dat_path))
+	{
+		for(auto const &f : std::filesystem::directory_iterator(dat_path))
+			if(f.is_regular_file() && str_uppercase(f.path().extension().string()) == ".DAT")
+				dat_files.push_back(f.path());
+		std::sort(dat_files.begin(), dat_files.end());
+	}
+	else
+		dat_files.push_back(dat_path);
+
+	std::vector<Rom> roms;
+	std::vector<Game> games;
+	std::string strings;
+
+	auto add_string = [&strings](const std::string &s)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+		strings += s;
+		strings += '\0';
+		return offset;
+	};
+
+	for(auto const &f : dat_files)
+	{
+		std::fstream fs(f, std::fstream::in);
+		if(!fs.is_open())
+			throw_line(fmt::format("unable to open file ({})", f.filename().string()));
+
+		uint32_t roms_count = (uint32_t)roms.size();
+
+		std::string dat((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+
+		// tags may span lines, line number is kept for error reporting only
+		uint32_t line_number = 1;
+		size_t line_position = 0;
+		for(size_t start = dat.find('<'); start != std::string::npos; start = dat.find('<', start + 1))
+		{
+			auto end = dat.find('>', start);
+			if(end == std::string::npos)
+				break;
+
+			line_number += (uint32_t)std::count(dat.begin() + line_position, dat.begin() + start, '\n');
+			line_position = start;
+
+			auto tag = dat.substr(start, end - start + 1);
+			std::replace_if(tag.begin(), tag.end(), [](char c) { return c == '\n' || c == '\r' || c == '\t'; }, ' ');
+
+			if(tag.rfind("<game ", 0) == 0 || tag.rfind("<machine ", 0) == 0)
+				games.push_back(Game{add_string(xml_attribute(tag, "name")), 0});
+			else if(tag.rfind("<rom ", 0) == 0 && !games.empty())
+			{
+				Rom rom;
+				if(!sha1_from_string(rom.sha1, xml_attribute(tag, "sha1")))
+					continue;
+
+				rom.crc = (uint32_t)dat_number(xml_attribute(tag, "crc"), 16, std::numeric_limits<uint32_t>::max(), "crc", f, line_number);
+				rom.size = dat_number(xml_attribute(tag, "size"), 10, std::numeric_limits<uint64_t>::max(), "size", f, line_number);
+				rom.game_index = (uint32_t)games.size() - 1;
+				rom.name_offset = add_string(xml_attribute(tag, "name"));
+
+				roms.push_back(rom);
+				++games.back().roms_count;
+			}
+		}
+
+		LOG("imported {} (ROMs: {})", f.filename().string(), roms.size() - roms_count);
+	}
+
+	std::sort(roms.begin(), roms.end(), [](const Rom &r1, const Rom &r2) { return memcmp(r1.sha1, r2.sha1, sizeof(r1.sha1)) < 0; });
+
+	std::vector<uint32_t> crc_index(roms.size());
+	for(uint32_t i = 0; i < crc_index.size(); ++i)
+		crc_index[i] = i;
+	std::stable_sort(crc_index.begin(), crc_index.end(), [&roms](uint32_t i1, uint32_t i2) { return roms[i1].crc < roms[i2].crc; });
+
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	header.games_count = (uint32_t)games.size();
+	header.roms_count = (uint32_t)roms.size();
+	header.strings_size = (uint32_t)strings.size();
+
+	std::fstream fs(index_path, std::fstream::out | std::fstream::binary);
+	if(!fs.is_open())
+		throw_line(fmt::format("unable to create file ({})", index_path.filename().string()));
+	fs.write((char *)&header, sizeof(header));
+	fs.write((char *)roms.data(), roms.size() * sizeof(Rom));
+	fs.write((char *)crc_index.data(), crc_index.size() * sizeof(uint32_t));
+	fs.write((char *)games.data(), games.size() * sizeof(Game));
+	fs.write(strings.data(), strings.size());
+	if(fs.fail())
+		throw_line(fmt::format("write failed ({})", index_path.filename().string()));
+
+	LOG("DAT index created (games: {}, ROMs: {})", games.size(), roms.size());
+}
+
+
+DatIndex::DatIndex(const std::filesystem::path &index_path)
+	: _data(read_vector(index_path))
+{
+	if(_data.size() < sizeof(Header))
+		throw_line(fmt::format("invalid DAT index file ({})", index_path.filename().string()));
+
+	_header = (const Header *)_data.data();
+	if(memcmp(_header->magic, MAGIC, sizeof(_header->magic)) || _header->version != VERSION)
+		throw_line(fmt::format("unsupported DAT index file ({})", index_path.filename().string()));
+
+	uint64_t expected_size = sizeof(Header) + (uint64_t)_header->roms_count * (sizeof(Rom) + sizeof(uint32_t)) + (uint64_t)_header->games_count * sizeof(Game) + _header->strings_size;
+	if(_data.size() != expected_size)
+		throw_line(fmt::format("corrupted DAT index file ({})", index_path.filename().string()));
+
+	_roms = (const Rom *)(_data.data() + sizeof(Header));
+	_crcIndex = (const uint32_t *)(_roms + _header->roms_count);
+	_games = (const Game *)(_crcIndex + _header->roms_count);
+	_strings = (const char *)(_games + _header->games_count);
+}
+
+
+std::vector<const DatIndex::Rom *> DatIndex::FindSHA1(const std::string &sha1) const
+{
+	std::vector<const Rom *> roms;
+
+	uint8_t key[sizeof(Rom::sha1)];
+	if(!sha1_from_string(key, sha1))
+		return roms;
+
+	// the same ROM can be a part of multiple games
+	auto it = std::lower_bound(_roms, _roms + _header->roms_count, key, [](const Rom &r, const uint8_t *k) { return memcmp(r.sha1, k, sizeof(r.sha1)) < 0; });
+	for(; it != _roms + _header->roms_count && !memcmp(it->sha1, key, sizeof(key)); ++it)
+		roms.push_back(it);
+
+	return roms;
+}
+
+
+std::vector<const DatIndex::Rom *> DatIndex::FindCRC(uint32_t crc) const
+{
+	std::vector<const Rom *> roms;
+
+	auto lower = std::partition_point(_crcIndex, _crcIndex + _header->roms_count, [this, crc](uint32_t i) { return _roms[i].crc < crc; });
+	for(auto it = lower; it != _crcIndex + _header->roms_count && _roms[*it].crc == crc; ++it)
+		roms.push_back(&_roms[*it]);
+
+	return roms;
+}
+
+
+const DatIndex::Game &DatIndex::GetGame(uint32_t game_index) const
+{
+	return _games[game_index];
+}
+
+
+std::string DatIndex::GetString(uint32_t offset) const
+{
+	return offset < _header->strings_size ? std::string(_strings + offset) : std::string();
+}
+
+
+void dat_report(const DatIndex &index, const std::vector<TrackEntry> &track_entries)
+{
+	// game index, matched tracks count
+	std::map<uint32_t, uint32_t> games;
+
+	LOG("DAT matches:");
+	for(auto const &t : track_entries)
+	{
+		auto matches = index.FindSHA1(t.sha1);
+		for(auto m : matches)
+		{
+			LOG("  {}: match ({} / {})", t.filename, index.GetString(index.GetGame(m->game_index).name_offset), index.GetString(m->name_offset));
+			++games[m->game_index];
+		}
+
+		if(matches.empty())
+		{
+			auto candidates = index.FindCRC(t.crc);
+			if(candidates.empty())
+				LOG("  {}: no match", t.filename);
+			for(auto c : candidates)
+				LOG("  {}: partial match, CRC32 only ({} / {})", t.filename, index.GetString(index.GetGame(c->game_index).name_offset), index.GetString(c->name_offset));
+		}
+	}
+
+	for(auto const &g : games)
+	{
+		auto const &game = index.GetGame(g.first);
+		if(g.second == game.roms_count && g.second == track_entries.size())
+			LOG("full match: {}", index.GetString(game.name_offset));
+		else
+			LOG("partial match: {} (matched tracks: {}/{})", index.GetString(game.name_offset), g.second, game.roms_count);
+	}
+	LOG("");
+}
+
+
+void redumper_datindex(const Options &options)
+{
+	if(options.dat.empty())
+		throw_line("no DAT file provided");
+	if(options.dat_index.empty())
+		throw_line("no DAT index file provided");
+
+	DatIndex::Build(options.dat_index, options.dat);
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "options.hh"
+#include "split.hh"
+
+
+
+namespace gpsxre
+{
+
+// compact DAT hash index: ROM records are sorted by SHA-1 with a secondary CRC32 ordering,
+// whole index is loaded with a single read and queried with binary search
+class DatIndex
+{
+public:
+#pragma pack(push, 1)
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t games_count;
+		uint32_t roms_count;
+		uint32_t strings_size;
+	};
+
+	struct Rom
+	{
+		uint8_t sha1[20];
+		uint32_t crc;
+		uint64_t size;
+		uint32_t game_index;
+		uint32_t name_offset;
+	};
+
+	struct Game
+	{
+		uint32_t name_offset;
+		uint32_t roms_count;
+	};
+#pragma pack(pop)
+
+	static constexpr char MAGIC[] = "RDAT";
+	static constexpr uint32_t VERSION = 1;
+
+	// imports XML DAT file or every .dat file of a directory
+	static void Build(const std::filesystem::path &index_path, const std::filesystem::path &dat_path);
+
+	DatIndex(const std::filesystem::path &index_path);
+
+	std::vector<const Rom *> FindSHA1(const std::string &sha1) const;
+	std::vector<const Rom *> FindCRC(uint32_t crc) const;
+
+	const Game &GetGame(uint32_t game_index) const;
+	std::string GetString(uint32_t offset) const;
+
+private:
+	std::vector<uint8_t> _data;
+
+	const Header *_header;
+	const Rom *_roms;
+	const uint32_t *_crcIndex;
+	const Game *_games;
+	const char *_strings;
+};
+
+
+// per track SHA-1 / CRC32 lookup and per game summary
+void dat_report(const DatIndex &index, const std::vector<TrackEntry> &track_entries);
+
+void redumper_datindex(const Options &options);
+
+}
@@ -502,43 +502,22 @@ void asus_cache_print_subq(const std::vector<uint8_t> &cache, DriveConfig::Type
 }
 
 
-SectorLayout sector_order_layout(const DriveConfig::SectorOrder &sector_order)
+SectorUnpacker sector_unpacker(const DriveConfig &drive_config)
 {
-	SectorLayout sector_layout;
+	bool c2_split = drive_config.c2_shift % CD_C2_SIZE;
 
-	switch(sector_order)
+	switch(drive_config.sector_order)
 	{
 	default:
 	case DriveConfig::SectorOrder::DATA_C2_SUB:
-		sector_layout.data_offset = 0;
-		sector_layout.c2_offset = sector_layout.data_offset + CD_DATA_SIZE;
-		sector_layout.subcode_offset = sector_layout.c2_offset + CD_C2_SIZE;
-		sector_layout.size = sector_layout.subcode_offset + CD_SUBCODE_SIZE;
-		break;
-
+		return c2_split ? sector_unpack<DriveConfig::SectorOrder::DATA_C2_SUB, true> : sector_unpack<DriveConfig::SectorOrder::DATA_C2_SUB, false>;
 	case DriveConfig::SectorOrder::DATA_SUB_C2:
-		sector_layout.data_offset = 0;
-		sector_layout.subcode_offset = sector_layout.data_offset + CD_DATA_SIZE;
-		sector_layout.c2_offset = sector_layout.subcode_offset + CD_SUBCODE_SIZE;
-		sector_layout.size = sector_layout.c2_offset + CD_C2_SIZE;
-		break;
-
+		return c2_split ? sector_unpack<DriveConfig::SectorOrder::DATA_SUB_C2, true> : sector_unpack<DriveConfig::SectorOrder::DATA_SUB_C2, false>;
 	case DriveConfig::SectorOrder::DATA_SUB:
-		sector_layout.data_offset = 0;
-		sector_layout.subcode_offset = sector_layout.data_offset + CD_DATA_SIZE;
-		sector_layout.size = sector_layout.subcode_offset + CD_SUBCODE_SIZE;
-		sector_layout.c2_offset = CD_RAW_DATA_SIZE;
-		break;
-
+		return sector_unpack<DriveConfig::SectorOrder::DATA_SUB, false>;
 	case DriveConfig::SectorOrder::DATA_C2:
-		sector_layout.data_offset = 0;
-		sector_layout.c2_offset = sector_layout.data_offset + CD_DATA_SIZE;
-		sector_layout.size = sector_layout.c2_offset + CD_C2_SIZE;
-		sector_layout.subcode_offset = CD_RAW_DATA_SIZE;
-		break;
+		return c2_split ? sector_unpack<DriveConfig::SectorOrder::DATA_C2, true> : sector_unpack<DriveConfig::SectorOrder::DATA_C2, false>;
 	}
-
-	return sector_layout;
 }
 
 }
@@ -3,6 +3,7 @@
 
 
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 #include "cd.hh"
@@ -65,6 +66,74 @@ struct AsusConfig
 
 inline constexpr uint32_t PLEXTOR_LEADIN_ENTRY_SIZE = sizeof(SPTD::Status) + CD_DATA_SIZE + CD_SUBCODE_SIZE;
 
+// converts raw drive response to DATA_C2_SUB sector, response holds as many drive sectors as needed to compensate C2 shift
+typedef void (*SectorUnpacker)(uint8_t *sector, const uint8_t *response, uint32_t c2_shift);
+
+constexpr SectorLayout sector_order_layout(const DriveConfig::SectorOrder &sector_order)
+{
+	SectorLayout sector_layout{};
+
+	switch(sector_order)
+	{
+	default:
+	case DriveConfig::SectorOrder::DATA_C2_SUB:
+		sector_layout.data_offset = 0;
+		sector_layout.c2_offset = sector_layout.data_offset + CD_DATA_SIZE;
+		sector_layout.subcode_offset = sector_layout.c2_offset + CD_C2_SIZE;
+		sector_layout.size = sector_layout.subcode_offset + CD_SUBCODE_SIZE;
+		break;
+
+	case DriveConfig::SectorOrder::DATA_SUB_C2:
+		sector_layout.data_offset = 0;
+		sector_layout.subcode_offset = sector_layout.data_offset + CD_DATA_SIZE;
+		sector_layout.c2_offset = sector_layout.subcode_offset + CD_SUBCODE_SIZE;
+		sector_layout.size = sector_layout.c2_offset + CD_C2_SIZE;
+		break;
+
+	case DriveConfig::SectorOrder::DATA_SUB:
+		sector_layout.data_offset = 0;
+		sector_layout.subcode_offset = sector_layout.data_offset + CD_DATA_SIZE;
+		sector_layout.size = sector_layout.subcode_offset + CD_SUBCODE_SIZE;
+		sector_layout.c2_offset = CD_RAW_DATA_SIZE;
+		break;
+
+	case DriveConfig::SectorOrder::DATA_C2:
+		sector_layout.data_offset = 0;
+		sector_layout.c2_offset = sector_layout.data_offset + CD_DATA_SIZE;
+		sector_layout.size = sector_layout.c2_offset + CD_C2_SIZE;
+		sector_layout.subcode_offset = CD_RAW_DATA_SIZE;
+		break;
+	}
+
+	return sector_layout;
+}
+
+// straight line copy specialized per sector order, C2_SPLIT: shifted C2 spans two consecutive drive sectors
+template<DriveConfig::SectorOrder ORDER, bool C2_SPLIT>
+void sector_unpack(uint8_t *sector, const uint8_t *response, uint32_t c2_shift)
+{
+	constexpr SectorLayout layout = sector_order_layout(ORDER);
+
+	memcpy(sector, response + layout.data_offset, CD_DATA_SIZE);
+
+	if constexpr(layout.c2_offset == CD_RAW_DATA_SIZE)
+		memset(sector + CD_DATA_SIZE, 0x00, CD_C2_SIZE);
+	else if constexpr(C2_SPLIT)
+	{
+		const uint8_t *c2 = response + layout.size * (c2_shift / CD_C2_SIZE) + layout.c2_offset;
+		uint32_t c2_offset = c2_shift % CD_C2_SIZE;
+		memcpy(sector + CD_DATA_SIZE, c2 + c2_offset, CD_C2_SIZE - c2_offset);
+		memcpy(sector + CD_DATA_SIZE + CD_C2_SIZE - c2_offset, c2 + layout.size, c2_offset);
+	}
+	else
+		memcpy(sector + CD_DATA_SIZE, response + layout.size * (c2_shift / CD_C2_SIZE) + layout.c2_offset, CD_C2_SIZE);
+
+	if constexpr(layout.subcode_offset == CD_RAW_DATA_SIZE)
+		memset(sector + CD_DATA_SIZE + CD_C2_SIZE, 0x00, CD_SUBCODE_SIZE);
+	else
+		memcpy(sector + CD_DATA_SIZE + CD_C2_SIZE, response + layout.subcode_offset, CD_SUBCODE_SIZE);
+}
+
 DriveConfig drive_get_config(const DriveQuery &drive_query);
 void drive_override_config(DriveConfig &drive_config, const std::string *type, const int *read_offset, const int *c2_shift, const int *pregap_start, const std::string *read_method, const std::string *sector_order);
 int32_t drive_get_generic_read_offset(const std::string &vendor, const std::string &product);
@@ -76,6 +145,6 @@ std::vector<uint8_t> plextor_read_leadin(SPTD &sptd, uint32_t tail_size);
 std::vector<uint8_t> asus_cache_read(SPTD &sptd, DriveConfig::Type drive_type);
 std::vector<uint8_t> asus_cache_extract(const std::vector<uint8_t> &cache, int32_t lba_start, uint32_t entries_count, DriveConfig::Type drive_type);
 void asus_cache_print_subq(const std::vector<uint8_t> &cache, DriveConfig::Type drive_type);
-SectorLayout sector_order_layout(const DriveConfig::SectorOrder &sector_order);
+SectorUnpacker sector_unpacker(const DriveConfig &drive_config);
 
 }
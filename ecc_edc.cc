@@ -20,6 +20,7 @@
  */
 
 #include <algorithm>
+#include <mutex>
 #include "ecc_edc.hh"
 
 
@@ -29,16 +30,13 @@ namespace gpsxre
 
 uint8_t ECC::_F_LUT[_LUT_SIZE];
 uint8_t ECC::_B_LUT[_LUT_SIZE];
-bool ECC::_initialized(false);
 
 
 ECC::ECC()
 {
-	if(!_initialized)
-	{
-		InitLUTs();
-		_initialized = true;
-	}
+	// shared tables, instances are constructed concurrently
+	static std::once_flag initialized;
+	std::call_once(initialized, [this]() { InitLUTs(); });
 }
 
 
@@ -57,6 +55,9 @@ Sector::ECC ECC::Generate(Sector &sector, bool zero_address)
 	// Compute ECC P code
 	ComputeBlock(ecc.p_parity, (uint8_t *)&sector.header, 86, 24, 2, 86);
 
+	// Q code covers P code, both Mode 1 and Mode 2 Form 1 store it at the same position
+	std::copy_n(ecc.p_parity, sizeof(ecc.p_parity), sector.mode1.ecc.p_parity);
+
 	// Compute ECC Q code
 	ComputeBlock(ecc.q_parity, (uint8_t *)&sector.header, 52, 43, 86, 88);
 
@@ -120,16 +121,13 @@ void ECC::ComputeBlock(uint8_t *parity, const uint8_t *data, uint32_t major_coun
 
 
 uint32_t EDC::_LUT[_LUT_SIZE];
-bool EDC::_initialized(false);
 
 
 EDC::EDC()
 {
-	if(!_initialized)
-	{
-		InitLUTs();
-		_initialized = true;
-	}
+	// shared tables, instances are constructed concurrently
+	static std::once_flag initialized;
+	std::call_once(initialized, [this]() { InitLUTs(); });
 }
 
 
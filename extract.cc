@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "common.hh"
+#include "crc32.hh"
+#include "file_io.hh"
+#include "image_browser.hh"
+#include "logger.hh"
+#include "sha1.hh"
+#include "split.hh"
+#include "thread_pool.hh"
+#include "extract.hh"
+
+
+
+namespace gpsxre
+{
+
+struct ExtractTrack
+{
+	std::string name;
+	std::unique_ptr<ImageBrowser> browser;
+
+	// .state alignment, files aren't checked for errors if not available
+	std::optional<int32_t> write_offset;
+};
+
+
+struct ExtractEntry
+{
+	std::filesystem::path path;
+	std::shared_ptr<ImageBrowser::Entry> entry;
+	const ExtractTrack *track;
+
+	uint64_t size;
+	uint32_t crc;
+	std::string sha1;
+
+	uint32_t c2_sectors;
+	uint32_t skip_sectors;
+};
+
+
+constexpr uint32_t EXTRACT_CHUNK_SECTORS = 64;
+
+
+// XA files (Form2 or interleaved Form1/Form2) are stored as 2336 byte raw Mode2 sectors with subheader included,
+// everything else is stored as 2048 byte user data truncated to the file length;
+// returns false without completing the file if it turns out to be XA
+static bool extract_file_pass(ExtractEntry &e, const std::filesystem::path &file_path, bool xa)
+{
+	std::fstream fs(file_path, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+	if(!fs.is_open())
+		throw_line(fmt::format("unable to create file ({})", file_path.filename().string()));
+
+	uint32_t sectors_count = e.entry->SectorSize();
+	uint64_t size_left = xa ? std::numeric_limits<uint64_t>::max() : e.entry->Size();
+
+	e.size = 0;
+	uint32_t crc = crc32_seed();
+	SHA1 bh_sha1;
+
+	std::vector<uint8_t> data(EXTRACT_CHUNK_SECTORS * MODE0_DATA_SIZE);
+	bool interrupted = batch_process_range<uint32_t>(std::pair(0, sectors_count), EXTRACT_CHUNK_SECTORS, [&](uint32_t offset, uint32_t count) -> bool
+	{
+		auto raw = e.entry->ReadRaw(offset, count);
+		if(raw.size() != count * sizeof(Sector))
+			throw_line(fmt::format("short read ({}, sectors: {}/{})", e.path.generic_string(), offset + raw.size() / sizeof(Sector), sectors_count));
+
+		uint32_t data_size = 0;
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			auto &sector = *(Sector *)&raw[i * sizeof(Sector)];
+
+			if(xa)
+			{
+				memcpy(&data[data_size], sector.mode2.user_data, MODE0_DATA_SIZE);
+				data_size += MODE0_DATA_SIZE;
+			}
+			else
+			{
+				const uint8_t *user_data = nullptr;
+				if(sector.header.mode == 1)
+					user_data = sector.mode1.user_data;
+				else if(sector.header.mode == 2)
+				{
+					if(sector.mode2.xa.sub_header.submode & (uint8_t)CDXAMode::FORM2)
+						return true;
+
+					user_data = sector.mode2.xa.form1.user_data;
+				}
+
+				if(user_data == nullptr)
+					memset(&data[data_size], 0, FORM1_DATA_SIZE);
+				else
+					memcpy(&data[data_size], user_data, FORM1_DATA_SIZE);
+				data_size += FORM1_DATA_SIZE;
+			}
+		}
+
+		data_size = (uint32_t)std::min((uint64_t)data_size, size_left);
+		size_left -= data_size;
+
+		crc = crc32(data.data(), data_size, crc);
+		bh_sha1.Update(data.data(), data_size);
+		fs.write((char *)data.data(), data_size);
+		if(fs.fail())
+			throw_line(fmt::format("write failed ({})", file_path.filename().string()));
+		e.size += data_size;
+
+		return false;
+	});
+
+	if(interrupted)
+		return false;
+
+	e.crc = crc32_final(crc);
+	e.sha1 = bh_sha1.Final();
+
+	return true;
+}
+
+
+// file extent is read and hashed in chunks, an XA file is started over on the first Form2 sector
+static void extract_file(ExtractEntry &e, const std::filesystem::path &file_path)
+{
+	if(!extract_file_pass(e, file_path, false))
+		extract_file_pass(e, file_path, true);
+}
+
+
+// counts file extent sectors with C2 / SKIP samples, state stream is shared between tasks
+static void extract_file_errors(ExtractEntry &e, std::fstream &state_fs, std::mutex &state_mutex)
+{
+	e.c2_sectors = 0;
+	e.skip_sectors = 0;
+
+	std::vector<State> state(EXTRACT_CHUNK_SECTORS * CD_DATA_SIZE_SAMPLES);
+	int32_t lba_start = e.entry->SectorOffset();
+	batch_process_range<int32_t>(std::pair(lba_start, lba_start + (int32_t)e.entry->SectorSize()), EXTRACT_CHUNK_SECTORS, [&](int32_t lba, int32_t count) -> bool
+	{
+		{
+			std::lock_guard<std::mutex> lock(state_mutex);
+			read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba - LBA_START, count, -*e.track->write_offset, (uint8_t)State::ERROR_SKIP);
+		}
+
+		for(int32_t i = 0; i < count; ++i)
+		{
+			bool c2 = false;
+			bool skip = false;
+			for(uint32_t j = 0; j < CD_DATA_SIZE_SAMPLES; ++j)
+			{
+				auto s = state[i * CD_DATA_SIZE_SAMPLES + j];
+				if(s == State::ERROR_C2)
+					c2 = true;
+				else if(s == State::ERROR_SKIP)
+					skip = true;
+			}
+
+			if(c2)
+				++e.c2_sectors;
+			if(skip)
+				++e.skip_sectors;
+		}
+
+		return false;
+	});
+}
+
+
+// write offset of a split data track relative to the scrambled image, first sector address locates the track
+static int32_t extract_track_offset(const std::filesystem::path &track_path, std::fstream &scm_fs)
+{
+	int32_t write_offset = std::numeric_limits<int32_t>::max();
+
+	std::fstream fs(track_path, std::fstream::in | std::fstream::binary);
+	Sector sector;
+	fs.read((char *)&sector, sizeof(sector));
+	if(!fs.fail() && BCDMSF_valid(sector.header.address))
+	{
+		int32_t lba = BCDMSF_to_LBA(sector.header.address);
+		write_offset = track_offset_by_sync(lba, lba + (int32_t)(std::filesystem::file_size(track_path) / sizeof(Sector)), scm_fs);
+	}
+
+	return write_offset;
+}
+
+
+void redumper_extract(const Options &options)
+{
+	if(options.image_name.empty())
+		throw_line("no image name provided");
+
+	std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
+
+	std::filesystem::path cue_path(image_prefix + ".cue");
+	std::filesystem::path scm_path(image_prefix + ".scram");
+	std::filesystem::path state_path(image_prefix + ".state");
+	std::filesystem::path manifest_path(image_prefix + ".manifest");
+	std::filesystem::path extract_path(image_prefix + "_extract");
+
+	if(!options.overwrite && (std::filesystem::exists(extract_path) || std::filesystem::exists(manifest_path)))
+		throw_line(fmt::format("extracted files already exist ({})", extract_path.filename().string()));
+
+	std::vector<ExtractTrack> tracks;
+
+	std::fstream scm_fs;
+	bool state = std::filesystem::exists(state_path);
+
+	// split tracks, error check needs the scrambled image to align .state
+	if(std::filesystem::exists(cue_path))
+	{
+		if(state && std::filesystem::exists(scm_path))
+		{
+			scm_fs.open(scm_path, std::fstream::in | std::fstream::binary);
+			if(!scm_fs.is_open())
+				throw_line(fmt::format("unable to open file ({})", scm_path.filename().string()));
+		}
+
+		for(auto const &t : cue_get_entries(cue_path))
+		{
+			auto track_path = std::filesystem::path(options.image_path) / t.first;
+			if(t.second && ImageBrowser::IsDataTrack(track_path))
+			{
+				auto &track = tracks.emplace_back(ExtractTrack{track_path.stem().string(), std::make_unique<ImageBrowser>(track_path, 0, std::filesystem::file_size(track_path), false), std::nullopt});
+
+				if(scm_fs.is_open())
+				{
+					int32_t write_offset = options.force_offset ? *options.force_offset : extract_track_offset(track_path, scm_fs);
+					if(write_offset == std::numeric_limits<int32_t>::max())
+						LOG("warning: unable to detect data track write offset, files are not checked for errors (track: {})", track.name);
+					else
+						track.write_offset = write_offset;
+				}
+			}
+		}
+	}
+	// scrambled image, data tracks are taken from TOC the same way split does
+	else if(std::filesystem::exists(scm_path))
+	{
+		scm_fs.open(scm_path, std::fstream::in | std::fstream::binary);
+		if(!scm_fs.is_open())
+			throw_line(fmt::format("unable to open file ({})", scm_path.filename().string()));
+
+		uint32_t sectors_count = check_file(state_path, CD_DATA_SIZE_SAMPLES);
+		TOC toc = toc_load(image_prefix, sectors_count, options);
+
+		for(auto const &s : toc.sessions)
+		{
+			for(auto const &t : s.tracks)
+			{
+				if(!(t.control & (uint8_t)ChannelQ::Control::DATA) || t.track_number == bcd_decode(CD_LEADOUT_TRACK_NUMBER) || t.lba_end == t.lba_start)
+					continue;
+
+				auto track_name = track_basename(toc, s.session_number, t.track_number, options.image_name);
+
+				// filesystem is anchored at index 1, every data track has its own write offset
+				int32_t lba_start = t.indices.empty() ? t.lba_start : t.indices.front();
+				int32_t write_offset = options.force_offset ? *options.force_offset : track_offset_by_sync(lba_start, t.lba_end, scm_fs);
+				if(write_offset == std::numeric_limits<int32_t>::max())
+				{
+					LOG("warning: unable to detect data track write offset, skipping (track: {})", track_name);
+					continue;
+				}
+
+				try
+				{
+					tracks.push_back(ExtractTrack{track_name, std::make_unique<ImageBrowser>(scm_fs, (lba_start - LBA_START) * CD_DATA_SIZE + write_offset * CD_SAMPLE_SIZE, 0, true), write_offset});
+					LOG("track \"{}\" write offset: {:+}", track_name, write_offset);
+				}
+				catch(const std::exception &)
+				{
+					LOG("warning: no ISO9660 filesystem, skipping (track: {})", track_name);
+				}
+			}
+		}
+	}
+	else
+		throw_line("no CUE-sheet or scrambled image found");
+
+	if(tracks.empty())
+		LOG("warning: no ISO9660 data tracks found");
+
+	ThreadPool pool;
+
+	LOG("extract started");
+	auto time_start = std::chrono::high_resolution_clock::now();
+
+	std::vector<ExtractEntry> entries;
+	for(auto &t : tracks)
+	{
+		std::vector<ExtractEntry> track_entries;
+		t.browser->Iterate([&](const std::string &path, std::shared_ptr<ImageBrowser::Entry> d)
+		{
+			if(!d->IsDummy())
+				track_entries.push_back(ExtractEntry{std::filesystem::path(t.name) / path / d->Name(), d, &t, 0, 0, "", 0, 0});
+
+			return false;
+		});
+
+		// sequential reads
+		std::stable_sort(track_entries.begin(), track_entries.end(), [](const ExtractEntry &e1, const ExtractEntry &e2) { return e1.entry->SectorOffset() < e2.entry->SectorOffset(); });
+
+		LOG("track \"{}\" (files: {})", t.name, track_entries.size());
+
+		entries.insert(entries.end(), track_entries.begin(), track_entries.end());
+	}
+
+	for(auto const &e : entries)
+		std::filesystem::create_directories((extract_path / e.path).parent_path());
+
+	std::fstream state_fs;
+	std::mutex state_mutex;
+	if(state)
+	{
+		state_fs.open(state_path, std::fstream::in | std::fstream::binary);
+		if(!state_fs.is_open())
+			throw_line(fmt::format("unable to open file ({})", state_path.filename().string()));
+	}
+
+	std::vector<std::future<void>> tasks;
+	for(auto &e : entries)
+	{
+		tasks.push_back(pool.Enqueue([&e, &extract_path, &state_fs, &state_mutex]()
+		{
+			if(e.track->write_offset)
+				extract_file_errors(e, state_fs, state_mutex);
+
+			extract_file(e, extract_path / e.path);
+		}));
+	}
+	// all tasks have to be finished before the first failure unwinds what they reference
+	for(auto &t : tasks)
+		t.wait();
+	for(auto &t : tasks)
+		t.get();
+
+	for(auto const &e : entries)
+		if(e.c2_sectors || e.skip_sectors)
+			LOG("warning: file has errors, extracted as is (file: {}, sectors: {{C2: {}, SKIP: {}}})", e.path.generic_string(), e.c2_sectors, e.skip_sectors);
+
+	std::fstream fs(manifest_path, std::fstream::out);
+	if(!fs.is_open())
+		throw_line(fmt::format("unable to create file ({})", manifest_path.filename().string()));
+	for(auto const &e : entries)
+		fs << fmt::format("{:08x} {} {:10} {}", e.crc, e.sha1, e.size, e.path.generic_string()) << std::endl;
+
+	auto time_stop = std::chrono::high_resolution_clock::now();
+	LOG("extract complete (time: {}s)", std::chrono::duration_cast<std::chrono::seconds>(time_stop - time_start).count());
+	LOG("");
+}
+
+}
@@ -1,7 +1,11 @@
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 #include "cd.hh"
 #include "common.hh"
+#include "profiler.hh"
 #include "scsi.hh"
 #include "file_io.hh"
 
@@ -10,8 +14,65 @@
 namespace gpsxre
 {
 
+static std::atomic<uint32_t> g_io_limit(0);
+static std::mutex g_io_mutex;
+static std::condition_variable g_io_cv;
+static uint32_t g_io_active = 0;
+
+
+IOSlot::IOSlot()
+	: _acquired(false)
+{
+	if(!g_io_limit.load(std::memory_order_relaxed))
+		return;
+
+	std::unique_lock<std::mutex> lock(g_io_mutex);
+	g_io_cv.wait(lock, []() { auto limit = g_io_limit.load(); return !limit || g_io_active < limit; });
+	++g_io_active;
+	_acquired = true;
+}
+
+
+IOSlot::~IOSlot()
+{
+	if(!_acquired)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(g_io_mutex);
+		--g_io_active;
+	}
+	g_io_cv.notify_one();
+}
+
+
+void IOSlot::SetLimit(uint32_t limit)
+{
+	{
+		std::lock_guard<std::mutex> lock(g_io_mutex);
+		g_io_limit = limit;
+	}
+	g_io_cv.notify_all();
+}
+
+
+IOLimit::IOLimit(uint32_t limit)
+{
+	IOSlot::SetLimit(limit);
+}
+
+
+IOLimit::~IOLimit()
+{
+	IOSlot::SetLimit(0);
+}
+
+
 void write_entry(std::fstream &fs, const uint8_t *data, uint32_t entry_size, uint32_t index, uint32_t count, int32_t byte_offset)
 {
+	PROFILE_SCOPE_BYTES("write_entry", (uint64_t)entry_size * count);
+	IOSlot io_slot;
+
 	int32_t file_offset = index * entry_size - byte_offset;
 
 	uint32_t total_size = entry_size * count;
@@ -41,6 +102,9 @@ void write_entry(std::fstream &fs, const uint8_t *data, uint32_t entry_size, uin
 
 void read_entry(std::fstream &fs, uint8_t *data, uint32_t entry_size, uint32_t index, uint32_t count, int32_t byte_offset, uint8_t fill_byte)
 {
+	PROFILE_SCOPE_BYTES("read_entry", (uint64_t)entry_size * count);
+	IOSlot io_slot;
+
 	int32_t file_offset = index * entry_size - byte_offset;
 
 	uint32_t total_size = entry_size * count;
@@ -103,6 +167,7 @@ void write_align(std::fstream &fs, uint32_t index, uint32_t entry_size, uint8_t
 std::vector<uint8_t> read_vector(const std::filesystem::path &file_path)
 {
 	std::vector<uint8_t> data((std::vector<uint8_t>::size_type)std::filesystem::file_size(file_path));
+	IOSlot io_slot;
 
 	std::fstream fs(file_path, std::fstream::in | std::fstream::binary);
 	if(!fs.is_open())
@@ -117,6 +182,8 @@ std::vector<uint8_t> read_vector(const std::filesystem::path &file_path)
 
 void write_vector(const std::filesystem::path &file_path, const std::vector<uint8_t> &data)
 {
+	IOSlot io_slot;
+
 	std::fstream fs(file_path, std::fstream::out | std::fstream::binary);
 	if(!fs.is_open())
 		throw_line(fmt::format("unable to create file ({})", file_path.filename().string()));
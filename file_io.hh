@@ -12,6 +12,37 @@
 namespace gpsxre
 {
 
+// RAII slot of the process wide bulk file I/O concurrency limit, blocks while all slots are taken,
+// never blocks if the limit is not set
+class IOSlot
+{
+public:
+	IOSlot();
+	~IOSlot();
+
+	IOSlot(const IOSlot &) = delete;
+	IOSlot &operator=(const IOSlot &) = delete;
+
+	// 0 is unlimited
+	static void SetLimit(uint32_t limit);
+
+private:
+	bool _acquired;
+};
+
+
+// RAII process wide bulk file I/O concurrency limit, unlimited again when going out of scope
+class IOLimit
+{
+public:
+	IOLimit(uint32_t limit);
+	~IOLimit();
+
+	IOLimit(const IOLimit &) = delete;
+	IOLimit &operator=(const IOLimit &) = delete;
+};
+
+
 void write_entry(std::fstream &fs, const uint8_t *data, uint32_t entry_size, uint32_t index, uint32_t count, int32_t byte_offset);
 void read_entry(std::fstream &fs, uint8_t *data, uint32_t entry_size, uint32_t index, uint32_t count, int32_t byte_offset, uint8_t fill_byte);
 void write_align(std::fstream &fs, uint32_t index, uint32_t entry_size, uint8_t fill_byte);
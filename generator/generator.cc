@@ -0,0 +1,62 @@
+#include <chrono>
+#include <exception>
+#include <fmt/format.h>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+#include "image_generator.hh"
+
+
+
+using namespace gpsxre;
+
+
+
+int main(int argc, char *argv[])
+{
+	int exit_code = 0;
+
+	uint32_t threads_count = 0;
+	std::optional<uint32_t> seed;
+	std::vector<std::string> positional;
+	bool usage = false;
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if(arg.rfind("--threads=", 0) == 0)
+			threads_count = std::stoul(arg.substr(10));
+		else if(arg.rfind("--seed=", 0) == 0)
+			seed = std::stoul(arg.substr(7));
+		else if(arg.rfind("--", 0) == 0)
+			usage = true;
+		else
+			positional.push_back(arg);
+	}
+
+	if(usage || positional.size() != 2)
+	{
+		std::cout << "usage: generate_image [--threads=<count>] [--seed=<value>] <layout> <image prefix>" << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		auto layout = image_layout_load(positional[0]);
+		if(seed)
+			layout.seed = *seed;
+
+		auto time_start = std::chrono::steady_clock::now();
+		image_generate(positional[1], layout, threads_count);
+		auto time_stop = std::chrono::steady_clock::now();
+
+		std::cout << fmt::format("image generated (prefix: {}, time: {:.3f}s)", positional[1], std::chrono::duration<double>(time_stop - time_start).count()) << std::endl;
+	}
+	catch(const std::exception &e)
+	{
+		std::cout << fmt::format("error: {}", e.what()) << std::endl;
+		exit_code = 1;
+	}
+
+	return exit_code;
+}
@@ -0,0 +1,954 @@
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <fmt/format.h>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include "cd.hh"
+#include "common.hh"
+#include "crc16_gsm.hh"
+#include "ecc_edc.hh"
+#include "endian.hh"
+#include "file_io.hh"
+#include "interval_set.hh"
+#include "iso9660.hh"
+#include "mmc.hh"
+#include "redumper.hh"
+#include "scrambler.hh"
+#include "subcode.hh"
+#include "thread_pool.hh"
+#include "toc.hh"
+#include "image_generator.hh"
+
+
+
+namespace gpsxre
+{
+
+static const std::map<ImageLayout::TrackType, std::string> TRACK_TYPE_STRING =
+{
+	{ImageLayout::TrackType::AUDIO, "audio"},
+	{ImageLayout::TrackType::MODE1, "mode1"},
+	{ImageLayout::TrackType::MODE2_FORM1, "mode2"},
+	{ImageLayout::TrackType::MODE2_FORM2, "mode2_form2"}
+};
+
+// ECMA-130 / Red Book session boundaries
+constexpr uint32_t LEADIN_SIZE = 4500;
+constexpr uint32_t LEADOUT_SIZE_FIRST = 6750;
+constexpr uint32_t LEADOUT_SIZE_NEXT = 2250;
+
+constexpr uint32_t GENERATOR_CHUNK_SECTORS = 512;
+constexpr uint32_t C2_ERROR_SAMPLES = 64;
+
+// ISO9660 volume: system area, PVD, terminator, root directory, files
+constexpr uint32_t ISO_PVD_SECTOR = iso9660::SYSTEM_AREA_SIZE;
+constexpr uint32_t ISO_ROOT_SECTOR = ISO_PVD_SECTOR + 2;
+constexpr uint32_t ISO_FILES_SECTOR = ISO_ROOT_SECTOR + 1;
+
+
+struct GeneratorFile
+{
+	uint32_t sector;
+	uint32_t sectors;
+	const ImageLayout::File *file;
+};
+
+
+struct GeneratorTrack
+{
+	uint8_t number;
+	uint8_t control;
+	int32_t lba_index0;
+	int32_t lba_index1;
+	int32_t lba_end;
+	const ImageLayout::Track *track;
+
+	// ISO9660 descriptors, only for data tracks
+	std::vector<uint8_t> pvd;
+	std::vector<uint8_t> root;
+	std::vector<GeneratorFile> files;
+};
+
+
+struct GeneratorSession
+{
+	uint8_t number;
+	std::vector<GeneratorTrack> tracks;
+	int32_t lba_leadin;
+	int32_t lba_leadout;
+	int32_t lba_end;
+};
+
+
+struct GeneratorSegment
+{
+	enum class Type
+	{
+		LEADIN,
+		PREGAP,
+		PROGRAM,
+		LEADOUT
+	};
+
+	Type type;
+	int32_t lba_start;
+	int32_t lba_end;
+	// for lead-out, last session track
+	const GeneratorTrack *track;
+};
+
+
+struct GeneratorChunk
+{
+	int32_t lba;
+	uint32_t count;
+	int32_t write_offset;
+	// zero samples preceding the chunk, covers a gap after a positive offset shift
+	uint32_t gap;
+
+	std::vector<uint8_t> data;
+	std::vector<State> state;
+	std::vector<uint8_t> subcode;
+};
+
+
+struct GeneratorContext
+{
+	const ImageLayout &layout;
+	std::vector<GeneratorSession> sessions;
+	std::vector<GeneratorSegment> segments;
+
+	IntervalSet c2_ranges;
+	IntervalSet skip_ranges;
+	IntervalSet qerror_ranges;
+
+	Scrambler scrambler;
+
+	GeneratorContext(const ImageLayout &l)
+		: layout(l)
+	{
+		;
+	}
+};
+
+
+ImageLayout::ImageLayout()
+	: write_offset(0)
+	, seed(0)
+	, leadout_size(100)
+{
+	;
+}
+
+
+static bool layout_data_track(const ImageLayout::Track &track)
+{
+	return track.type != ImageLayout::TrackType::AUDIO;
+}
+
+
+ImageLayout image_layout_parse(const std::string &description)
+{
+	ImageLayout layout;
+	layout.sessions.emplace_back();
+
+	std::istringstream iss(description);
+	uint32_t line_number = 0;
+	for(std::string line; std::getline(iss, line);)
+	{
+		++line_number;
+
+		// comment, '#' inside of quoted string is allowed
+		bool quoted = false;
+		for(uint32_t i = 0; i < line.length(); ++i)
+		{
+			if(line[i] == '"')
+				quoted = !quoted;
+			else if(line[i] == '#' && !quoted)
+			{
+				line.erase(i);
+				break;
+			}
+		}
+
+		auto tokens = tokenize(line, " \t\r", "\"\"");
+		if(tokens.empty())
+			continue;
+
+		auto argument = [&](uint32_t index) -> const std::string &
+		{
+			if(index >= tokens.size())
+				throw_line(fmt::format("layout: missing argument (line: {}, directive: {})", line_number, tokens.front()));
+
+			return tokens[index];
+		};
+
+		auto integer = [&](uint32_t index) -> int32_t
+		{
+			auto &value = argument(index);
+
+			std::size_t end = 0;
+			int32_t integer = 0;
+			try
+			{
+				integer = std::stoi(value, &end);
+			}
+			catch(...)
+			{
+				end = 0;
+			}
+			if(!end || end != value.length())
+				throw_line(fmt::format("layout: invalid number (line: {}, value: {})", line_number, value));
+
+			return integer;
+		};
+
+		auto range = [&](std::vector<std::pair<int32_t, int32_t>> &ranges)
+		{
+			int32_t lba = integer(1);
+			int32_t count = tokens.size() > 2 ? integer(2) : 1;
+			if(count <= 0)
+				throw_line(fmt::format("layout: invalid range size (line: {})", line_number));
+
+			ranges.emplace_back(lba, lba + count);
+		};
+
+		auto &directive = tokens.front();
+		if(directive == "write_offset")
+			layout.write_offset = integer(1);
+		else if(directive == "seed")
+			layout.seed = (uint32_t)integer(1);
+		else if(directive == "leadout")
+			layout.leadout_size = (uint32_t)std::max(integer(1), 1);
+		else if(directive == "session")
+		{
+			if(layout.sessions.back().tracks.empty())
+				throw_line(fmt::format("layout: empty session (line: {})", line_number));
+
+			layout.sessions.emplace_back();
+		}
+		else if(directive == "track")
+		{
+			ImageLayout::Track track;
+			track.type = string_to_enum(argument(1), TRACK_TYPE_STRING);
+			int32_t sectors = integer(2);
+			if(sectors <= 0)
+				throw_line(fmt::format("layout: invalid track size (line: {})", line_number));
+			track.sectors = sectors;
+			track.index0 = 0;
+
+			for(uint32_t i = 3; i < tokens.size(); i += 2)
+			{
+				if(tokens[i] == "index0")
+				{
+					if(layout.sessions.back().tracks.empty())
+						throw_line(fmt::format("layout: first session track pre-gap is fixed (line: {})", line_number));
+
+					track.index0 = (uint32_t)std::max(integer(i + 1), 0);
+				}
+				else
+					throw_line(fmt::format("layout: unknown track option (line: {}, option: {})", line_number, tokens[i]));
+			}
+
+			layout.sessions.back().tracks.push_back(track);
+		}
+		else if(directive == "file")
+		{
+			auto &tracks = layout.sessions.back().tracks;
+			if(tracks.empty() || !layout_data_track(tracks.back()))
+				throw_line(fmt::format("layout: file has to follow a data track (line: {})", line_number));
+
+			ImageLayout::File file;
+			file.name = str_uppercase(argument(1));
+			file.head = tokens.size() > 3 ? argument(3) : "";
+			file.size = std::max((uint32_t)std::max(integer(2), 0), (uint32_t)file.head.length());
+
+			tracks.back().files.push_back(file);
+		}
+		else if(directive == "offset_shift")
+			layout.offset_shifts.emplace_back(integer(1), integer(2));
+		else if(directive == "c2")
+			range(layout.c2_ranges);
+		else if(directive == "skip")
+			range(layout.skip_ranges);
+		else if(directive == "qerror")
+			range(layout.qerror_ranges);
+		else if(directive == "noise")
+		{
+			int32_t samples = tokens.size() > 2 ? integer(2) : 1;
+			if(samples <= 0 || samples > (int32_t)CD_DATA_SIZE_SAMPLES)
+				throw_line(fmt::format("layout: invalid noise size (line: {})", line_number));
+
+			layout.noise[integer(1)] = (uint32_t)samples;
+		}
+		else if(directive == "cdtext")
+		{
+			int32_t track_number = integer(1);
+			if(track_number < 0 || track_number >= (int32_t)CD_TRACKS_COUNT)
+				throw_line(fmt::format("layout: invalid CD-TEXT track number (line: {})", line_number));
+
+			auto &cd_text = layout.cd_text[track_number];
+			if(argument(2) == "title")
+				cd_text.title = argument(3);
+			else if(argument(2) == "performer")
+				cd_text.performer = argument(3);
+			else
+				throw_line(fmt::format("layout: unknown CD-TEXT field (line: {}, field: {})", line_number, argument(2)));
+		}
+		else
+			throw_line(fmt::format("layout: unknown directive (line: {}, directive: {})", line_number, directive));
+	}
+
+	if(layout.sessions.back().tracks.empty())
+		throw_line("layout: no tracks");
+
+	std::sort(layout.offset_shifts.begin(), layout.offset_shifts.end());
+
+	return layout;
+}
+
+
+ImageLayout image_layout_load(const std::filesystem::path &layout_path)
+{
+	auto data = read_vector(layout_path);
+
+	return image_layout_parse(std::string(data.begin(), data.end()));
+}
+
+
+static uint64_t generator_hash(uint64_t value)
+{
+	// splitmix64 finalizer
+	value += 0x9E3779B97F4A7C15;
+	value = (value ^ value >> 30) * 0xBF58476D1CE4E5B9;
+	value = (value ^ value >> 27) * 0x94D049BB133111EB;
+
+	return value ^ value >> 31;
+}
+
+
+static uint64_t generator_sector_seed(const ImageLayout &layout, int32_t lba)
+{
+	return generator_hash((uint64_t)layout.seed << 32 | (uint32_t)lba);
+}
+
+
+static void generator_fill(uint8_t *data, uint32_t size, uint64_t seed)
+{
+	for(uint32_t i = 0; i < size; i += sizeof(seed))
+	{
+		seed = generator_hash(seed);
+		memcpy(data + i, &seed, std::min((uint32_t)sizeof(seed), size - i));
+	}
+}
+
+
+static iso9660::uint64_lsb_msb iso_both32(uint32_t value)
+{
+	return iso9660::uint64_lsb_msb{ value, endian_swap(value) };
+}
+
+
+static iso9660::uint32_lsb_msb iso_both16(uint16_t value)
+{
+	return iso9660::uint32_lsb_msb{ value, endian_swap(value) };
+}
+
+
+static void iso_directory_record(std::vector<uint8_t> &directory, const std::string &identifier, uint32_t offset, uint32_t size, bool is_directory)
+{
+	uint8_t length = sizeof(iso9660::DirectoryRecord) + identifier.length();
+	length += length % 2;
+
+	std::vector<uint8_t> record(length);
+	auto &dr = *(iso9660::DirectoryRecord *)record.data();
+	dr.length = length;
+	dr.offset = iso_both32(offset);
+	dr.data_length = iso_both32(size);
+	dr.recording_date_time = iso9660::RecordingDateTime{ 100, 1, 1, 0, 0, 0, 0 };
+	dr.file_flags = is_directory ? (uint8_t)iso9660::DirectoryRecord::FileFlags::DIRECTORY : 0;
+	dr.volume_sequence_number = 1 | (uint32_t)endian_swap((uint16_t)1) << 16;
+	dr.file_identifier_length = identifier.length();
+	memcpy(record.data() + sizeof(iso9660::DirectoryRecord), identifier.data(), identifier.length());
+
+	directory.insert(directory.end(), record.begin(), record.end());
+}
+
+
+static void iso_format(GeneratorTrack &track)
+{
+	uint32_t volume_size = track.track->sectors;
+
+	uint32_t sector = ISO_FILES_SECTOR;
+	for(auto const &f : track.track->files)
+	{
+		uint32_t sectors = std::max(scale_up(f.size, FORM1_DATA_SIZE), 1U);
+		track.files.push_back(GeneratorFile{ sector, sectors, &f });
+		sector += sectors;
+	}
+	if(sector > volume_size)
+		throw_line(fmt::format("layout: files don't fit the track (track: {}, required: {}, available: {})", track.number, sector, volume_size));
+
+	// root directory
+	track.root.clear();
+	iso_directory_record(track.root, std::string(1, (char)iso9660::Characters::DIR_CURRENT), track.lba_index1 + ISO_ROOT_SECTOR, FORM1_DATA_SIZE, true);
+	iso_directory_record(track.root, std::string(1, (char)iso9660::Characters::DIR_PARENT), track.lba_index1 + ISO_ROOT_SECTOR, FORM1_DATA_SIZE, true);
+	for(auto const &f : track.files)
+		iso_directory_record(track.root, f.file->name + ";1", track.lba_index1 + f.sector, f.file->size, false);
+	if(track.root.size() > FORM1_DATA_SIZE)
+		throw_line(fmt::format("layout: too many files (track: {})", track.number));
+	track.root.resize(FORM1_DATA_SIZE);
+
+	// primary volume descriptor
+	track.pvd.assign(FORM1_DATA_SIZE, 0);
+	auto &pvd = *(iso9660::VolumeDescriptor *)track.pvd.data();
+	pvd.type = iso9660::VolumeDescriptor::Type::PRIMARY;
+	memcpy(pvd.standard_identifier, iso9660::STANDARD_INDENTIFIER, sizeof(pvd.standard_identifier));
+	pvd.version = 1;
+	memset(pvd.primary.system_identifier, ' ', sizeof(pvd.primary.system_identifier));
+	memset(pvd.primary.volume_identifier, ' ', sizeof(pvd.primary.volume_identifier));
+	memcpy(pvd.primary.volume_identifier, "REDUMPER", 8);
+	pvd.primary.volume_space_size = iso_both32(volume_size);
+	pvd.primary.volume_set_size = iso_both16(1);
+	pvd.primary.volume_sequence_number = iso_both16(1);
+	pvd.primary.logical_block_size = iso_both16(FORM1_DATA_SIZE);
+	memcpy(&pvd.primary.root_directory_record, track.root.data(), sizeof(pvd.primary.root_directory_record) + 1);
+	pvd.primary.file_structure_version = 1;
+}
+
+
+static void iso_user_data(uint8_t *user_data, const GeneratorTrack &track, int32_t lba, uint64_t seed)
+{
+	auto sector = (uint32_t)(lba - track.lba_index1);
+
+	// system area is zeroed
+	if(sector < ISO_PVD_SECTOR)
+		;
+	else if(sector == ISO_PVD_SECTOR)
+		memcpy(user_data, track.pvd.data(), FORM1_DATA_SIZE);
+	else if(sector == ISO_PVD_SECTOR + 1)
+	{
+		auto &vd = *(iso9660::VolumeDescriptor *)user_data;
+		memset(user_data, 0, FORM1_DATA_SIZE);
+		vd.type = iso9660::VolumeDescriptor::Type::SET_TERMINATOR;
+		memcpy(vd.standard_identifier, iso9660::STANDARD_INDENTIFIER, sizeof(vd.standard_identifier));
+		vd.version = 1;
+	}
+	else if(sector == ISO_ROOT_SECTOR)
+		memcpy(user_data, track.root.data(), FORM1_DATA_SIZE);
+	else
+	{
+		generator_fill(user_data, FORM1_DATA_SIZE, seed);
+
+		for(auto const &f : track.files)
+			if(sector >= f.sector && sector < f.sector + f.sectors)
+			{
+				uint32_t offset = (sector - f.sector) * FORM1_DATA_SIZE;
+				if(offset < f.file->head.length())
+					memcpy(user_data, f.file->head.data() + offset, std::min((uint32_t)f.file->head.length() - offset, FORM1_DATA_SIZE));
+
+				// file slack is zeroed
+				if(offset + FORM1_DATA_SIZE > f.file->size)
+				{
+					uint32_t size = offset < f.file->size ? f.file->size - offset : 0;
+					memset(user_data + size, 0, FORM1_DATA_SIZE - size);
+				}
+				break;
+			}
+	}
+}
+
+
+static void generate_data_sector(uint8_t *data, int32_t lba, ImageLayout::TrackType type, const GeneratorTrack *track, uint64_t seed)
+{
+	auto &sector = *(Sector *)data;
+	memset(data, 0, CD_DATA_SIZE);
+	memcpy(sector.sync, CD_DATA_SYNC, sizeof(CD_DATA_SYNC));
+	sector.header.address = LBA_to_BCDMSF(lba);
+
+	if(type == ImageLayout::TrackType::MODE1)
+	{
+		sector.header.mode = 1;
+		if(track != nullptr)
+			iso_user_data(sector.mode1.user_data, *track, lba, seed);
+		sector.mode1.edc = EDC().ComputeBlock(0, data, offsetof(Sector, mode1.edc));
+		sector.mode1.ecc = ECC().Generate(sector, false);
+	}
+	else
+	{
+		sector.header.mode = 2;
+
+		// volume descriptors and files are always form 1
+		bool form2 = type == ImageLayout::TrackType::MODE2_FORM2 || track == nullptr;
+		if(track != nullptr)
+		{
+			auto sector_index = (uint32_t)(lba - track->lba_index1);
+			if(sector_index <= ISO_ROOT_SECTOR || (!track->files.empty() && sector_index < track->files.back().sector + track->files.back().sectors))
+				form2 = false;
+		}
+
+		auto &sub_header = sector.mode2.xa.sub_header;
+		sub_header.submode = form2 ? (uint8_t)CDXAMode::FORM2 : (uint8_t)CDXAMode::DATA;
+		sector.mode2.xa.sub_header_copy = sub_header;
+
+		if(form2)
+		{
+			if(track != nullptr)
+				generator_fill(sector.mode2.xa.form2.user_data, FORM2_DATA_SIZE, seed);
+			sector.mode2.xa.form2.edc = EDC().ComputeBlock(0, (uint8_t *)&sub_header, offsetof(Sector, mode2.xa.form2.edc) - offsetof(Sector, mode2.xa.sub_header));
+		}
+		else
+		{
+			if(track != nullptr)
+				iso_user_data(sector.mode2.xa.form1.user_data, *track, lba, seed);
+			sector.mode2.xa.form1.edc = EDC().ComputeBlock(0, (uint8_t *)&sub_header, offsetof(Sector, mode2.xa.form1.edc) - offsetof(Sector, mode2.xa.sub_header));
+			sector.mode2.xa.form1.ecc = ECC().Generate(sector, true);
+		}
+	}
+}
+
+
+static ChannelQ generate_q(const GeneratorSegment &segment, int32_t lba)
+{
+	ChannelQ Q;
+	memset(&Q, 0, sizeof(Q));
+
+	auto &t = *segment.track;
+
+	// relative time counts down to index 1 in the pre-gap
+	int32_t relative;
+	if(segment.type == GeneratorSegment::Type::LEADOUT)
+	{
+		Q.mode1.tno = CD_LEADOUT_TRACK_NUMBER;
+		Q.mode1.index = 1;
+		relative = lba - segment.lba_start;
+	}
+	else
+	{
+		Q.mode1.tno = bcd_encode(t.number);
+		Q.mode1.index = segment.type == GeneratorSegment::Type::PREGAP ? 0 : 1;
+		relative = segment.type == GeneratorSegment::Type::PREGAP ? t.lba_index1 - lba : lba - t.lba_index1;
+	}
+
+	Q.control_adr = t.control << 4 | 1;
+	Q.mode1.msf = LBA_to_BCDMSF(relative + MSF_LBA_SHIFT);
+	Q.mode1.a_msf = LBA_to_BCDMSF(lba);
+	Q.crc = endian_swap(crc16_gsm(Q.raw, sizeof(Q.raw)));
+
+	return Q;
+}
+
+
+static void generate_subcode(uint8_t *subcode, const ChannelQ &Q, bool pause)
+{
+	auto q = (const uint8_t *)&Q;
+	for(uint32_t i = 0; i < CD_SUBCODE_SIZE; ++i)
+		subcode[i] = (q[i / CHAR_BIT] >> (CHAR_BIT - 1 - i % CHAR_BIT) & 1) << (uint8_t)Subchannel::Q | (pause ? 1 : 0) << (uint8_t)Subchannel::P;
+}
+
+
+static void generator_geometry(GeneratorContext &context)
+{
+	auto &layout = context.layout;
+
+	uint8_t track_number = 1;
+	int32_t lba = MSF_LBA_SHIFT;
+	for(uint32_t i = 0; i < layout.sessions.size(); ++i)
+	{
+		auto &s = context.sessions.emplace_back();
+		s.number = i + 1;
+
+		s.lba_leadin = lba;
+		if(i)
+		{
+			context.segments.push_back(GeneratorSegment{ GeneratorSegment::Type::LEADIN, lba, lba + (int32_t)LEADIN_SIZE, nullptr });
+			lba += LEADIN_SIZE;
+		}
+
+		for(auto const &lt : layout.sessions[i].tracks)
+		{
+			if(track_number >= CD_TRACKS_COUNT)
+				throw_line("layout: too many tracks");
+
+			auto &t = s.tracks.emplace_back();
+			t.number = track_number++;
+			t.control = layout_data_track(lt) ? (uint8_t)ChannelQ::Control::DATA : 0;
+			t.track = &lt;
+			t.lba_index0 = lba;
+			t.lba_index1 = lba + (s.tracks.size() == 1 ? CD_PREGAP_SIZE : lt.index0);
+			t.lba_end = t.lba_index1 + lt.sectors;
+			lba = t.lba_end;
+		}
+
+		s.lba_leadout = lba;
+		s.lba_end = lba + (i + 1 == layout.sessions.size() ? layout.leadout_size : (i ? LEADOUT_SIZE_NEXT : LEADOUT_SIZE_FIRST));
+		lba = s.lba_end;
+	}
+
+	// segments reference tracks, fill them once sessions are complete
+	for(auto &s : context.sessions)
+	{
+		for(auto &t : s.tracks)
+		{
+			if(layout_data_track(*t.track))
+				iso_format(t);
+
+			if(t.lba_index1 > t.lba_index0)
+				context.segments.push_back(GeneratorSegment{ GeneratorSegment::Type::PREGAP, t.lba_index0, t.lba_index1, &t });
+			context.segments.push_back(GeneratorSegment{ GeneratorSegment::Type::PROGRAM, t.lba_index1, t.lba_end, &t });
+		}
+		context.segments.push_back(GeneratorSegment{ GeneratorSegment::Type::LEADOUT, s.lba_leadout, s.lba_end, &s.tracks.back() });
+	}
+
+	std::sort(context.segments.begin(), context.segments.end(), [](const GeneratorSegment &a, const GeneratorSegment &b) { return a.lba_start < b.lba_start; });
+}
+
+
+static int32_t generator_write_offset(const ImageLayout &layout, int32_t lba)
+{
+	int32_t write_offset = layout.write_offset;
+	for(auto const &s : layout.offset_shifts)
+		if(s.first <= lba)
+			write_offset += s.second;
+
+	return write_offset;
+}
+
+
+static void generate_chunk(GeneratorChunk &chunk, const GeneratorContext &context)
+{
+	chunk.data.assign((uint64_t)chunk.gap * CD_SAMPLE_SIZE + chunk.count * CD_DATA_SIZE, 0);
+	chunk.state.assign(chunk.gap + chunk.count * CD_DATA_SIZE_SAMPLES, State::SUCCESS);
+	chunk.subcode.assign(chunk.count * CD_SUBCODE_SIZE, 0);
+
+	auto segment = std::upper_bound(context.segments.begin(), context.segments.end(), chunk.lba, [](int32_t lba, const GeneratorSegment &s) { return lba < s.lba_start; }) - 1;
+
+	IntervalSet::Cursor c2_cursor(context.c2_ranges);
+	IntervalSet::Cursor skip_cursor(context.skip_ranges);
+	IntervalSet::Cursor qerror_cursor(context.qerror_ranges);
+
+	for(uint32_t i = 0; i < chunk.count; ++i)
+	{
+		int32_t lba = chunk.lba + i;
+		for(; lba >= segment->lba_end; ++segment)
+			;
+
+		uint8_t *data = &chunk.data[(uint64_t)chunk.gap * CD_SAMPLE_SIZE + i * CD_DATA_SIZE];
+		State *state = &chunk.state[chunk.gap + i * CD_DATA_SIZE_SAMPLES];
+		uint8_t *subcode = &chunk.subcode[i * CD_SUBCODE_SIZE];
+
+		if(skip_cursor.Find(lba) != nullptr)
+		{
+			std::fill_n(state, CD_DATA_SIZE_SAMPLES, State::ERROR_SKIP);
+			continue;
+		}
+
+		auto &t = *segment->track;
+		uint64_t seed = generator_sector_seed(context.layout, lba);
+
+		// pre-gap and lead-out are zeroed
+		if(t.control & (uint8_t)ChannelQ::Control::DATA)
+		{
+			generate_data_sector(data, lba, t.track->type, segment->type == GeneratorSegment::Type::PROGRAM ? &t : nullptr, seed);
+			context.scrambler.Process(data, data);
+		}
+		else if(segment->type == GeneratorSegment::Type::PROGRAM)
+			generator_fill(data, CD_DATA_SIZE, seed);
+
+		auto Q = generate_q(*segment, lba);
+		if(qerror_cursor.Find(lba) != nullptr)
+			Q.crc ^= 0xFFFF;
+		generate_subcode(subcode, Q, segment->type != GeneratorSegment::Type::PROGRAM);
+
+		if(c2_cursor.Find(lba) != nullptr)
+		{
+			uint32_t sample = generator_hash(seed) % (CD_DATA_SIZE_SAMPLES - C2_ERROR_SAMPLES);
+			std::fill_n(state + sample, C2_ERROR_SAMPLES, State::ERROR_C2);
+			for(uint32_t j = sample * CD_SAMPLE_SIZE; j < (sample + C2_ERROR_SAMPLES) * CD_SAMPLE_SIZE; ++j)
+				data[j] ^= 0x55;
+		}
+
+		if(auto n = context.layout.noise.find(lba); n != context.layout.noise.end())
+			for(uint32_t j = 0; j < n->second * CD_SAMPLE_SIZE; ++j)
+				data[j] ^= 0xAA;
+	}
+}
+
+
+static void write_chunk(std::fstream &scm_fs, std::fstream &state_fs, std::fstream &sub_fs, const GeneratorChunk &chunk)
+{
+	int32_t index = chunk.lba - LBA_START;
+	int32_t sample = index * (int32_t)CD_DATA_SIZE_SAMPLES + chunk.write_offset - (int32_t)chunk.gap;
+
+	// the whole chunk is a single entry positioned by the offset
+	write_entry(scm_fs, chunk.data.data(), (uint32_t)chunk.data.size(), 0, 1, -sample * CD_SAMPLE_SIZE);
+	write_entry(state_fs, (uint8_t *)chunk.state.data(), (uint32_t)chunk.state.size(), 0, 1, -sample);
+	write_entry(sub_fs, chunk.subcode.data(), CD_SUBCODE_SIZE, index, chunk.count, 0);
+}
+
+
+static std::vector<uint8_t> generate_toc(const GeneratorContext &context)
+{
+	std::vector<uint8_t> toc_buffer(sizeof(READ_TOC_Response));
+
+	auto descriptor = [&toc_buffer](const GeneratorTrack &t, uint8_t track_number, int32_t lba)
+	{
+		TOC_Descriptor d = {};
+		d.adr = 1;
+		d.control = t.control;
+		d.track_number = track_number;
+		d.track_start_address = endian_swap((uint32_t)lba);
+		toc_buffer.insert(toc_buffer.end(), (uint8_t *)&d, (uint8_t *)&d + sizeof(d));
+	};
+
+	for(auto const &s : context.sessions)
+		for(auto const &t : s.tracks)
+			descriptor(t, t.number, t.lba_index1);
+	descriptor(context.sessions.back().tracks.back(), CD_LEADOUT_TRACK_NUMBER, context.sessions.back().lba_leadout);
+
+	auto &response = *(READ_TOC_Response *)toc_buffer.data();
+	response.data_length = endian_swap((uint16_t)(toc_buffer.size() - sizeof(response.data_length)));
+	response.fields[0] = context.sessions.front().tracks.front().number;
+	response.fields[1] = context.sessions.back().tracks.back().number;
+
+	return toc_buffer;
+}
+
+
+static std::vector<uint8_t> generate_full_toc(const GeneratorContext &context)
+{
+	std::vector<uint8_t> toc_buffer(sizeof(READ_TOC_Response));
+
+	auto disc_type = TOC::DiscType::CD_DA;
+	for(auto const &s : context.layout.sessions)
+		for(auto const &t : s.tracks)
+			if(t.type == ImageLayout::TrackType::MODE2_FORM1 || t.type == ImageLayout::TrackType::MODE2_FORM2)
+				disc_type = TOC::DiscType::CD_XA;
+
+	for(auto const &s : context.sessions)
+	{
+		auto descriptor = [&toc_buffer, &s](const GeneratorTrack &t, uint8_t point, MSF p_msf)
+		{
+			FULL_TOC_Descriptor d = {};
+			d.session_number = s.number;
+			d.adr = 1;
+			d.control = t.control;
+			d.point = point;
+			memcpy(d.p_msf, p_msf.raw, sizeof(d.p_msf));
+			toc_buffer.insert(toc_buffer.end(), (uint8_t *)&d, (uint8_t *)&d + sizeof(d));
+		};
+
+		descriptor(s.tracks.front(), 0xA0, MSF{ s.tracks.front().number, (uint8_t)disc_type, 0 });
+		descriptor(s.tracks.back(), 0xA1, MSF{ s.tracks.back().number, 0, 0 });
+		descriptor(s.tracks.back(), 0xA2, LBA_to_MSF(s.lba_leadout));
+		for(auto const &t : s.tracks)
+			descriptor(t, t.number, LBA_to_MSF(t.lba_index1));
+	}
+
+	auto &response = *(READ_TOC_Response *)toc_buffer.data();
+	response.data_length = endian_swap((uint16_t)(toc_buffer.size() - sizeof(response.data_length)));
+	response.fields[0] = context.sessions.front().number;
+	response.fields[1] = context.sessions.back().number;
+
+	return toc_buffer;
+}
+
+
+static std::vector<uint8_t> generate_cd_text(const GeneratorContext &context)
+{
+	// mirrors private TOC::BlockSizeInfo
+	struct BlockSizeInfo
+	{
+		uint8_t character_code;
+		uint8_t first_track;
+		uint8_t last_track;
+		uint8_t copyright;
+		uint8_t pack_count[16];
+		uint8_t sequence_number[8];
+		uint8_t language_code[8];
+	};
+
+	constexpr uint8_t PACK_TYPE_TITLE = 0x80;
+	constexpr uint8_t PACK_TYPE_PERFORMER = 0x81;
+	constexpr uint8_t PACK_TYPE_SIZE_INFO = 0x8F;
+	constexpr uint8_t LANGUAGE_ENGLISH = 0x09;
+
+	uint8_t first_track = context.sessions.front().tracks.front().number;
+	uint8_t last_track = context.sessions.back().tracks.back().number;
+
+	std::vector<CD_TEXT_Descriptor> packs;
+	auto pack_add = [&packs](CD_TEXT_Descriptor &pack)
+	{
+		pack.sequence_number = (uint8_t)packs.size();
+		pack.crc = endian_swap(crc16_gsm((uint8_t *)&pack, sizeof(pack) - sizeof(pack.crc)));
+		packs.push_back(pack);
+	};
+
+	BlockSizeInfo bsi = {};
+	for(auto pack_type : { PACK_TYPE_TITLE, PACK_TYPE_PERFORMER })
+	{
+		// disc entry followed by every track entry, each is null terminated
+		std::string text;
+		std::vector<uint8_t> text_track;
+		std::vector<uint8_t> text_position;
+		for(uint8_t track_number = 0; track_number <= last_track; track_number = track_number ? track_number + 1 : first_track)
+		{
+			std::string entry;
+			auto it = context.layout.cd_text.find(track_number);
+			if(it != context.layout.cd_text.end())
+				entry = pack_type == PACK_TYPE_TITLE ? it->second.title : it->second.performer;
+
+			for(uint32_t i = 0; i <= entry.length(); ++i)
+			{
+				text_track.push_back(track_number);
+				text_position.push_back(std::min(i, 15U));
+			}
+			text += entry;
+			text += '\0';
+		}
+
+		bool empty = true;
+		for(auto c : text)
+			if(c != '\0')
+				empty = false;
+		if(empty)
+			continue;
+
+		uint32_t packs_count = 0;
+		for(uint32_t i = 0; i < text.length(); i += sizeof(CD_TEXT_Descriptor::text))
+		{
+			CD_TEXT_Descriptor pack = {};
+			pack.pack_type = pack_type;
+			pack.track_number = text_track[i];
+			pack.character_position = text_position[i];
+			memcpy(pack.text, text.data() + i, std::min((uint32_t)sizeof(pack.text), (uint32_t)text.length() - i));
+			pack_add(pack);
+			++packs_count;
+		}
+		bsi.pack_count[pack_type - PACK_TYPE_TITLE] = packs_count;
+	}
+
+	if(packs.empty())
+		return std::vector<uint8_t>();
+
+	constexpr uint32_t bsi_packs = sizeof(BlockSizeInfo) / sizeof(CD_TEXT_Descriptor::text);
+	bsi.character_code = 0;
+	bsi.first_track = first_track;
+	bsi.last_track = last_track;
+	bsi.pack_count[PACK_TYPE_SIZE_INFO - PACK_TYPE_TITLE] = bsi_packs;
+	bsi.sequence_number[0] = (uint8_t)(packs.size() + bsi_packs - 1);
+	bsi.language_code[0] = LANGUAGE_ENGLISH;
+	for(uint32_t i = 0; i < bsi_packs; ++i)
+	{
+		CD_TEXT_Descriptor pack = {};
+		pack.pack_type = PACK_TYPE_SIZE_INFO;
+		pack.track_number = i;
+		memcpy(pack.text, (uint8_t *)&bsi + i * sizeof(pack.text), sizeof(pack.text));
+		pack_add(pack);
+	}
+
+	std::vector<uint8_t> cd_text_buffer(sizeof(READ_TOC_Response));
+	cd_text_buffer.insert(cd_text_buffer.end(), (uint8_t *)packs.data(), (uint8_t *)(packs.data() + packs.size()));
+	auto &response = *(READ_TOC_Response *)cd_text_buffer.data();
+	response.data_length = endian_swap((uint16_t)(cd_text_buffer.size() - sizeof(response.data_length)));
+
+	return cd_text_buffer;
+}
+
+
+void image_generate(const std::string &image_prefix, const ImageLayout &layout, uint32_t threads_count)
+{
+	GeneratorContext context(layout);
+	generator_geometry(context);
+	context.c2_ranges = IntervalSet(layout.c2_ranges);
+	context.skip_ranges = IntervalSet(layout.skip_ranges);
+	context.qerror_ranges = IntervalSet(layout.qerror_ranges);
+
+	std::filesystem::path scm_path(image_prefix + ".scram");
+	std::filesystem::path state_path(image_prefix + ".state");
+	std::filesystem::path sub_path(image_prefix + ".subcode");
+	std::filesystem::path toc_path(image_prefix + ".toc");
+	std::filesystem::path fulltoc_path(image_prefix + ".fulltoc");
+	std::filesystem::path cdtext_path(image_prefix + ".cdtext");
+
+	int32_t lba_end = context.sessions.back().lba_end;
+	uint32_t sectors_count = lba_end - LBA_START;
+
+	// chunks don't cross segments and offset shifts
+	std::vector<GeneratorChunk> chunks;
+	int32_t write_offset = generator_write_offset(layout, context.segments.front().lba_start);
+	for(auto const &s : context.segments)
+	{
+		if(s.type == GeneratorSegment::Type::LEADIN)
+			continue;
+
+		for(int32_t lba = s.lba_start; lba < s.lba_end;)
+		{
+			int32_t lba_next = std::min(lba + (int32_t)GENERATOR_CHUNK_SECTORS, s.lba_end);
+			for(auto const &o : layout.offset_shifts)
+				if(o.first > lba && o.first < lba_next)
+					lba_next = o.first;
+
+			GeneratorChunk chunk;
+			chunk.lba = lba;
+			chunk.count = lba_next - lba;
+			chunk.write_offset = generator_write_offset(layout, lba);
+			chunk.gap = std::max(chunk.write_offset - write_offset, 0);
+			write_offset = chunk.write_offset;
+			chunks.push_back(chunk);
+
+			lba = lba_next;
+		}
+	}
+
+	{
+		std::fstream scm_fs(scm_path, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+		if(!scm_fs.is_open())
+			throw_line(fmt::format("unable to create file ({})", scm_path.filename().string()));
+		std::fstream state_fs(state_path, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+		if(!state_fs.is_open())
+			throw_line(fmt::format("unable to create file ({})", state_path.filename().string()));
+		std::fstream sub_fs(sub_path, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+		if(!sub_fs.is_open())
+			throw_line(fmt::format("unable to create file ({})", sub_path.filename().string()));
+
+		// sectors are generated out of order, written in order
+		ThreadPool pool(threads_count);
+		std::deque<std::future<void>> pending;
+		uint32_t written = 0;
+		for(uint32_t i = 0; i < chunks.size(); ++i)
+		{
+			auto &chunk = chunks[i];
+			pending.push_back(pool.Enqueue([&chunk, &context]() { generate_chunk(chunk, context); }));
+
+			for(; pending.size() > pool.ThreadsCount() * 2 || (i + 1 == chunks.size() && !pending.empty()); ++written)
+			{
+				pending.front().get();
+				pending.pop_front();
+
+				write_chunk(scm_fs, state_fs, sub_fs, chunks[written]);
+				chunks[written] = GeneratorChunk();
+			}
+		}
+	}
+
+	// unread lead-in is left sparse, tail samples pushed out by the write offset are cut
+	std::filesystem::resize_file(scm_path, (uint64_t)sectors_count * CD_DATA_SIZE);
+	std::filesystem::resize_file(state_path, (uint64_t)sectors_count * CD_DATA_SIZE_SAMPLES);
+	std::filesystem::resize_file(sub_path, (uint64_t)sectors_count * CD_SUBCODE_SIZE);
+
+	write_vector(toc_path, generate_toc(context));
+	write_vector(fulltoc_path, generate_full_toc(context));
+
+	auto cd_text_buffer = generate_cd_text(context);
+	if(cd_text_buffer.empty())
+		std::filesystem::remove(cdtext_path);
+	else
+		write_vector(cdtext_path, cd_text_buffer);
+}
+
+}
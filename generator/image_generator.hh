@@ -0,0 +1,81 @@
+#pragma once
+
+
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+
+namespace gpsxre
+{
+
+// synthetic disc description, LBA values are absolute, ranges are [first .. second)
+struct ImageLayout
+{
+	enum class TrackType
+	{
+		AUDIO,
+		MODE1,
+		MODE2_FORM1,
+		MODE2_FORM2
+	};
+
+	struct File
+	{
+		std::string name;
+		uint32_t size;
+		// file content starts with head, the rest is pseudo-random
+		std::string head;
+	};
+
+	struct Track
+	{
+		TrackType type;
+		uint32_t sectors;
+		// index 0 length, the pre-gap of the first session track is always CD_PREGAP_SIZE
+		uint32_t index0;
+		// data tracks are formatted as ISO9660 volume
+		std::vector<File> files;
+	};
+
+	struct Session
+	{
+		std::vector<Track> tracks;
+	};
+
+	struct CDText
+	{
+		std::string title;
+		std::string performer;
+	};
+
+	int32_t write_offset;
+	uint32_t seed;
+	uint32_t leadout_size;
+	std::vector<Session> sessions;
+	// LBA, write offset difference in samples applied from this LBA onwards
+	std::vector<std::pair<int32_t, int32_t>> offset_shifts;
+	std::vector<std::pair<int32_t, int32_t>> c2_ranges;
+	std::vector<std::pair<int32_t, int32_t>> skip_ranges;
+	std::vector<std::pair<int32_t, int32_t>> qerror_ranges;
+	// LBA, samples at the sector start altered while state stays good (misread not reported by C2)
+	std::map<int32_t, uint32_t> noise;
+	// track number, 0 is disc
+	std::map<uint8_t, CDText> cd_text;
+
+	ImageLayout();
+};
+
+ImageLayout image_layout_parse(const std::string &description);
+ImageLayout image_layout_load(const std::filesystem::path &layout_path);
+
+// writes .scram, .state, .subcode, .toc, .fulltoc and .cdtext (if provided) files as if dumped from a drive,
+// threads_count = 0 uses hardware concurrency
+void image_generate(const std::string &image_prefix, const ImageLayout &layout, uint32_t threads_count = 0);
+
+}
@@ -7,6 +7,7 @@
 #include <vector>
 #include "common.hh"
 #include "endian.hh"
+#include "profiler.hh"
 #include "scrambler.hh"
 #include "image_browser.hh"
 
@@ -338,6 +339,8 @@ bool ImageBrowser::Entry::IsInterleaved() const
 	static const uint32_t SECTORS_TO_ANALYZE = 8 * 4;
 
 	uint32_t offset = _directory_record.offset.lsb - _browser._trackLBA;
+
+	std::lock_guard<std::mutex> lock(_browser._mutex);
 	_browser._fs.seekg(_browser._fileStartOffset + offset * sizeof(Sector));
 
 	if(_browser._fs.fail())
@@ -387,6 +390,8 @@ bool ImageBrowser::Entry::IsInterleaved() const
 
 std::vector<uint8_t> ImageBrowser::Entry::Read(bool form2, bool throw_on_error)
 {
+	PROFILE_SCOPE("ImageBrowser::Entry::Read");
+
 	std::vector<uint8_t> data;
 
 	Scrambler scrambler;
@@ -395,6 +400,8 @@ std::vector<uint8_t> ImageBrowser::Entry::Read(bool form2, bool throw_on_error)
 	data.reserve(size);
 
 	uint32_t offset = _directory_record.offset.lsb - _browser._trackLBA;
+
+	std::lock_guard<std::mutex> lock(_browser._mutex);
 	_browser._fs.seekg(_browser._fileStartOffset + offset * sizeof(Sector));
 
 	if(_browser._fs.fail())
@@ -465,6 +472,50 @@ std::vector<uint8_t> ImageBrowser::Entry::Read(bool form2, bool throw_on_error)
 }
 
 
+std::vector<uint8_t> ImageBrowser::Entry::ReadRaw(uint32_t sector_offset, uint32_t sectors_count, bool throw_on_error)
+{
+	PROFILE_SCOPE("ImageBrowser::Entry::ReadRaw");
+
+	Scrambler scrambler;
+
+	std::vector<uint8_t> data(sectors_count * sizeof(Sector));
+
+	uint32_t offset = _directory_record.offset.lsb - _browser._trackLBA + sector_offset;
+
+	std::lock_guard<std::mutex> lock(_browser._mutex);
+	_browser._fs.seekg(_browser._fileStartOffset + offset * sizeof(Sector));
+
+	if(_browser._fs.fail())
+	{
+		_browser._fs.clear();
+		if(throw_on_error)
+			throw_line("seek failure");
+
+		data.clear();
+	}
+	else
+	{
+		_browser._fs.read((char *)data.data(), data.size());
+		if(_browser._fs.fail())
+		{
+			auto message(std::string("read failure [") + std::strerror(errno) + "]");
+			_browser._fs.clear();
+			if(throw_on_error)
+				throw_line(message);
+
+			// keep complete sectors only
+			data.resize(round_down((uint64_t)_browser._fs.gcount(), sizeof(Sector)));
+		}
+
+		if(_browser._scrambled)
+			for(uint32_t s = 0; s < data.size() / sizeof(Sector); ++s)
+				scrambler.Process(&data[s * sizeof(Sector)], &data[s * sizeof(Sector)]);
+	}
+
+	return data;
+}
+
+
 //TEMPORARY
 std::vector<uint8_t> ImageBrowser::Entry::Peek()
 {
@@ -472,6 +523,7 @@ std::vector<uint8_t> ImageBrowser::Entry::Peek()
 
 	Scrambler scrambler;
 
+	std::lock_guard<std::mutex> lock(_browser._mutex);
 	_browser._fs.seekg(_browser._fileStartOffset + _directory_record.offset.lsb * sizeof(Sector));
 	if(_browser._fs.fail())
 	{
@@ -663,6 +715,12 @@ uint32_t ImageBrowser::Entry::SectorSize() const
 }
 
 
+uint32_t ImageBrowser::Entry::Size() const
+{
+	return _directory_record.data_length.lsb;
+}
+
+
 bool ImageBrowser::Entry::DirectoryRecordValid(const iso9660::DirectoryRecord &dr) const
 {
 	bool valid =
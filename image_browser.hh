@@ -6,6 +6,7 @@
 #include <filesystem>
 #include <fstream>
 #include <list>
+#include <mutex>
 #include <queue>
 #include <string>
 #include "cd.hh"
@@ -35,8 +36,11 @@ public:
 
 		uint32_t SectorOffset() const;
 		uint32_t SectorSize() const;
+		uint32_t Size() const;
 
 		std::vector<uint8_t> Read(bool form2 = false, bool throw_on_error = false);
+		// extent sectors as raw (descrambled) sectors, short if a read fails
+		std::vector<uint8_t> ReadRaw(uint32_t sector_offset, uint32_t sectors_count, bool throw_on_error = false);
 		//DEBUG
 		std::vector<uint8_t> Peek();
 //		std::vector<uint8_t> Read(uint32_t data_offset, uint32_t size);
@@ -96,6 +100,8 @@ public:
 private:
 	std::fstream _fsProxy;
 	std::fstream &_fs;
+	// serializes seek / read pairs so that entries can be read from multiple threads
+	std::mutex _mutex;
 	uint64_t _fileStartOffset;
 	uint64_t _fileEndOffset;
 	bool _scrambled;
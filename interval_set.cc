@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <limits>
+#include "interval_set.hh"
+
+
+
+namespace gpsxre
+{
+
+IntervalSet::Cursor::Cursor(const IntervalSet &set)
+	: _set(set)
+	, _index(0)
+	, _value(std::numeric_limits<int32_t>::min())
+{
+	;
+}
+
+
+const IntervalSet::Interval *IntervalSet::Cursor::Find(int32_t value)
+{
+	auto const &intervals = _set._intervals;
+
+	if(value < _value)
+		_index = _set.UpperBound(value);
+	else
+		for(; _index < intervals.size() && intervals[_index].second <= value; ++_index)
+			;
+	_value = value;
+
+	return _index < intervals.size() && intervals[_index].first <= value ? &intervals[_index] : nullptr;
+}
+
+
+IntervalSet::IntervalSet(const std::vector<Interval> &intervals)
+{
+	for(auto const &i : intervals)
+		Add(i);
+}
+
+
+void IntervalSet::Add(const Interval &interval)
+{
+	if(interval.first >= interval.second)
+		return;
+
+	// first interval that ends at or after the new one starts
+	auto first = std::lower_bound(_intervals.begin(), _intervals.end(), interval.first, [](const Interval &i, int32_t v) { return i.second < v; });
+	// first interval that starts after the new one ends
+	auto last = std::upper_bound(first, _intervals.end(), interval.second, [](int32_t v, const Interval &i) { return v < i.first; });
+
+	Interval merged = interval;
+	if(first != last)
+	{
+		merged.first = std::min(merged.first, first->first);
+		merged.second = std::max(merged.second, std::prev(last)->second);
+	}
+
+	_intervals.insert(_intervals.erase(first, last), merged);
+}
+
+
+const IntervalSet::Interval *IntervalSet::Find(int32_t value) const
+{
+	uint32_t index = UpperBound(value);
+
+	return index < _intervals.size() && _intervals[index].first <= value ? &_intervals[index] : nullptr;
+}
+
+
+bool IntervalSet::Empty() const
+{
+	return _intervals.empty();
+}
+
+
+const std::vector<IntervalSet::Interval> &IntervalSet::Intervals() const
+{
+	return _intervals;
+}
+
+
+// index of the first interval that ends after value
+uint32_t IntervalSet::UpperBound(int32_t value) const
+{
+	return (uint32_t)(std::upper_bound(_intervals.begin(), _intervals.end(), value, [](int32_t v, const Interval &i) { return v < i.second; }) - _intervals.begin());
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+
+namespace gpsxre
+{
+
+// sorted set of non-overlapping [first .. second) intervals, overlapping and adjacent intervals are merged on insertion
+class IntervalSet
+{
+public:
+	typedef std::pair<int32_t, int32_t> Interval;
+
+	// sequential lookup helper, amortized O(1) for non-decreasing values, binary search otherwise
+	class Cursor
+	{
+	public:
+		Cursor(const IntervalSet &set);
+
+		const Interval *Find(int32_t value);
+
+	private:
+		const IntervalSet &_set;
+		uint32_t _index;
+		int32_t _value;
+	};
+
+	IntervalSet() = default;
+	IntervalSet(const std::vector<Interval> &intervals);
+
+	void Add(const Interval &interval);
+	const Interval *Find(int32_t value) const;
+
+	bool Empty() const;
+	const std::vector<Interval> &Intervals() const;
+
+private:
+	std::vector<Interval> _intervals;
+
+	uint32_t UpperBound(int32_t value) const;
+};
+
+}
@@ -0,0 +1,322 @@
+#include <cmath>
+#include <cstdlib>
+#include <fmt/format.h>
+#include "common.hh"
+#include "json.hh"
+
+
+
+namespace gpsxre
+{
+
+JSONValue::JSONValue()
+	: type(Type::NUL)
+	, boolean(false)
+	, number(0)
+{
+	;
+}
+
+
+const JSONValue *JSONValue::Member(const std::string &name) const
+{
+	if(type != Type::OBJECT)
+		return nullptr;
+
+	auto it = object.find(name);
+	return it == object.end() ? nullptr : &it->second;
+}
+
+
+static void json_skip_whitespace(const std::string &text, size_t &pos)
+{
+	while(pos < text.length() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n'))
+		++pos;
+}
+
+
+static void json_expect(const std::string &text, size_t &pos, const std::string &token)
+{
+	if(text.compare(pos, token.length(), token))
+		throw_line(fmt::format("JSON parse error, expected '{}' (position: {})", token, pos));
+	pos += token.length();
+}
+
+
+static void json_append_utf8(std::string &s, uint32_t code_point)
+{
+	if(code_point < 0x80)
+		s += (char)code_point;
+	else if(code_point < 0x800)
+	{
+		s += (char)(0xC0 | code_point >> 6);
+		s += (char)(0x80 | (code_point & 0x3F));
+	}
+	else if(code_point < 0x10000)
+	{
+		s += (char)(0xE0 | code_point >> 12);
+		s += (char)(0x80 | (code_point >> 6 & 0x3F));
+		s += (char)(0x80 | (code_point & 0x3F));
+	}
+	else
+	{
+		s += (char)(0xF0 | code_point >> 18);
+		s += (char)(0x80 | (code_point >> 12 & 0x3F));
+		s += (char)(0x80 | (code_point >> 6 & 0x3F));
+		s += (char)(0x80 | (code_point & 0x3F));
+	}
+}
+
+
+static uint32_t json_parse_hex4(const std::string &text, size_t &pos)
+{
+	if(pos + 4 > text.length())
+		throw_line(fmt::format("JSON parse error, unexpected end of string (position: {})", pos));
+
+	uint32_t value = 0;
+	for(uint32_t i = 0; i < 4; ++i)
+	{
+		char c = text[pos++];
+		value <<= 4;
+		if(c >= '0' && c <= '9')
+			value |= c - '0';
+		else if(c >= 'a' && c <= 'f')
+			value |= c - 'a' + 10;
+		else if(c >= 'A' && c <= 'F')
+			value |= c - 'A' + 10;
+		else
+			throw_line(fmt::format("JSON parse error, invalid escape sequence (position: {})", pos - 1));
+	}
+
+	return value;
+}
+
+
+static std::string json_parse_string(const std::string &text, size_t &pos)
+{
+	json_expect(text, pos, "\"");
+
+	std::string s;
+	for(;;)
+	{
+		if(pos >= text.length())
+			throw_line(fmt::format("JSON parse error, unterminated string (position: {})", pos));
+
+		char c = text[pos++];
+		if(c == '"')
+			break;
+		else if(c == '\\')
+		{
+			if(pos >= text.length())
+				throw_line(fmt::format("JSON parse error, unterminated string (position: {})", pos));
+
+			c = text[pos++];
+			switch(c)
+			{
+			case '"':
+			case '\\':
+			case '/':
+				s += c;
+				break;
+			case 'b':
+				s += '\b';
+				break;
+			case 'f':
+				s += '\f';
+				break;
+			case 'n':
+				s += '\n';
+				break;
+			case 'r':
+				s += '\r';
+				break;
+			case 't':
+				s += '\t';
+				break;
+			case 'u':
+			{
+				uint32_t code_point = json_parse_hex4(text, pos);
+				// surrogate pair
+				if(code_point >= 0xD800 && code_point < 0xDC00 && !text.compare(pos, 2, "\\u"))
+				{
+					pos += 2;
+					uint32_t low = json_parse_hex4(text, pos);
+					code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+				}
+				json_append_utf8(s, code_point);
+				break;
+			}
+			default:
+				throw_line(fmt::format("JSON parse error, invalid escape sequence (position: {})", pos - 1));
+			}
+		}
+		else if((uint8_t)c < 0x20)
+			throw_line(fmt::format("JSON parse error, control character in string (position: {})", pos - 1));
+		else
+			s += c;
+	}
+
+	return s;
+}
+
+
+static JSONValue json_parse_value(const std::string &text, size_t &pos, uint32_t depth)
+{
+	// protects the stack from hostile input
+	constexpr uint32_t DEPTH_MAX = 64;
+	if(depth > DEPTH_MAX)
+		throw_line("JSON parse error, nesting is too deep");
+
+	JSONValue value;
+
+	json_skip_whitespace(text, pos);
+	if(pos >= text.length())
+		throw_line(fmt::format("JSON parse error, unexpected end of input (position: {})", pos));
+
+	char c = text[pos];
+	if(c == '{')
+	{
+		value.type = JSONValue::Type::OBJECT;
+		++pos;
+
+		json_skip_whitespace(text, pos);
+		if(pos < text.length() && text[pos] == '}')
+			++pos;
+		else
+		{
+			for(;;)
+			{
+				json_skip_whitespace(text, pos);
+				auto name = json_parse_string(text, pos);
+				json_skip_whitespace(text, pos);
+				json_expect(text, pos, ":");
+				value.object[name] = json_parse_value(text, pos, depth + 1);
+
+				json_skip_whitespace(text, pos);
+				if(pos < text.length() && text[pos] == ',')
+					++pos;
+				else
+				{
+					json_expect(text, pos, "}");
+					break;
+				}
+			}
+		}
+	}
+	else if(c == '[')
+	{
+		value.type = JSONValue::Type::ARRAY;
+		++pos;
+
+		json_skip_whitespace(text, pos);
+		if(pos < text.length() && text[pos] == ']')
+			++pos;
+		else
+		{
+			for(;;)
+			{
+				value.array.push_back(json_parse_value(text, pos, depth + 1));
+
+				json_skip_whitespace(text, pos);
+				if(pos < text.length() && text[pos] == ',')
+					++pos;
+				else
+				{
+					json_expect(text, pos, "]");
+					break;
+				}
+			}
+		}
+	}
+	else if(c == '"')
+	{
+		value.type = JSONValue::Type::STRING;
+		value.string = json_parse_string(text, pos);
+	}
+	else if(c == 't')
+	{
+		json_expect(text, pos, "true");
+		value.type = JSONValue::Type::BOOLEAN;
+		value.boolean = true;
+	}
+	else if(c == 'f')
+	{
+		json_expect(text, pos, "false");
+		value.type = JSONValue::Type::BOOLEAN;
+		value.boolean = false;
+	}
+	else if(c == 'n')
+	{
+		json_expect(text, pos, "null");
+	}
+	else if(c == '-' || (c >= '0' && c <= '9'))
+	{
+		const char *start = text.c_str() + pos;
+		char *end = nullptr;
+		value.number = std::strtod(start, &end);
+		if(end == start || !std::isfinite(value.number))
+			throw_line(fmt::format("JSON parse error, invalid number (position: {})", pos));
+		value.type = JSONValue::Type::NUMBER;
+		pos += end - start;
+	}
+	else
+		throw_line(fmt::format("JSON parse error, unexpected character (position: {})", pos));
+
+	return value;
+}
+
+
+JSONValue json_parse(const std::string &text)
+{
+	size_t pos = 0;
+	auto value = json_parse_value(text, pos, 0);
+
+	json_skip_whitespace(text, pos);
+	if(pos != text.length())
+		throw_line(fmt::format("JSON parse error, trailing characters (position: {})", pos));
+
+	return value;
+}
+
+
+std::string json_string(const std::string &value)
+{
+	std::string s("\"");
+	for(auto c : value)
+	{
+		switch(c)
+		{
+		case '"':
+			s += "\\\"";
+			break;
+		case '\\':
+			s += "\\\\";
+			break;
+		case '\b':
+			s += "\\b";
+			break;
+		case '\f':
+			s += "\\f";
+			break;
+		case '\n':
+			s += "\\n";
+			break;
+		case '\r':
+			s += "\\r";
+			break;
+		case '\t':
+			s += "\\t";
+			break;
+		default:
+			if((uint8_t)c < 0x20)
+				s += fmt::format("\\u{:04x}", (uint8_t)c);
+			else
+				s += c;
+		}
+	}
+	s += '"';
+
+	return s;
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+
+namespace gpsxre
+{
+
+// minimal JSON document model used by the serve protocol
+struct JSONValue
+{
+	enum class Type
+	{
+		NUL,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+	Type type;
+	bool boolean;
+	double number;
+	std::string string;
+	std::vector<JSONValue> array;
+	std::map<std::string, JSONValue> object;
+
+	JSONValue();
+
+	// member lookup, nullptr if this is not an object or there is no such member
+	const JSONValue *Member(const std::string &name) const;
+};
+
+JSONValue json_parse(const std::string &text);
+// quoted and escaped JSON string
+std::string json_string(const std::string &value);
+
+}
@@ -0,0 +1,155 @@
+#include "cmd.hh"
+#include "common.hh"
+#include "file_io.hh"
+#include "logger.hh"
+#include "scsi.hh"
+#include "signal.hh"
+#include "library.hh"
+
+
+
+namespace gpsxre
+{
+
+// runs f with the calling thread log redirected to the callbacks
+template<typename F>
+static auto library_call(const LibraryCallbacks &callbacks, F f) -> decltype(f())
+{
+	// file messages can be partial lines, callback gets complete ones
+	std::string line;
+	auto flush = [&]()
+	{
+		if(callbacks.log)
+			callbacks.log(line);
+		line.clear();
+	};
+
+	LogRedirect log_redirect("", [&](const std::string &text, bool file)
+	{
+		if(file)
+		{
+			for(auto c : text)
+			{
+				if(c == '\n')
+					flush();
+				else
+					line += c;
+			}
+		}
+		else if(callbacks.progress)
+		{
+			int percent;
+			auto progress = log_progress_line(text, percent);
+			if(!progress.empty())
+				callbacks.progress(progress, percent);
+		}
+	});
+
+	// dump/refine stop on the calling thread as on Ctrl+C, the process SIGINT handler is left to the host
+	SignalCancel signal_cancel(callbacks.cancel);
+
+	try
+	{
+		auto result = f();
+		if(!line.empty())
+			flush();
+
+		return result;
+	}
+	catch(...)
+	{
+		if(!line.empty())
+			flush();
+		throw;
+	}
+}
+
+
+static Options library_validate(const Options &options, const std::string &mode)
+{
+	Options o(options);
+	o.positional = { mode };
+	validate_options(o);
+
+	return o;
+}
+
+
+std::vector<std::string> library_drives()
+{
+	auto drives = SPTD::ListDrives();
+
+	return std::vector<std::string>(drives.begin(), drives.end());
+}
+
+
+DriveConfig library_drive_open(Options &options, const LibraryCallbacks &callbacks)
+{
+	return library_call(callbacks, [&]()
+	{
+		options.drive = library_validate(options, "dump").drive;
+
+		SPTD sptd(options.drive);
+		DriveConfig drive_config = drive_get_config(cmd_drive_query(sptd));
+		drive_override_config(drive_config, options.drive_type.get(), options.drive_read_offset.get(), options.drive_c2_shift.get(), options.drive_pregap_start.get(),
+				options.drive_read_method.get(), options.drive_sector_order.get());
+		LOG("drive path: {}", options.drive);
+		LOG("drive: {}", drive_info_string(drive_config));
+		LOG("drive configuration: {}", drive_config_string(drive_config));
+
+		return drive_config;
+	});
+}
+
+
+TOC library_image_open(const Options &options, const LibraryCallbacks &callbacks)
+{
+	return library_call(callbacks, [&]()
+	{
+		if(options.image_name.empty())
+			throw_line("image name is not provided");
+
+		std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
+		uint32_t sectors_count = check_file(image_prefix + ".state", CD_DATA_SIZE_SAMPLES);
+
+		return toc_load(image_prefix, sectors_count, options);
+	});
+}
+
+
+DumpResult library_dump(Options &options, const LibraryCallbacks &callbacks)
+{
+	return library_call(callbacks, [&]()
+	{
+		auto o = library_validate(options, "dump");
+		options.drive = o.drive;
+		options.image_name = o.image_name;
+
+		return redumper_dump(options, false);
+	});
+}
+
+
+DumpResult library_refine(Options &options, const LibraryCallbacks &callbacks)
+{
+	return library_call(callbacks, [&]()
+	{
+		options.drive = library_validate(options, "refine").drive;
+
+		return redumper_dump(options, true);
+	});
+}
+
+
+SplitResult library_split(const Options &options, const LibraryCallbacks &callbacks)
+{
+	return library_call(callbacks, [&]() { return redumper_split(options); });
+}
+
+
+std::vector<std::string> library_info(const Options &options, const LibraryCallbacks &callbacks, ThreadPool *pool)
+{
+	return library_call(callbacks, [&]() { return redumper_info(options, pool); });
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "drive.hh"
+#include "options.hh"
+#include "redumper.hh"
+#include "split.hh"
+#include "toc.hh"
+
+
+
+namespace gpsxre
+{
+
+class ThreadPool;
+
+// in-process interface of the dump and split engines: nothing is written to the console or to the
+// global log, log lines and progress are delivered to the callbacks on the calling thread;
+// errors are reported as std::exception, calls from different threads are independent,
+// no signal handlers are installed (dump/refine are stopped with the cancel callback)
+struct LibraryCallbacks
+{
+	// complete log line, without new line
+	std::function<void(const std::string &line)> log;
+	// progress line and completion percentage, -1 if the line has none
+	std::function<void(const std::string &line, int percent)> progress;
+	// polled during dump/refine, returning true stops the dump the same way Ctrl+C does on the command line
+	std::function<bool()> cancel;
+};
+
+
+// drives available on the system
+std::vector<std::string> library_drives();
+
+// identifies the drive, options.drive (first ready drive if empty) and drive override options are used
+DriveConfig library_drive_open(Options &options, const LibraryCallbacks &callbacks = LibraryCallbacks());
+
+// TOC of a dump from options.image_path / options.image_name as split sees it (TOC, FULL TOC, subchannel Q and CD-TEXT)
+TOC library_image_open(const Options &options, const LibraryCallbacks &callbacks = LibraryCallbacks());
+
+// options are completed in place: drive is autodetected and image name is generated if not provided
+DumpResult library_dump(Options &options, const LibraryCallbacks &callbacks = LibraryCallbacks());
+DumpResult library_refine(Options &options, const LibraryCallbacks &callbacks = LibraryCallbacks());
+
+SplitResult library_split(const Options &options, const LibraryCallbacks &callbacks = LibraryCallbacks());
+
+// system analyzer outputs, tasks run on the pool if provided (must not be called from a task of the same pool)
+std::vector<std::string> library_info(const Options &options, const LibraryCallbacks &callbacks = LibraryCallbacks(), ThreadPool *pool = nullptr);
+
+}
@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
 #include "common.hh"
+#include "profiler.hh"
 #include "logger.hh"
 
 
@@ -7,6 +12,54 @@ namespace gpsxre
 {
 
 Logger Logger::_logger;
+thread_local LogRedirect *Logger::_redirect = nullptr;
+
+
+static void log_open(std::fstream &fs, const std::filesystem::path &log_path)
+{
+	auto pp = log_path.parent_path();
+	if(!pp.empty())
+		std::filesystem::create_directories(pp);
+
+	bool nl = false;
+	if(std::filesystem::exists(log_path))
+		nl = true;
+
+	fs.open(log_path, std::fstream::out | std::fstream::app);
+	if(fs.fail())
+		throw_line(fmt::format("unable to open file ({})", log_path.filename().string()));
+
+	if(nl)
+		fs << std::endl;
+
+	auto dt = system_date_time(" %F %T ");
+	fs << fmt::format("{}{}{}", std::string(3, '='), dt, std::string(80 - 3 - dt.length(), '=')) << std::endl;
+}
+
+
+Logger::Logger()
+	: _queue(QUEUE_CAPACITY)
+	, _pushed(0)
+	, _writerWaiting(false)
+	, _flushed(0)
+	, _stop(false)
+	, _writer(&Logger::Writer, this)
+{
+	;
+}
+
+
+Logger::~Logger()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_writerCV.notify_one();
+
+	// writer drains the queue before exiting
+	_writer.join();
+}
 
 
 bool Logger::Reset(std::filesystem::path log_path)
@@ -14,30 +67,15 @@ bool Logger::Reset(std::filesystem::path log_path)
 	bool reset = false;
 	if(_log_path != log_path)
 	{
+		// writer doesn't touch the file while the queue is empty
+		Sync();
+
 		_log_path = log_path;
 		if(_fs.is_open())
 			_fs.close();
 
 		if(!_log_path.empty())
-		{
-			auto pp = log_path.parent_path();
-			if(!pp.empty())
-				std::filesystem::create_directories(pp);
-
-			bool nl = false;
-			if(std::filesystem::exists(log_path))
-				nl = true;
-
-			_fs.open(log_path, std::fstream::out | std::fstream::app);
-			if(_fs.fail())
-				throw_line(fmt::format("unable to open file ({})", log_path.filename().string()));
-
-			if(nl)
-				_fs << std::endl;
-
-			auto dt = system_date_time(" %F %T ");
-			_fs << fmt::format("{}{}{}", std::string(3, '='), dt, std::string(80 - 3 - dt.length(), '=')) << std::endl;
-		}
+			log_open(_fs, _log_path);
 
 		reset = true;
 	}
@@ -46,26 +84,96 @@ bool Logger::Reset(std::filesystem::path log_path)
 }
 
 
-void Logger::NL(bool file)
+void Logger::ClearLine()
 {
-	std::cout << std::endl;
-	if(file && _fs.is_open())
-		_fs << std::endl;
+	// default 80 terminal width - 1 is the largest value which doesn't wrap to a new line on Windows 7
+	Push(fmt::format("\r{:79}\r", ""), false);
 }
 
 
-void Logger::Flush(bool file)
+void Logger::Sync()
 {
-	std::cout << std::flush;
-	if(file && _fs.is_open())
-		_fs << std::flush;
+	// counted before enqueueing, every counted message will be written
+	uint64_t pushed = _pushed.load();
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_writerCV.notify_one();
+	_syncCV.wait(lock, [&]() { return _flushed >= pushed; });
 }
 
 
-void Logger::ClearLine()
+void Logger::Push(std::string &&text, bool file)
 {
-	// default 80 terminal width - 1 is the largest value which doesn't wrap to a new line on Windows 7
-	std::cout << fmt::format("\r{:79}\r", "");
+	PROFILE_SCOPE_BYTES("Logger::Push", text.size());
+
+	// redirected file is owned by the calling thread, no need to go through the writer
+	if(_redirect != nullptr)
+	{
+		if(file && _redirect->_fs.is_open())
+			_redirect->_fs << text;
+		if(_redirect->_listener)
+			_redirect->_listener(text, file);
+		return;
+	}
+
+	++_pushed;
+
+	// queue is full, wait for the writer to catch up
+	Message message{ std::move(text), file };
+	while(!_queue.Push(std::move(message)))
+		std::this_thread::yield();
+
+	if(_writerWaiting.load())
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_writerCV.notify_one();
+	}
+}
+
+
+void Logger::Writer()
+{
+	uint64_t written = 0;
+	bool flush = false;
+
+	Message message;
+	for(;;)
+	{
+		if(_queue.Pop(message))
+		{
+			PROFILE_SCOPE_BYTES("Logger::Writer", message.text.size());
+
+			std::cout << message.text;
+			if(message.file && _fs.is_open())
+				_fs << message.text;
+
+			++written;
+			flush = true;
+
+			continue;
+		}
+
+		// queue is drained, flush the whole batch
+		if(flush)
+		{
+			std::cout << std::flush;
+			if(_fs.is_open())
+				_fs << std::flush;
+			flush = false;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_flushed = written;
+		_syncCV.notify_all();
+
+		if(_stop && _queue.Empty())
+			break;
+
+		// a producer can be in the middle of a push, the timeout covers it
+		_writerWaiting = true;
+		_writerCV.wait_for(lock, std::chrono::milliseconds(100), [&]() { return _stop || !_queue.Empty(); });
+		_writerWaiting = false;
+	}
 }
 
 
@@ -75,9 +183,40 @@ Logger &Logger::Get()
 }
 
 
+LogRedirect::LogRedirect(const std::filesystem::path &log_path, Listener listener)
+	: _listener(listener)
+	, _previous(Logger::_redirect)
+{
+	if(!log_path.empty())
+		log_open(_fs, log_path);
+
+	Logger::_redirect = this;
+}
+
+
+LogRedirect::~LogRedirect()
+{
+	Logger::_redirect = _previous;
+}
+
+
 void LOG_R()
 {
 	Logger::Get().ClearLine();
 }
 
+
+std::string log_progress_line(const std::string &text, int &percent)
+{
+	std::string line(text);
+	line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+	line.erase(0, line.find_first_not_of(" \n"));
+	line.erase(line.find_last_not_of(" \n") + 1);
+
+	unsigned value;
+	percent = std::sscanf(line.c_str(), "[%u%%]", &value) == 1 ? (int)value : -1;
+
+	return line;
+}
+
 }
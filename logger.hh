@@ -2,44 +2,106 @@
 
 
 
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
 #include <fmt/format.h>
 #include <fstream>
-#include <iostream>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
+#include "bounded_queue.hh"
 
 
 
 namespace gpsxre
 {
 
+class LogRedirect;
+
+// messages are formatted on the calling thread and written by a background writer thread,
+// console and file are flushed in batches whenever the writer runs out of queued messages
 class Logger
 {
 public:
 	static Logger &Get();
 
+	~Logger();
+
 	template<typename... Args>
-	void Log(bool file, std::string fmt, const Args &... args)
+	void Log(bool file, bool nl, std::string fmt, const Args &... args)
 	{
 		auto message = fmt::vformat(fmt, fmt::make_format_args(args...));
+		if(nl)
+			message += '\n';
 
-		std::cout << message;
-
-		if(file && _fs.is_open())
-			_fs << message;
+		Push(std::move(message), file);
 	}
 
 	bool Reset(std::filesystem::path log_path);
 
-	void NL(bool file = true);
-	void Flush(bool file);
 	void ClearLine();
 
+	// blocks until everything logged so far is written and flushed
+	void Sync();
+
 private:
+	struct Message
+	{
+		std::string text;
+		bool file;
+	};
+
+	static constexpr uint32_t QUEUE_CAPACITY = 4096;
+
 	static Logger _logger;
+	static thread_local LogRedirect *_redirect;
 
 	std::filesystem::path _log_path;
 	std::fstream _fs;
+
+	BoundedQueue<Message> _queue;
+	std::atomic<uint64_t> _pushed;
+	std::atomic<bool> _writerWaiting;
+
+	std::mutex _mutex;
+	std::condition_variable _writerCV;
+	std::condition_variable _syncCV;
+	uint64_t _flushed;
+	bool _stop;
+
+	std::thread _writer;
+
+	Logger();
+
+	void Push(std::string &&text, bool file);
+	void Writer();
+
+	friend class LogRedirect;
+};
+
+
+// while in scope, file messages logged by the calling thread go to a separate log file only (none if path is empty),
+// console only messages are dropped, used to keep concurrent jobs apart;
+// optional listener receives every message (text, file) instead of the console
+class LogRedirect
+{
+public:
+	using Listener = std::function<void(const std::string &, bool)>;
+
+	LogRedirect(const std::filesystem::path &log_path, Listener listener = nullptr);
+	~LogRedirect();
+
+	LogRedirect(const LogRedirect &) = delete;
+	LogRedirect &operator=(const LogRedirect &) = delete;
+
+private:
+	std::fstream _fs;
+	Listener _listener;
+	LogRedirect *_previous;
+
+	friend class Logger;
 };
 
 
@@ -47,19 +109,15 @@ private:
 template<typename... Args>
 void LOG(std::string fmt, const Args &... args)
 {
-	auto &logger = Logger::Get();
-	logger.Log(true, fmt, std::forward<const Args>(args)...);
-	logger.NL(true);
+	Logger::Get().Log(true, true, fmt, std::forward<const Args>(args)...);
 }
 
 
-// log message and flush, no new line (console & file)
+// log message, no new line (console & file)
 template<typename... Args>
 void LOG_F(std::string fmt, const Args &... args)
 {
-	auto &logger = Logger::Get();
-	logger.Log(true, fmt, std::forward<const Args>(args)...);
-	logger.Flush(true);
+	Logger::Get().Log(true, false, fmt, std::forward<const Args>(args)...);
 }
 
 
@@ -67,23 +125,23 @@ void LOG_F(std::string fmt, const Args &... args)
 template<typename... Args>
 void LOGC(std::string fmt, const Args &... args)
 {
-	auto &logger = Logger::Get();
-	logger.Log(false, fmt, std::forward<const Args>(args)...);
-	logger.NL(false);
+	Logger::Get().Log(false, true, fmt, std::forward<const Args>(args)...);
 }
 
 
-// log message and flush, no new line (console only)
+// log message, no new line (console only)
 template<typename... Args>
 void LOGC_F(std::string fmt, const Args &... args)
 {
-	auto &logger = Logger::Get();
-	logger.Log(false, fmt, std::forward<const Args>(args)...);
-	logger.Flush(false);
+	Logger::Get().Log(false, false, fmt, std::forward<const Args>(args)...);
 }
 
 
 // erase line (console only)
 void LOG_R();
 
+
+// console only message without line erase characters, percent is set from the leading "[ nn%]" or -1
+std::string log_progress_line(const std::string &text, int &percent);
+
 }
@@ -1,7 +1,11 @@
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <fmt/format.h>
+#include <mutex>
 #include <stdexcept>
 #include <iostream>
+#include <thread>
 #include "common.hh"
 #include "logger.hh"
 #include "options.hh"
@@ -18,7 +22,24 @@ int main(int argc, char *argv[])
 {
 	int exit_code(0);
 
-	Signal::GetInstance();
+	Signal::GetInstance().Install();
+
+	// SIGINT outside of dump terminates the process, the signal handler only flags it so that queued log lines are written first
+	std::mutex exit_mutex;
+	std::condition_variable exit_cv;
+	bool exiting = false;
+	std::thread terminate_watcher([&]()
+	{
+		std::unique_lock<std::mutex> lock(exit_mutex);
+		while(!exit_cv.wait_for(lock, std::chrono::milliseconds(100), [&]() { return exiting; }))
+		{
+			if(Signal::GetInstance().Terminate())
+			{
+				Logger::Get().Sync();
+				Signal::GetInstance().TerminateProcess();
+			}
+		}
+	});
 
 	try
 	{
@@ -42,5 +63,15 @@ int main(int argc, char *argv[])
 		exit_code = 2;
 	}
 
+	// make sure nothing is lost if the error is followed by an abnormal termination
+	Logger::Get().Sync();
+
+	{
+		std::lock_guard<std::mutex> lock(exit_mutex);
+		exiting = true;
+	}
+	exit_cv.notify_one();
+	terminate_watcher.join();
+
 	return exit_code;
 }
@@ -8,12 +8,13 @@
 namespace gpsxre
 {
 
-Options::Options(int argc, const char *argv[])
+Options::Options()
 	: help(false)
 	, verbose(false)
 	, overwrite(false)
 	, force_split(false)
 	, leave_unchanged(false)
+	, dry_run(false)
 	, retries(0)
 	, refine_subchannel(false)
 	, force_qtoc(false)
@@ -25,6 +26,18 @@ Options::Options(int argc, const char *argv[])
 	, correct_offset_shift(false)
 	, cdi_ready_normalize(false)
 	, audio_silence_threshold(48)
+	, batch_modes("protection,split,info")
+	, batch_jobs(0)
+	, batch_io_jobs(0)
+	, serve_socket("redumper.sock")
+	, serve_jobs(1)
+{
+	;
+}
+
+
+Options::Options(int argc, const char *argv[])
+	: Options()
 {
 	for(int i = 0; i < argc; ++i)
 	{
@@ -75,6 +88,10 @@ Options::Options(int argc, const char *argv[])
 					force_split = true;
 				else if(key == "--leave-unchanged")
 					leave_unchanged = true;
+				else if(key == "--dry-run")
+					dry_run = true;
+				else if(key == "--split-output")
+					s_value = &split_output;
 				else if(key == "--drive")
 					s_value = &drive;
 				else if(key == "--drive-type")
@@ -151,6 +168,26 @@ Options::Options(int argc, const char *argv[])
 				}
 				else if(key == "--audio-silence-threshold")
 					i_value = &audio_silence_threshold;
+				else if(key == "--accuraterip-db")
+					s_value = &accuraterip_db;
+				else if(key == "--dat")
+					s_value = &dat;
+				else if(key == "--dat-index")
+					s_value = &dat_index;
+				else if(key == "--compare-image")
+					s_value = &compare_image;
+				else if(key == "--batch-input")
+					s_value = &batch_input;
+				else if(key == "--batch-modes")
+					s_value = &batch_modes;
+				else if(key == "--batch-jobs")
+					i_value = &batch_jobs;
+				else if(key == "--batch-io-jobs")
+					i_value = &batch_io_jobs;
+				else if(key == "--serve-socket")
+					s_value = &serve_socket;
+				else if(key == "--serve-jobs")
+					i_value = &serve_jobs;
 				// unknown option
 				else
 				{
@@ -180,6 +217,63 @@ Options::Options(int argc, const char *argv[])
 }
 
 
+template<typename T>
+static std::unique_ptr<T> clone(const std::unique_ptr<T> &value)
+{
+	return value ? std::make_unique<T>(*value) : nullptr;
+}
+
+
+Options::Options(const Options &options)
+	: command(options.command)
+	, positional(options.positional)
+	, help(options.help)
+	, verbose(options.verbose)
+	, image_path(options.image_path)
+	, image_name(options.image_name)
+	, overwrite(options.overwrite)
+	, force_split(options.force_split)
+	, leave_unchanged(options.leave_unchanged)
+	, dry_run(options.dry_run)
+	, split_output(options.split_output)
+	, drive(options.drive)
+	, drive_type(clone(options.drive_type))
+	, drive_read_offset(clone(options.drive_read_offset))
+	, drive_c2_shift(clone(options.drive_c2_shift))
+	, drive_pregap_start(clone(options.drive_pregap_start))
+	, drive_read_method(clone(options.drive_read_method))
+	, drive_sector_order(clone(options.drive_sector_order))
+	, speed(clone(options.speed))
+	, retries(options.retries)
+	, refine_subchannel(options.refine_subchannel)
+	, lba_start(clone(options.lba_start))
+	, lba_end(clone(options.lba_end))
+	, force_qtoc(options.force_qtoc)
+	, skip(options.skip)
+	, skip_fill(options.skip_fill)
+	, iso9660_trim(options.iso9660_trim)
+	, plextor_skip_leadin(options.plextor_skip_leadin)
+	, asus_skip_leadout(options.asus_skip_leadout)
+	, disable_cdtext(options.disable_cdtext)
+	, correct_offset_shift(options.correct_offset_shift)
+	, cdi_ready_normalize(options.cdi_ready_normalize)
+	, force_offset(clone(options.force_offset))
+	, audio_silence_threshold(options.audio_silence_threshold)
+	, accuraterip_db(options.accuraterip_db)
+	, dat(options.dat)
+	, dat_index(options.dat_index)
+	, compare_image(options.compare_image)
+	, batch_input(options.batch_input)
+	, batch_modes(options.batch_modes)
+	, batch_jobs(options.batch_jobs)
+	, batch_io_jobs(options.batch_io_jobs)
+	, serve_socket(options.serve_socket)
+	, serve_jobs(options.serve_jobs)
+{
+	;
+}
+
+
 void Options::PrintUsage()
 {
 	LOG("usage: redumper [mode] [options]");
@@ -192,6 +286,11 @@ void Options::PrintUsage()
 	LOG("\trefine    \trefines the dump from a CD by rereading erroneous sectors");
 	LOG("\tsplit     \tperforms track splits and generates a CUE-sheet");
 	LOG("\tinfo      \tredump.org specific text file with dump information");
+	LOG("\textract   \textracts data track files with a CRC32/SHA-1 manifest, uses .scram if there is no CUE-sheet");
+	LOG("\tdatindex  \timports DAT file(s) into a hash index used by split and info for dump matching");
+	LOG("\tcompare   \tcompares two dumps of the same disc offset aware, reports differences in good and C2/SKIP areas");
+	LOG("\tbatch     \truns offline modes for many dumps in parallel, per dump log, resumable");
+	LOG("\tserve     \tlong-running job server, accepts dump/refine/split/info jobs over a local socket (POSIX only)");
 //	LOG("\trings\tscans CD for protection rings, outputs ring ranges for CD dumping");
 	LOG("");
 
@@ -222,16 +321,36 @@ void Options::PrintUsage()
 	LOG("\t(offset)");
 	LOG("\t--force-offset=VALUE           \toverride offset autodetection and use supplied value");
 	LOG("\t--audio-silence-threshold=VALUE\tmaximum absolute sample value to treat it as silence (default: {})", audio_silence_threshold);
+	LOG("\t--accuraterip-db=VALUE         \tAccurateRip dBAR file or directory, verifies audio tracks and disc write offset");
 	LOG("\t--correct-offset-shift         \tcorrect disc write offset shift");
 	LOG("");
 	LOG("\t(split)");
 	LOG("\t--force-split                  \tforce track split with errors");
 	LOG("\t--leave-unchanged              \tdon't replace erroneous sectors with generated ones");
+	LOG("\t--dry-run                      \tcompute track hashes and CUE-sheet without writing any files");
+	LOG("\t--split-output=VALUE           \tadditional per-track outputs, comma separated list of: iso, wav, sub");
 	LOG("\t--force-qtoc                   \tForce QTOC based track split");
 	LOG("\t--skip-fill=VALUE              \tfill byte value for skipped sectors (default: 0x{:02X})", skip_fill);
 	LOG("\t--iso9660-trim                 \ttrim each ISO9660 data track to PVD volume size, useful for discs with fake TOC");
 	LOG("\t--cdi-ready-normalize          \tseparate CDi-Ready track 1 index 0 to track 0");
 	LOG("");
+	LOG("\t(DAT)");
+	LOG("\t--dat=VALUE                    \tDAT file or directory with DAT files to import");
+	LOG("\t--dat-index=VALUE              \tDAT index file, split and info report dump matches if provided");
+	LOG("");
+	LOG("\t(compare)");
+	LOG("\t--compare-image=VALUE          \tpath and prefix of the dump files to compare with, --force-offset overrides relative offset");
+	LOG("");
+	LOG("\t(batch)");
+	LOG("\t--batch-input=VALUE            \tdirectory searched recursively for .scram dumps or a text file with one dump path and prefix per line");
+	LOG("\t--batch-modes=VALUE            \tmodes to run for each dump, comma separated list of: protection, split, info (default: {})", batch_modes);
+	LOG("\t--batch-jobs=VALUE             \tnumber of dumps processed in parallel (default: hardware concurrency)");
+	LOG("\t--batch-io-jobs=VALUE          \tnumber of concurrent bulk file I/O operations across all jobs (default: unlimited)");
+	LOG("");
+	LOG("\t(serve)");
+	LOG("\t--serve-socket=VALUE           \tUnix domain socket path (default: {})", serve_socket);
+	LOG("\t--serve-jobs=VALUE             \tnumber of jobs without a drive run in parallel (default: {})", serve_jobs);
+	LOG("");
 	LOG("\t(miscellaneous)");
 	LOG("\t--lba-start=VALUE              \tLBA to start dumping from");
 	LOG("\t--lba-end=VALUE                \tLBA to stop dumping at (everything before the value), useful for discs with fake TOC");
@@ -25,6 +25,8 @@ struct Options
 	bool overwrite;
 	bool force_split;
 	bool leave_unchanged;
+	bool dry_run;
+	std::string split_output;
 
 	std::string drive;
 	std::unique_ptr<std::string> drive_type;
@@ -49,8 +51,21 @@ struct Options
 	bool cdi_ready_normalize;
 	std::unique_ptr<int> force_offset;
 	int audio_silence_threshold;
+	std::string accuraterip_db;
+	std::string dat;
+	std::string dat_index;
+	std::string compare_image;
+	std::string batch_input;
+	std::string batch_modes;
+	int batch_jobs;
+	int batch_io_jobs;
+	std::string serve_socket;
+	int serve_jobs;
 
+	// defaults, fields can be set directly when used as a library
+	Options();
 	Options(int argc, const char *argv[]);
+	Options(const Options &options);
 
 	void PrintUsage();
 };
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cstring>
+#include "common.hh"
+#include "simd.hh"
+#include "pattern_scanner.hh"
+
+
+
+namespace gpsxre
+{
+
+PatternScanner::PatternScanner(const std::vector<std::vector<uint8_t>> &patterns)
+	: _patterns(patterns)
+	, _patternSizeMax(0)
+	, _position(0)
+{
+	for(auto const &p : _patterns)
+	{
+		if(p.empty())
+			throw_line("empty pattern");
+
+		_patternSizeMax = std::max(_patternSizeMax, (uint32_t)p.size());
+	}
+
+	_tail.reserve(_patternSizeMax);
+	_boundary.reserve(2 * _patternSizeMax);
+}
+
+
+bool PatternScanner::Find(const uint8_t *data, uint64_t size, const MatchFunc &func) const
+{
+	// next unverified candidate for every pattern, merged in position order
+	std::vector<uint64_t> candidates(_patterns.size());
+	for(uint32_t i = 0; i < _patterns.size(); ++i)
+		candidates[i] = Candidate(i, data, size, 0);
+
+	for(;;)
+	{
+		auto it = std::min_element(candidates.begin(), candidates.end());
+		if(it == candidates.end() || *it == size)
+			break;
+
+		uint32_t pattern_index = (uint32_t)(it - candidates.begin());
+		uint64_t position = *it;
+		auto const &p = _patterns[pattern_index];
+
+		// first and last bytes already match
+		if(p.size() <= 2 || !memcmp(&data[position + 1], &p[1], p.size() - 2))
+			if(func(pattern_index, position))
+				return true;
+
+		*it = Candidate(pattern_index, data, size, position + 1);
+	}
+
+	return false;
+}
+
+
+bool PatternScanner::Feed(const uint8_t *data, uint64_t size, const MatchFunc &func)
+{
+	bool interrupted = false;
+
+	// matches that start in the tail and end in the new data
+	if(!_tail.empty())
+	{
+		_boundary.assign(_tail.begin(), _tail.end());
+		_boundary.insert(_boundary.end(), data, data + std::min(size, (uint64_t)_patternSizeMax - 1));
+
+		uint64_t tail_position = _position - _tail.size();
+		interrupted = Find(_boundary.data(), _boundary.size(), [&](uint32_t pattern_index, uint64_t position)
+		{
+			if(position >= _tail.size() || position + _patterns[pattern_index].size() <= _tail.size())
+				return false;
+
+			return func(pattern_index, tail_position + position);
+		});
+	}
+
+	if(!interrupted)
+		interrupted = Find(data, size, [&](uint32_t pattern_index, uint64_t position) { return func(pattern_index, _position + position); });
+
+	// keep enough bytes to complete the longest pattern
+	uint64_t tail_size = _patternSizeMax - 1;
+	if(size >= tail_size)
+		_tail.assign(data + size - tail_size, data + size);
+	else
+	{
+		_tail.insert(_tail.end(), data, data + size);
+		if(_tail.size() > tail_size)
+			_tail.erase(_tail.begin(), _tail.begin() + (_tail.size() - tail_size));
+	}
+	_position += size;
+
+	return interrupted;
+}
+
+
+void PatternScanner::Reset()
+{
+	_tail.clear();
+	_position = 0;
+}
+
+
+uint64_t PatternScanner::Candidate(uint32_t pattern_index, const uint8_t *data, uint64_t size, uint64_t position) const
+{
+	auto const &p = _patterns[pattern_index];
+
+	if(position + p.size() > size)
+		return size;
+
+	uint64_t offset = simd_find_byte_pair(&data[position], size - position, p.front(), p.back(), p.size() - 1);
+
+	return offset == size - position ? size : position + offset;
+}
+
+}
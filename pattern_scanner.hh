@@ -0,0 +1,43 @@
+#pragma once
+
+
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+
+namespace gpsxre
+{
+
+// multi-pattern byte search, candidates are prefiltered by the first and last pattern byte and then verified
+class PatternScanner
+{
+public:
+	// func(pattern_index, position) returns true to interrupt the scan
+	typedef std::function<bool(uint32_t, uint64_t)> MatchFunc;
+
+	PatternScanner(const std::vector<std::vector<uint8_t>> &patterns);
+
+	// reports matches contained in data in position order, for equal positions in pattern order
+	bool Find(const uint8_t *data, uint64_t size, const MatchFunc &func) const;
+
+	// treats data as a continuation of the previously fed chunks, positions are absolute
+	// and matches spanning chunk boundaries are reported
+	bool Feed(const uint8_t *data, uint64_t size, const MatchFunc &func);
+	void Reset();
+
+private:
+	std::vector<std::vector<uint8_t>> _patterns;
+	uint32_t _patternSizeMax;
+
+	// last bytes of the stream that can start a match with the next chunk
+	std::vector<uint8_t> _tail;
+	std::vector<uint8_t> _boundary;
+	uint64_t _position;
+
+	uint64_t Candidate(uint32_t pattern_index, const uint8_t *data, uint64_t size, uint64_t position) const;
+};
+
+}
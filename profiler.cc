@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <fmt/format.h>
+#include <vector>
+#include "profiler.hh"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+
+namespace gpsxre
+{
+
+ProfileProbe::ProfileProbe(const std::string &name)
+	: _name(name)
+{
+	Reset();
+}
+
+
+void ProfileProbe::Record(uint64_t duration, uint64_t bytes)
+{
+	uint32_t bucket = 0;
+	for(uint64_t d = duration; d; d >>= 1)
+		++bucket;
+
+	_calls.fetch_add(1, std::memory_order_relaxed);
+	_duration.fetch_add(duration, std::memory_order_relaxed);
+	_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	_histogram[std::min(bucket, (uint32_t)_histogram.size() - 1)].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void ProfileProbe::Reset()
+{
+	_calls = 0;
+	_duration = 0;
+	_bytes = 0;
+	for(auto &h : _histogram)
+		h = 0;
+}
+
+
+const std::string &ProfileProbe::Name() const
+{
+	return _name;
+}
+
+
+uint64_t ProfileProbe::Calls() const
+{
+	return _calls;
+}
+
+
+uint64_t ProfileProbe::Duration() const
+{
+	return _duration;
+}
+
+
+uint64_t ProfileProbe::Bytes() const
+{
+	return _bytes;
+}
+
+
+uint64_t ProfileProbe::Percentile(double percentile) const
+{
+	uint64_t calls = 0;
+	for(auto const &h : _histogram)
+		calls += h;
+
+	uint64_t target = (uint64_t)(calls * percentile / 100);
+	uint64_t count = 0;
+	for(uint32_t i = 0; i < _histogram.size(); ++i)
+	{
+		count += _histogram[i];
+		if(count && count >= target)
+			return i ? (1ULL << i) - 1 : 0;
+	}
+
+	return 0;
+}
+
+
+ProfileScope::ProfileScope(ProfileProbe &probe, uint64_t bytes)
+	: _probe(probe)
+	, _bytes(bytes)
+	, _start(std::chrono::steady_clock::now())
+{
+	;
+}
+
+
+ProfileScope::~ProfileScope()
+{
+	_probe.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count(), _bytes);
+}
+
+
+Profiler &Profiler::Get()
+{
+	// never destroyed, probes can still fire from static destructors
+	static Profiler *profiler = new Profiler;
+
+	return *profiler;
+}
+
+
+ProfileProbe &Profiler::Probe(const std::string &name)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for(auto &p : _probes)
+		if(p.Name() == name)
+			return p;
+
+	return _probes.emplace_back(name);
+}
+
+
+std::string Profiler::Report(const std::string &phase)
+{
+	std::vector<ProfileProbe *> probes;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for(auto &p : _probes)
+			if(p.Calls())
+				probes.push_back(&p);
+	}
+	std::sort(probes.begin(), probes.end(), [](const ProfileProbe *a, const ProfileProbe *b) { return a->Duration() > b->Duration(); });
+
+	// nested probes are inclusive of each other
+	std::string report = fmt::format("profile ({}):\n", phase);
+	for(auto p : probes)
+	{
+		double seconds = p->Duration() / 1000000000.;
+		report += fmt::format("  {:<24} calls: {:>9}, total: {:>10.3f}ms, p50: <={:>9}ns, p99: <={:>9}ns", p->Name(), p->Calls(), seconds * 1000, p->Percentile(50), p->Percentile(99));
+		if(p->Bytes())
+			report += fmt::format(", bytes: {:>12}, {:>8.1f} MB/s", p->Bytes(), seconds ? p->Bytes() / seconds / 1024 / 1024 : 0.);
+		report += '\n';
+
+		p->Reset();
+	}
+	report += fmt::format("  peak RSS: {:.1f} MB", peak_rss() / 1024. / 1024.);
+
+	return report;
+}
+
+
+uint64_t peak_rss()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? pmc.PeakWorkingSetSize : 0;
+#else
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage))
+		return 0;
+
+#if defined(__APPLE__)
+	return usage.ru_maxrss;
+#else
+	// kilobytes
+	return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+}
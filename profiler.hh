@@ -0,0 +1,96 @@
+#pragma once
+
+
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+
+
+// scoped probes, compile to nothing unless built with REDUMPER_PROFILE
+// the probe has to be placed at the beginning of a braced scope as it expands to two statements
+#ifdef REDUMPER_PROFILE
+#define PROFILE_CONCAT_(a__, b__) a__##b__
+#define PROFILE_CONCAT(a__, b__) PROFILE_CONCAT_(a__, b__)
+#define PROFILE_SCOPE_BYTES(name__, bytes__)                                                                                \
+	static gpsxre::ProfileProbe &PROFILE_CONCAT(profile_probe_, __LINE__) = gpsxre::Profiler::Get().Probe(name__); \
+	gpsxre::ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_probe_, __LINE__), bytes__)
+#define PROFILE_SCOPE(name__) PROFILE_SCOPE_BYTES(name__, 0)
+#else
+#define PROFILE_SCOPE_BYTES(name__, bytes__)
+#define PROFILE_SCOPE(name__)
+#endif
+
+
+
+namespace gpsxre
+{
+
+// thread-safe call statistics, durations are kept in a log2 histogram for percentiles
+class ProfileProbe
+{
+public:
+	ProfileProbe(const std::string &name);
+
+	void Record(uint64_t duration, uint64_t bytes);
+	void Reset();
+
+	const std::string &Name() const;
+	uint64_t Calls() const;
+	uint64_t Duration() const;
+	uint64_t Bytes() const;
+	// upper bound of the histogram bucket, percentile is in [0, 100]
+	uint64_t Percentile(double percentile) const;
+
+private:
+	std::string _name;
+
+	std::atomic<uint64_t> _calls;
+	std::atomic<uint64_t> _duration;
+	std::atomic<uint64_t> _bytes;
+	std::array<std::atomic<uint64_t>, 64> _histogram;
+};
+
+
+class ProfileScope
+{
+public:
+	ProfileScope(ProfileProbe &probe, uint64_t bytes);
+	~ProfileScope();
+
+	ProfileScope(ProfileScope const &) = delete;
+	void operator=(ProfileScope const &) = delete;
+
+private:
+	ProfileProbe &_probe;
+	uint64_t _bytes;
+	std::chrono::steady_clock::time_point _start;
+};
+
+
+class Profiler
+{
+public:
+	static Profiler &Get();
+
+	ProfileProbe &Probe(const std::string &name);
+
+	// per probe breakdown followed by peak RSS, resets the statistics
+	std::string Report(const std::string &phase);
+
+private:
+	std::mutex _mutex;
+	// references have to stay valid
+	std::deque<ProfileProbe> _probes;
+
+	Profiler() = default;
+};
+
+uint64_t peak_rss();
+
+}
@@ -0,0 +1,340 @@
+#include <chrono>
+#include <filesystem>
+#include <fmt/format.h>
+#include <limits>
+#include <memory>
+#include "cd.hh"
+#include "common.hh"
+#include "file_io.hh"
+#include "image_browser.hh"
+#include "logger.hh"
+#include "redumper.hh"
+#include "split.hh"
+#include "protection.hh"
+
+
+
+namespace gpsxre
+{
+
+uint8_t ProtectionSummary::Flags(int32_t lba) const
+{
+	int32_t index = lba - LBA_START;
+
+	return index >= 0 && index < (int32_t)flags.size() ? flags[index] : (uint8_t)SKIP;
+}
+
+
+// PS2 Datel DATA.DAT / BIG.DAT
+static void protection_datel(std::vector<ProtectionFinding> &findings, const ProtectionContext &context)
+{
+	// only one track
+	if(context.toc.sessions.size() != 1 || context.toc.sessions.front().tracks.size() != 1)
+		return;
+
+	// data track
+	auto &t = context.toc.sessions.front().tracks.front();
+	if(!(t.control & (uint8_t)ChannelQ::Control::DATA) || !context.summary.write_offset_detected)
+		return;
+
+	// preliminary check
+	constexpr int32_t lba_check = 50;
+	if(lba_check < t.indices.front() || lba_check >= t.lba_end || !(context.summary.Flags(lba_check) & ProtectionSummary::C2))
+		return;
+
+	std::string protected_filename;
+	{
+		ImageBrowser browser(context.scm_fs, (t.indices.front() - LBA_START) * CD_DATA_SIZE + context.summary.write_offset * CD_SAMPLE_SIZE, 0, !context.scrap);
+		auto root_dir = browser.RootDirectory();
+
+		// protection file exists
+		auto data_dat = root_dir->SubEntry("DATA.DAT");
+		auto big_dat = root_dir->SubEntry("BIG.DAT");
+
+		std::shared_ptr<ImageBrowser::Entry> protection_dat;
+		if(data_dat && big_dat)
+			protection_dat = data_dat->SectorOffset() < big_dat->SectorOffset() ? data_dat : big_dat;
+		else if(data_dat)
+			protection_dat = data_dat;
+		else if(big_dat)
+			protection_dat = big_dat;
+
+		// first file on disc and starts from LBA 23
+		if(protection_dat && protection_dat->SectorOffset() == 23)
+			protected_filename = protection_dat->Name();
+	}
+
+	if(protected_filename.empty())
+		return;
+
+	std::pair<int32_t, int32_t> range(0, 0);
+	for(int32_t lba = 25, lba_end = std::min(t.lba_end, 5000); lba < lba_end; ++lba)
+	{
+		if(context.summary.Flags(lba) & ProtectionSummary::C2)
+		{
+			if(!range.first)
+				range.first = lba;
+			range.second = lba + 1;
+		}
+		else
+		{
+			if(range.first)
+				break;
+		}
+	}
+
+	if(range.second > range.first)
+		findings.push_back(ProtectionFinding{fmt::format("PS2/Datel {}, C2: {}, range: {}-{}", protected_filename, range.second - range.first, range.first, range.second - 1), range, true});
+}
+
+
+// mastered error range candidate: a single solid run of C2 sectors in an otherwise clean data track,
+// a scratch can produce the same pattern so it's reported as detected only if the run covers exactly one file
+static void protection_error_range(std::vector<ProtectionFinding> &findings, const ProtectionContext &context)
+{
+	constexpr int32_t range_size_min = 8;
+
+	for(auto const &s : context.toc.sessions)
+	{
+		for(auto const &t : s.tracks)
+		{
+			if(!(t.control & (uint8_t)ChannelQ::Control::DATA))
+				continue;
+
+			std::vector<std::pair<int32_t, int32_t>> ranges;
+			bool skip = false;
+			for(int32_t lba = t.indices.front(); lba < t.lba_end; ++lba)
+			{
+				uint8_t flags = context.summary.Flags(lba);
+				if(flags & ProtectionSummary::SKIP)
+				{
+					skip = true;
+					break;
+				}
+
+				if(flags & ProtectionSummary::C2)
+				{
+					if(!ranges.empty() && ranges.back().second == lba)
+						ranges.back().second = lba + 1;
+					else
+						ranges.emplace_back(lba, lba + 1);
+				}
+			}
+
+			// incomplete dump, nothing can be concluded
+			if(skip || ranges.size() != 1 || ranges.front().second - ranges.front().first < range_size_min)
+				continue;
+
+			auto range = ranges.front();
+
+			// already reported by a specific detector
+			bool reported = false;
+			for(auto const &f : findings)
+				if(range.first < f.range.second && f.range.first < range.second)
+					reported = true;
+			if(reported)
+				continue;
+
+			// filesystem position of the range
+			std::string filename;
+			bool file_range = false;
+			try
+			{
+				ImageBrowser browser(context.scm_fs, (t.indices.front() - LBA_START) * CD_DATA_SIZE + context.summary.write_offset * CD_SAMPLE_SIZE, 0, !context.scrap);
+				browser.Iterate([&filename, &file_range, &range](const std::string &path, std::shared_ptr<ImageBrowser::Entry> entry)
+				{
+					int32_t lba = entry->SectorOffset();
+					int32_t lba_end = lba + (int32_t)entry->SectorSize();
+					if(range.first >= lba && range.first < lba_end)
+					{
+						filename = (path.empty() ? "" : path + "/") + entry->Name();
+						file_range = range.first == lba && range.second == lba_end;
+						return true;
+					}
+
+					return false;
+				});
+			}
+			catch(...)
+			{
+				// not an ISO9660 track
+			}
+
+			findings.push_back(ProtectionFinding{fmt::format("{} C2 errors{}, C2: {}, range: {}-{}", file_range ? "intentional" : "possible intentional", filename.empty() ? "" : fmt::format(" ({})", filename),
+					range.second - range.first, range.first, range.second - 1), range, false});
+		}
+	}
+}
+
+
+ProtectionSummary protection_summary(std::fstream &scm_fs, std::fstream &state_fs, const TOC &toc, uint32_t sectors_count)
+{
+	ProtectionSummary summary;
+	summary.write_offset = 0;
+	summary.write_offset_detected = false;
+
+	// first data track defines sector alignment
+	for(auto const &s : toc.sessions)
+	{
+		for(auto const &t : s.tracks)
+		{
+			if(t.control & (uint8_t)ChannelQ::Control::DATA)
+			{
+				int32_t write_offset = track_offset_by_sync(t.indices.front(), t.lba_end, scm_fs);
+				if(write_offset != std::numeric_limits<int32_t>::max())
+				{
+					summary.write_offset = write_offset;
+					summary.write_offset_detected = true;
+				}
+				break;
+			}
+		}
+
+		if(summary.write_offset_detected)
+			break;
+	}
+
+	summary.flags.resize(sectors_count);
+
+	constexpr uint32_t chunk_sectors = 1024;
+	std::vector<State> state(chunk_sectors * CD_DATA_SIZE_SAMPLES);
+	batch_process_range<uint32_t>(std::pair(0, sectors_count), chunk_sectors, [&](uint32_t offset, uint32_t size) -> bool
+	{
+		read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, offset, size, -summary.write_offset, (uint8_t)State::ERROR_SKIP);
+
+		for(uint32_t i = 0; i < size; ++i)
+		{
+			uint8_t &flags = summary.flags[offset + i];
+
+			flags = 0;
+			for(uint32_t j = 0; j < CD_DATA_SIZE_SAMPLES; ++j)
+			{
+				auto s = state[i * CD_DATA_SIZE_SAMPLES + j];
+				if(s == State::ERROR_C2)
+					flags |= ProtectionSummary::C2;
+				else if(s == State::ERROR_SKIP)
+					flags |= ProtectionSummary::SKIP;
+			}
+		}
+
+		return false;
+	});
+
+	return summary;
+}
+
+
+std::vector<ProtectionFinding> protection_scan(const ProtectionContext &context)
+{
+	// specific detectors go first, generic ones skip already reported ranges
+	static const std::vector<ProtectionDetector> DETECTORS =
+	{
+		protection_datel,
+		protection_error_range
+	};
+
+	std::vector<ProtectionFinding> findings;
+	for(auto const &d : DETECTORS)
+		d(findings, context);
+
+	return findings;
+}
+
+
+void redumper_protection(Options &options)
+{
+	if(options.image_name.empty())
+		throw_line("no image name provided");
+
+	std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
+
+	std::filesystem::path scm_path(image_prefix + ".scram");
+	std::filesystem::path scp_path(image_prefix + ".scrap");
+	std::filesystem::path sub_path(image_prefix + ".subcode");
+	std::filesystem::path state_path(image_prefix + ".state");
+	std::filesystem::path toc_path(image_prefix + ".toc");
+	std::filesystem::path fulltoc_path(image_prefix + ".fulltoc");
+
+	bool scrap = !std::filesystem::exists(scm_path) && std::filesystem::exists(scp_path);
+	auto scra_path(scrap ? scp_path : scm_path);
+
+	//TODO: rework
+	uint32_t sectors_count = check_file(state_path, CD_DATA_SIZE_SAMPLES);
+
+	// TOC
+	std::vector<uint8_t> toc_buffer = read_vector(toc_path);
+	TOC toc(toc_buffer, false);
+
+	// FULL TOC
+	if(std::filesystem::exists(fulltoc_path))
+	{
+		std::vector<uint8_t> fulltoc_buffer = read_vector(fulltoc_path);
+		TOC toc_full(fulltoc_buffer, true);
+		if(toc_full.sessions.size() > 1)
+			toc = toc_full;
+		else
+			toc.disc_type = toc_full.disc_type;
+	}
+
+	{
+		auto &t = toc.sessions.back().tracks.back();
+
+		// fake TOC
+		if(t.lba_end < 0)
+		{
+			LOG("warning: fake TOC detected, using default 74min disc size");
+			t.lba_end = MSF_to_LBA(MSF{74, 0, 0});
+		}
+
+		// incomplete dump (dumped with --stop-lba)
+		if(t.lba_end > (int32_t)sectors_count + LBA_START)
+		{
+			LOG("warning: incomplete dump detected, using available dump size");
+			t.lba_end = (int32_t)sectors_count + LBA_START;
+		}
+	}
+
+	// TOC entries don't have track end, derive it from the next entry and drop lead-out
+	for(auto &s : toc.sessions)
+	{
+		for(uint32_t i = 0; i + 1 < s.tracks.size(); ++i)
+			s.tracks[i].lba_end = s.tracks[i + 1].track_number == bcd_decode(CD_LEADOUT_TRACK_NUMBER) ? s.tracks[i + 1].lba_end : s.tracks[i + 1].lba_start;
+
+		if(!s.tracks.empty() && s.tracks.back().track_number == bcd_decode(CD_LEADOUT_TRACK_NUMBER))
+			s.tracks.pop_back();
+	}
+
+	std::fstream scm_fs(scra_path, std::fstream::in | std::fstream::binary);
+	if(!scm_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", scra_path.filename().string()));
+
+	std::fstream state_fs(state_path, std::fstream::in | std::fstream::binary);
+	if(!state_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", state_path.filename().string()));
+
+	LOG("scan started");
+
+	auto scan_time_start = std::chrono::high_resolution_clock::now();
+
+	auto summary = protection_summary(scm_fs, state_fs, toc, sectors_count);
+	auto findings = protection_scan(ProtectionContext{toc, summary, scm_fs, scrap});
+
+	auto skip_ranges = string_to_ranges(options.skip);
+	for(auto const &f : findings)
+	{
+		LOG("protection: {}", f.description);
+
+		if(f.skip)
+			skip_ranges.push_back(f.range);
+	}
+	options.skip = ranges_to_string(skip_ranges);
+
+	if(findings.empty())
+		LOG("protection: N/A");
+
+	auto scan_time_stop = std::chrono::high_resolution_clock::now();
+	LOG("scan complete (time: {}s)", std::chrono::duration_cast<std::chrono::seconds>(scan_time_stop - scan_time_start).count());
+	LOG("");
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+
+
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "options.hh"
+#include "toc.hh"
+
+
+
+namespace gpsxre
+{
+
+// compact per sector view of .state, built with a single sequential pass
+struct ProtectionSummary
+{
+	enum Flag : uint8_t
+	{
+		C2   = 1 << 0,
+		SKIP = 1 << 1
+	};
+
+	// sectors are aligned using the first data track write offset (0 if there is no data track)
+	int32_t write_offset;
+	bool write_offset_detected;
+
+	// indexed by lba - LBA_START
+	std::vector<uint8_t> flags;
+
+	uint8_t Flags(int32_t lba) const;
+};
+
+struct ProtectionContext
+{
+	const TOC &toc;
+	const ProtectionSummary &summary;
+	std::fstream &scm_fs;
+	bool scrap;
+};
+
+struct ProtectionFinding
+{
+	std::string description;
+	std::pair<int32_t, int32_t> range;
+
+	// range is excluded from the split error check
+	bool skip;
+};
+
+// detectors work on the summary only, disc filesystem is accessed only to confirm a candidate
+typedef std::function<void(std::vector<ProtectionFinding> &findings, const ProtectionContext &context)> ProtectionDetector;
+
+ProtectionSummary protection_summary(std::fstream &scm_fs, std::fstream &state_fs, const TOC &toc, uint32_t sectors_count);
+std::vector<ProtectionFinding> protection_scan(const ProtectionContext &context);
+
+void redumper_protection(Options &options);
+
+}
@@ -3,13 +3,22 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include "batch.hh"
 #include "cmd.hh"
 #include "common.hh"
+#include "compare.hh"
 #include "crc16_gsm.hh"
 #include "crc32.hh"
+#include "dat_index.hh"
+#include "extract.hh"
 #include "file_io.hh"
+#include "interval_set.hh"
 #include "logger.hh"
+#include "profiler.hh"
+#include "protection.hh"
 #include "scrambler.hh"
+#include "sector_state.hh"
+#include "serve.hh"
 #include "signal.hh"
 #include "split.hh"
 #include "subcode.hh"
@@ -54,6 +63,7 @@ void validate_options(Options &options)
 
 	bool drive_required = false;
 	bool name_generate = false;
+	std::string name_default;
 	for(auto const &p : options.positional)
 	{
 		if(p == "dump" || p == "refine" || p == "rings")
@@ -61,6 +71,9 @@ void validate_options(Options &options)
 
 		if(p == "dump")
 			name_generate = true;
+
+		if(p == "batch" || p == "serve")
+			name_default = p;
 	}
 
 	// autodetect drive if not provided
@@ -88,6 +101,10 @@ void validate_options(Options &options)
 		drive.erase(remove(drive.begin(), drive.end(), '/'), drive.end());
 		options.image_name = fmt::format("dump_{}_{}", system_date_time("%y%m%d_%H%M%S"), drive);
 	}
+
+	// batch and serve log name, fixed so that a batch rerun finds its journal and resumes
+	if(!name_default.empty() && options.image_name.empty())
+		options.image_name = name_default;
 }
 
 
@@ -100,6 +117,12 @@ void redumper(Options &options)
 	LOG("{}\n", redumper_version());
 	LOG("command: {}\n", options.command);
 
+	redumper_modes(options);
+}
+
+
+void redumper_modes(Options &options)
+{
 	bool skip_refine = false;
 	for(auto const &p : options.positional)
 	{
@@ -110,7 +133,7 @@ void redumper(Options &options)
 		LOG("*** MODE: {}", p);
 
 		if(p == "dump")
-			skip_refine = !redumper_dump(options, false);
+			skip_refine = !redumper_dump(options, false).refine;
 		else if(p == "refine")
 			redumper_dump(options, true);
 		else if(p == "protection")
@@ -119,6 +142,16 @@ void redumper(Options &options)
 			redumper_split(options);
 		else if(p == "info")
 			redumper_info(options);
+		else if(p == "extract")
+			redumper_extract(options);
+		else if(p == "datindex")
+			redumper_datindex(options);
+		else if(p == "compare")
+			redumper_compare(options);
+		else if(p == "batch")
+			redumper_batch(options);
+		else if(p == "serve")
+			redumper_serve(options);
 		else if(p == "rings")
 			redumper_rings(options);
 		else if(p == "subchannel")
@@ -127,11 +160,23 @@ void redumper(Options &options)
 			redumper_debug(options);
 		else
 			LOG("warning: unknown mode, skipping ({})", p);
+
+#ifdef REDUMPER_PROFILE
+		LOG("{}", Profiler::Get().Report(p));
+#endif
+
+		// cancelled (serve, library), Ctrl+C interrupts only the dump itself
+		if(Signal::GetInstance().Interrupt())
+		{
+			if(&p != &options.positional.back())
+				LOG("cancelled, remaining modes skipped");
+			break;
+		}
 	}
 }
 
 
-bool redumper_dump(const Options &options, bool refine)
+DumpResult redumper_dump(const Options &options, bool refine)
 {
 	SPTD sptd(options.drive);
 	drive_init(sptd, options);
@@ -164,8 +209,8 @@ bool redumper_dump(const Options &options, bool refine)
 	if(!refine && !options.overwrite && std::filesystem::exists(state_path))
 		throw_line(fmt::format("dump already exists (name: {})", options.image_name));
 
-	std::vector<std::pair<int32_t, int32_t>> skip_ranges = string_to_ranges(options.skip); //FIXME: transition to samples?
-	std::vector<std::pair<int32_t, int32_t>> error_ranges;
+	IntervalSet skip_ranges(string_to_ranges(options.skip)); //FIXME: transition to samples?
+	IntervalSet error_ranges;
 
 	int32_t lba_start = drive_config.pregap_start;
 	int32_t lba_end = MSF_to_LBA(MSF{74, 0, 0}); // default: 74min / 650Mb
@@ -271,7 +316,7 @@ bool redumper_dump(const Options &options, bool refine)
 
 	// multisession gaps
 	for(uint32_t i = 1; i < toc.sessions.size(); ++i)
-		error_ranges.emplace_back(toc.sessions[i - 1].tracks.back().lba_end, toc.sessions[i].tracks.front().indices.front() + drive_config.pregap_start);
+		error_ranges.Add(IntervalSet::Interval(toc.sessions[i - 1].tracks.back().lba_end, toc.sessions[i].tracks.front().indices.front() + drive_config.pregap_start));
 
 	// compare disc / file TOC to make sure it's the same disc
 	if(refine)
@@ -345,11 +390,13 @@ bool redumper_dump(const Options &options, bool refine)
 
 	if(refine)
 	{
+		IntervalSet::Cursor skip_cursor(skip_ranges);
+		IntervalSet::Cursor error_cursor(error_ranges);
 		for(int32_t lba = lba_start; lba < lba_end; ++lba)
 		{
 			int32_t lba_index = lba - LBA_START;
 
-			if(inside_range(lba, skip_ranges) != nullptr || inside_range(lba, error_ranges) != nullptr)
+			if(skip_cursor.Find(lba) != nullptr || error_cursor.Find(lba) != nullptr)
 				continue;
 
 			bool refine_sector = false;
@@ -403,18 +450,24 @@ bool redumper_dump(const Options &options, bool refine)
 
 	auto dump_time_start = std::chrono::high_resolution_clock::now();
 
-	Signal::GetInstance().Engage();
-	int signal_dummy = 0;
-	std::unique_ptr<int, std::function<void(int *)>> signal_guard(&signal_dummy, [](int *)
-	{
-		Signal::GetInstance().Disengage();
-	});
+	SignalEngage signal_engage;
+
+	IntervalSet::Cursor skip_cursor(skip_ranges);
+	IntervalSet::Cursor error_cursor(error_ranges);
+
+	// per sector scratch buffers are reused across the loop
+	std::vector<uint8_t> sector_buffer(CD_RAW_DATA_SIZE);
+	std::vector<uint8_t> read_scratch(read_sector_scratch_size(drive_config));
+	std::vector<State> sector_state_file(CD_DATA_SIZE_SAMPLES);
+	std::vector<uint8_t> sector_data_file(CD_DATA_SIZE);
+	std::vector<uint8_t> sector_subcode_file(CD_SUBCODE_SIZE);
+	auto reader = sector_reader(drive_config);
 
 	int32_t lba_next = 0;
 	int32_t lba_overread = lba_end;
 	for(int32_t lba = lba_start; lba < lba_overread; lba = lba_next)
 	{
-		if(auto r = inside_range(lba, skip_ranges); r != nullptr)
+		if(auto r = skip_cursor.Find(lba); r != nullptr)
 		{
 			lba_next = r->second;
 			continue;
@@ -432,15 +485,12 @@ bool redumper_dump(const Options &options, bool refine)
 		if(drive_is_asus(drive_config) && !options.asus_skip_leadout)
 		{
 			// initial cache read
-			auto r = inside_range(lba, error_ranges);
+			auto r = error_cursor.Find(lba);
 			if(r != nullptr && lba == r->first || lba == lba_end)
 			{
 				// dummy read to cache lead-out
 				if(refine)
-				{
-					std::vector<uint8_t> sector_buffer(CD_RAW_DATA_SIZE);
-					read_sector(sector_buffer.data(), sptd, drive_config, lba - 1);
-				}
+					read_sector(sector_buffer.data(), read_scratch.data(), sptd, reader, lba - 1);
 
 				LOG_R();
 				LOG("LG/ASUS: searching lead-out in cache (LBA: {:6})", lba);
@@ -576,20 +626,18 @@ bool redumper_dump(const Options &options, bool refine)
 
 		if(read)
 		{
-			std::vector<uint8_t> sector_buffer(CD_RAW_DATA_SIZE);
-
 			if(flush)
 				cmd_flush_drive_cache(sptd, lba);
 
 			auto read_time_start = std::chrono::high_resolution_clock::now();
-			auto status = read_sector(sector_buffer.data(), sptd, drive_config, lba);
+			auto status = read_sector(sector_buffer.data(), read_scratch.data(), sptd, reader, lba);
 			auto read_time_stop = std::chrono::high_resolution_clock::now();
 			bool slow = std::chrono::duration_cast<std::chrono::seconds>(read_time_stop - read_time_start).count() > SLOW_SECTOR_TIMEOUT;
 
 			// PLEXTOR: multisession lead-out overread
 			// usually there are couple of slow sectors before SCSI error is generated
 			// some models (PX-708UF) exit on I/O semaphore timeout on such slow sectors
-			if(drive_config.type == DriveConfig::Type::PLEXTOR && slow && inside_range(lba, error_ranges) != nullptr)
+			if(drive_config.type == DriveConfig::Type::PLEXTOR && slow && error_cursor.Find(lba) != nullptr)
 			{
 				// skip sector in refine mode
 //				lba_next = lba + 1; //FIXME:
@@ -597,7 +645,7 @@ bool redumper_dump(const Options &options, bool refine)
 			else if(status.status_code)
 			{
 				// don't log lead-out overread SCSI error
-				if(inside_range(lba, error_ranges) == nullptr && lba < lba_end)
+				if(error_cursor.Find(lba) == nullptr && lba < lba_end)
 				{
 					if(!refine)
 						++errors_scsi;
@@ -672,54 +720,24 @@ bool redumper_dump(const Options &options, bool refine)
 
 			if(refine)
 			{
-				std::vector<State> sector_state_file(CD_DATA_SIZE_SAMPLES);
-				std::vector<uint8_t> sector_data_file(CD_DATA_SIZE);
 				read_entry(fs_state, (uint8_t *)sector_state_file.data(), CD_DATA_SIZE_SAMPLES, lba_index, 1, drive_config.read_offset, (uint8_t)State::ERROR_SKIP);
 				read_entry(fs_scm, sector_data_file.data(), CD_DATA_SIZE, lba_index, 1, drive_config.read_offset * CD_SAMPLE_SIZE, 0);
 
-				bool update = false;
-				bool scsi_exists_file = false;
-				bool c2_exists_file = false;
-				bool scsi_exists = false;
-				bool c2_exists = false;
-				for(uint32_t i = 0; i < CD_DATA_SIZE_SAMPLES; ++i)
-				{
-					if(sector_state_file[i] == State::ERROR_SKIP)
-						scsi_exists_file = true;
-					else if(sector_state_file[i] == State::ERROR_C2)
-						c2_exists_file = true;
-
-					// new data is improved
-					if(sector_state[i] > sector_state_file[i])
-						update = true;
-
-					// inherit older data if state is better
-					if(sector_state_file[i] > sector_state[i])
-					{
-						sector_state[i] = sector_state_file[i];
-						((uint32_t *)sector_data.data())[i] = ((uint32_t *)sector_data_file.data())[i];
-					}
-
-					if(sector_state[i] == State::ERROR_SKIP)
-						scsi_exists = true;
-					else if(sector_state[i] == State::ERROR_C2)
-						c2_exists = true;
-				}
-
-				if(update)
+				auto merge = state_merge(sector_state.data(), (uint32_t *)sector_data.data(), sector_state_file.data(), (uint32_t *)sector_data_file.data(), CD_DATA_SIZE_SAMPLES);
+				if(merge.update)
 				{
 					write_entry(fs_scm, sector_data.data(), CD_DATA_SIZE, lba_index, 1, drive_config.read_offset * CD_SAMPLE_SIZE);
 					write_entry(fs_state, (uint8_t *)sector_state.data(), CD_DATA_SIZE_SAMPLES, lba_index, 1, drive_config.read_offset);
 
-					if(inside_range(lba, error_ranges) == nullptr && lba < lba_end)
+					if(error_cursor.Find(lba) == nullptr && lba < lba_end)
 					{
-						if(scsi_exists_file && !scsi_exists)
+						if(merge.scsi_exists_file && !merge.scsi_exists)
 						{
 							--errors_scsi;
-							if(c2_exists)
+							if(merge.c2_exists)
 								++errors_c2;
 						}
-						else if(c2_exists_file && !c2_exists)
+						else if(merge.c2_exists_file && !merge.c2_exists)
 							--errors_c2;
 					}
 				}
@@ -730,14 +748,13 @@ bool redumper_dump(const Options &options, bool refine)
 					subcode_extract_channel((uint8_t *)&Q, sector_subcode.data(), Subchannel::Q);
 					if(Q.Valid())
 					{
-						std::vector<uint8_t> sector_subcode_file(CD_SUBCODE_SIZE);
-						read_entry(fs_sub, (uint8_t *)sector_subcode_file.data(), CD_SUBCODE_SIZE, lba_index + subcode_shift, 1, 0, 0);
+						read_entry(fs_sub, sector_subcode_file.data(), CD_SUBCODE_SIZE, lba_index + subcode_shift, 1, 0, 0);
 						ChannelQ Q_file;
 						subcode_extract_channel((uint8_t *)&Q_file, sector_subcode_file.data(), Subchannel::Q);
 						if(!Q_file.Valid())
 						{
 							write_entry(fs_sub, sector_subcode.data(), CD_SUBCODE_SIZE, lba_index + subcode_shift, 1, 0);
-							if(inside_range(lba, error_ranges) == nullptr)
+							if(error_cursor.Find(lba) == nullptr)
 								--errors_q;
 						}
 					}
@@ -784,7 +801,7 @@ bool redumper_dump(const Options &options, bool refine)
 			if(lba + 1 == lba_overread)
 				lba_overread = lba;
 			// between sessions
-			else if(auto r = inside_range(lba, error_ranges); r != nullptr)
+			else if(auto r = error_cursor.Find(lba); r != nullptr)
 				lba_next = r->second;
 		}
 
@@ -823,7 +840,7 @@ bool redumper_dump(const Options &options, bool refine)
 	LOG("");
 
 	// always refine once if LG/ASUS to improve chances of capturing enough lead-out sectors
-	return errors_scsi || errors_c2 || drive_is_asus(drive_config) && !options.asus_skip_leadout;
+	return DumpResult{ errors_scsi, errors_c2, errors_q, errors_scsi || errors_c2 || drive_is_asus(drive_config) && !options.asus_skip_leadout };
 }
 
 
@@ -1255,54 +1272,53 @@ void drive_init(SPTD &sptd, const Options &options)
 }
 
 
-SPTD::Status read_sector(uint8_t *sector, SPTD &sptd, const DriveConfig &drive_config, int32_t lba)
+// PLEXTOR: C2 is shifted 294/295 bytes late, read as much sectors as needed to get whole C2
+// as a consequence, lead-out overread will fail a few sectors earlier
+uint32_t read_sector_scratch_size(const DriveConfig &drive_config)
+{
+	return CD_RAW_DATA_SIZE * (drive_config.c2_shift / CD_C2_SIZE + (drive_config.c2_shift % CD_C2_SIZE ? 1 : 0) + 1);
+}
+
+
+SectorReader sector_reader(const DriveConfig &drive_config)
 {
 	auto layout = sector_order_layout(drive_config.sector_order);
 
-	// PLEXTOR: C2 is shifted 294/295 bytes late, read as much sectors as needed to get whole C2
-	// as a consequence, lead-out overread will fail a few sectors earlier
-	uint32_t sectors_count = drive_config.c2_shift / CD_C2_SIZE + (drive_config.c2_shift % CD_C2_SIZE ? 1 : 0) + 1;
-	std::vector<uint8_t> sector_buffer(CD_RAW_DATA_SIZE * sectors_count);
+	SectorReader sector_reader;
+	sector_reader.unpacker = sector_unpacker(drive_config);
+	sector_reader.sectors_count = read_sector_scratch_size(drive_config) / CD_RAW_DATA_SIZE;
+	sector_reader.c2_shift = drive_config.c2_shift;
+	sector_reader.d8 = drive_config.read_method == DriveConfig::ReadMethod::D8;
+	sector_reader.cdda_sub_code = drive_config.sector_order == DriveConfig::SectorOrder::DATA_SUB ? READ_CDDA_SubCode::DATA_SUB : READ_CDDA_SubCode::DATA_C2_SUB;
+	sector_reader.expected_sector_type = drive_config.read_method == DriveConfig::ReadMethod::BE_CDDA ? READ_CD_ExpectedSectorType::CD_DA : READ_CD_ExpectedSectorType::ALL_TYPES;
+	sector_reader.error_field = layout.c2_offset == CD_RAW_DATA_SIZE ? READ_CD_ErrorField::NONE : READ_CD_ErrorField::C2;
+	sector_reader.sub_channel = layout.subcode_offset == CD_RAW_DATA_SIZE ? READ_CD_SubChannel::NONE : READ_CD_SubChannel::RAW;
+
+	return sector_reader;
+}
+
 
+SPTD::Status read_sector(uint8_t *sector, SPTD &sptd, const DriveConfig &drive_config, int32_t lba)
+{
+	std::vector<uint8_t> scratch(read_sector_scratch_size(drive_config));
+
+	return read_sector(sector, scratch.data(), sptd, sector_reader(drive_config), lba);
+}
+
+
+// scratch has to be at least read_sector_scratch_size() bytes
+SPTD::Status read_sector(uint8_t *sector, uint8_t *scratch, SPTD &sptd, const SectorReader &sector_reader, int32_t lba)
+{
 	SPTD::Status status;
 	// D8
-	if(drive_config.read_method == DriveConfig::ReadMethod::D8)
-	{
-		status = cmd_read_cdda(sptd, sector_buffer.data(), lba, sectors_count,
-				drive_config.sector_order == DriveConfig::SectorOrder::DATA_SUB ? READ_CDDA_SubCode::DATA_SUB : READ_CDDA_SubCode::DATA_C2_SUB);
-	}
+	if(sector_reader.d8)
+		status = cmd_read_cdda(sptd, scratch, lba, sector_reader.sectors_count, sector_reader.cdda_sub_code);
 	// BE
 	else
-	{
-		status = cmd_read_cd(sptd, sector_buffer.data(), lba, sectors_count,
-				drive_config.read_method == DriveConfig::ReadMethod::BE_CDDA ? READ_CD_ExpectedSectorType::CD_DA : READ_CD_ExpectedSectorType::ALL_TYPES,
-				layout.c2_offset == CD_RAW_DATA_SIZE ? READ_CD_ErrorField::NONE : READ_CD_ErrorField::C2,
-				layout.subcode_offset == CD_RAW_DATA_SIZE ? READ_CD_SubChannel::NONE : READ_CD_SubChannel::RAW);
-	}
+		status = cmd_read_cd(sptd, scratch, lba, sector_reader.sectors_count, sector_reader.expected_sector_type, sector_reader.error_field, sector_reader.sub_channel);
 
 	if(!status.status_code)
-	{
-		memset(sector, 0x00, CD_RAW_DATA_SIZE);
-
-		// copy data
-		if(layout.data_offset != CD_RAW_DATA_SIZE)
-			memcpy(sector + 0, sector_buffer.data() + layout.data_offset, CD_DATA_SIZE);
-
-		// copy C2
-		if(layout.c2_offset != CD_RAW_DATA_SIZE)
-		{
-			// compensate C2 shift
-			std::vector<uint8_t> c2_buffer(CD_C2_SIZE * sectors_count);
-			for(uint32_t i = 0; i < sectors_count; ++i)
-				memcpy(c2_buffer.data() + CD_C2_SIZE * i, sector_buffer.data() + layout.size * i + layout.c2_offset, CD_C2_SIZE);
-
-			memcpy(sector + CD_DATA_SIZE, c2_buffer.data() + drive_config.c2_shift, CD_C2_SIZE);
-		}
-
-		// copy subcode
-		if(layout.subcode_offset != CD_RAW_DATA_SIZE)
-			memcpy(sector + CD_DATA_SIZE + CD_C2_SIZE, sector_buffer.data() + layout.subcode_offset, CD_SUBCODE_SIZE);
-	}
+		sector_reader.unpacker(sector, scratch, sector_reader.c2_shift);
 
 	return status;
 }
@@ -1324,31 +1340,6 @@ bool is_data_track(int32_t lba, const TOC &toc)
 }
 
 
-uint32_t state_from_c2(std::vector<State> &state, const uint8_t *c2_data)
-{
-	uint32_t c2_count = 0;
-
-	// group 4 C2 consecutive errors into 1 state, this way it aligns to the drive offset
-	// and covers the case where for 1 C2 bit there are 2 damaged sector bytes (scrambled data bytes, usually)
-	for(uint32_t i = 0; i < CD_DATA_SIZE_SAMPLES; ++i)
-	{
-		uint8_t c2_quad = c2_data[i / 2];
-		if(i % 2)
-			c2_quad &= 0x0F;
-		else
-			c2_quad >>= 4;
-
-		if(c2_quad)
-		{
-			state[i] = State::ERROR_C2;
-			c2_count += bits_count(c2_quad);
-		}
-	}
-
-	return c2_count;
-}
-
-
 void plextor_store_sessions_leadin(std::fstream &fs_scm, std::fstream &fs_sub, std::fstream &fs_state, SPTD &sptd, const std::vector<int32_t> &session_lba_start, const DriveConfig &di, const Options &options)
 {
 	std::vector<std::vector<uint8_t>> leadin_buffers(session_lba_start.size());
@@ -47,10 +47,38 @@ enum class State : uint8_t
 };
 
 
+// sector read parameters, resolved once from drive configuration
+struct SectorReader
+{
+	SectorUnpacker unpacker;
+	uint32_t sectors_count;
+	uint32_t c2_shift;
+
+	bool d8;
+	READ_CDDA_SubCode cdda_sub_code;
+	READ_CD_ExpectedSectorType expected_sector_type;
+	READ_CD_ErrorField error_field;
+	READ_CD_SubChannel sub_channel;
+};
+
+
+struct DumpResult
+{
+	uint32_t errors_scsi;
+	uint32_t errors_c2;
+	uint32_t errors_q;
+	// refine can improve the dump
+	bool refine;
+};
+
+
 std::string redumper_version();
+void validate_options(Options &options);
 void redumper(Options &options);
+// runs options.positional modes in order, expects validated options
+void redumper_modes(Options &options);
 
-bool redumper_dump(const Options &options, bool refine);
+DumpResult redumper_dump(const Options &options, bool refine);
 void redumper_rings(const Options &options);
 void redumper_subchannel(const Options &options);
 void redumper_debug(const Options &options);
@@ -58,9 +86,11 @@ void redumper_debug(const Options &options);
 uint32_t percentage(int32_t value, uint32_t value_max);
 std::string first_ready_drive();
 void drive_init(SPTD &sptd, const Options &options);
+uint32_t read_sector_scratch_size(const DriveConfig &drive_config);
+SectorReader sector_reader(const DriveConfig &drive_config);
 SPTD::Status read_sector(uint8_t *sector_buffer, SPTD &sptd, const DriveConfig &drive_config, int32_t lba);
+SPTD::Status read_sector(uint8_t *sector_buffer, uint8_t *scratch, SPTD &sptd, const SectorReader &sector_reader, int32_t lba);
 bool is_data_track(int32_t lba, const TOC &toc);
-uint32_t state_from_c2(std::vector<State> &state, const uint8_t *c2_data);
 void plextor_store_sessions_leadin(std::fstream &fs_scm, std::fstream &fs_sub, std::fstream &fs_state, SPTD &sptd, const std::vector<int32_t> &session_lba_start, const DriveConfig &di, const Options &options);
 void debug_print_c2_scm_offsets(const uint8_t *c2_data, uint32_t lba_index, int32_t lba_start, int32_t drive_read_offset);
 uint32_t debug_get_scram_offset(int32_t lba, int32_t write_offset);
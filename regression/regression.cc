@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "common.hh"
+#include "file_io.hh"
+#include "generator/image_generator.hh"
+#include "sha1.hh"
+
+
+
+using namespace gpsxre;
+
+
+
+// dump files generated from a layout, everything else in the image directory is an output
+const std::set<std::string> INPUT_EXTENSIONS = { ".scram", ".state", ".subcode", ".toc", ".fulltoc", ".cdtext" };
+
+// extract goes first to work on the scrambled image, split output would make it use the split tracks
+const std::vector<std::string> PHASES = { "extract", "split", "protection", "info" };
+
+// layout of a second dump of the same disc, when present the first dump is compared against it
+const std::string PAIR_EXTENSION = ".pair";
+
+// noise floor for tiny phases
+constexpr double TIME_SLACK = 0.1;
+constexpr uint64_t RSS_SLACK = 4 * 1024 * 1024;
+
+
+struct Metrics
+{
+	double wall;
+	double cpu;
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+	uint64_t peak_rss;
+};
+
+
+struct PhaseResult
+{
+	std::string image;
+	std::string phase;
+	int exit_code;
+	Metrics metrics;
+	std::string hash;
+};
+
+
+// runs a process with stdout/stderr redirected to a file, statistics are collected from the kernel
+static int process_run(Metrics &metrics, const std::vector<std::string> &arguments, const std::filesystem::path &output_path)
+{
+	std::vector<char *> argv;
+	for(auto const &a : arguments)
+		argv.push_back((char *)a.c_str());
+	argv.push_back(nullptr);
+
+	auto time_start = std::chrono::steady_clock::now();
+
+	pid_t pid = fork();
+	if(pid < 0)
+		throw_line(fmt::format("fork failed ({})", strerror(errno)));
+	else if(!pid)
+	{
+		int fd = open(output_path.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0)
+			_exit(127);
+		dup2(fd, STDOUT_FILENO);
+		dup2(fd, STDERR_FILENO);
+		close(fd);
+
+		execv(argv.front(), argv.data());
+		_exit(127);
+	}
+
+	// keep the zombie around to read its I/O accounting
+	siginfo_t info;
+	if(waitid(P_PID, pid, &info, WEXITED | WNOWAIT))
+		throw_line(fmt::format("waitid failed ({})", strerror(errno)));
+	metrics.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count();
+
+	metrics.bytes_read = 0;
+	metrics.bytes_written = 0;
+#ifdef __linux__
+	std::ifstream ifs(fmt::format("/proc/{}/io", pid));
+	for(std::string line; std::getline(ifs, line);)
+	{
+		auto tokens = tokenize(line, ": ", nullptr);
+		if(tokens.size() != 2)
+			continue;
+
+		if(tokens[0] == "rchar")
+			metrics.bytes_read = std::stoull(tokens[1]);
+		else if(tokens[0] == "wchar")
+			metrics.bytes_written = std::stoull(tokens[1]);
+	}
+#endif
+
+	int status;
+	struct rusage usage;
+	if(wait4(pid, &status, 0, &usage) != pid)
+		throw_line(fmt::format("wait4 failed ({})", strerror(errno)));
+
+	metrics.cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000. + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.;
+#if defined(__APPLE__)
+	metrics.peak_rss = usage.ru_maxrss;
+#else
+	// kilobytes
+	metrics.peak_rss = (uint64_t)usage.ru_maxrss * 1024;
+#endif
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+
+static std::set<std::filesystem::path> directory_files(const std::filesystem::path &directory)
+{
+	std::set<std::filesystem::path> files;
+	for(auto const &f : std::filesystem::directory_iterator(directory))
+		if(f.is_regular_file())
+			files.insert(f.path());
+
+	return files;
+}
+
+
+// console output without the volatile parts, followed by the content of every new output file
+static std::string phase_hash(const std::filesystem::path &output_path, const std::set<std::filesystem::path> &files, const std::string &work_path)
+{
+	SHA1 sha1;
+
+	std::ifstream ifs(output_path);
+	for(std::string line; std::getline(ifs, line);)
+	{
+		if(line.rfind("redumper v", 0) == 0 || line.rfind("command:", 0) == 0 || line.find("(time:") != std::string::npos)
+			continue;
+
+		// paths are printed as given
+		const std::string work_placeholder("<work>");
+		for(auto p = line.find(work_path); p != std::string::npos; p = line.find(work_path, p + work_placeholder.length()))
+			line.replace(p, work_path.length(), work_placeholder);
+
+		line += '\n';
+		sha1.Update((const uint8_t *)line.data(), line.size());
+	}
+
+	for(auto const &f : files)
+	{
+		if(f.extension() == ".log")
+			continue;
+
+		auto name = f.filename().string();
+		sha1.Update((const uint8_t *)name.data(), name.size());
+
+		auto data = read_vector(f);
+		sha1.Update(data.data(), data.size());
+	}
+
+	return sha1.Final();
+}
+
+
+// whitespace separated records, first two columns are image name and phase
+static std::map<std::pair<std::string, std::string>, std::vector<std::string>> records_load(const std::filesystem::path &path)
+{
+	std::map<std::pair<std::string, std::string>, std::vector<std::string>> records;
+
+	if(std::filesystem::exists(path))
+	{
+		std::ifstream ifs(path);
+		for(std::string line; std::getline(ifs, line);)
+		{
+			if(line.empty() || line.front() == '#')
+				continue;
+
+			auto tokens = tokenize(line, " \t\r", nullptr);
+			if(tokens.size() < 3)
+				throw_line(fmt::format("malformed record ({}: {})", path.filename().string(), line));
+
+			records[{ tokens[0], tokens[1] }] = std::vector<std::string>(tokens.begin() + 2, tokens.end());
+		}
+	}
+
+	return records;
+}
+
+
+static void records_save(const std::filesystem::path &path, const std::string &header, const std::vector<PhaseResult> &results, const std::function<std::string(const PhaseResult &)> &format)
+{
+	std::ofstream ofs(path);
+	ofs << header << std::endl;
+	for(auto const &r : results)
+		ofs << fmt::format("{} {} {}", r.image, r.phase, format(r)) << std::endl;
+	if(ofs.fail())
+		throw_line(fmt::format("unable to write file ({})", path.string()));
+}
+
+
+static std::string baseline_format(const PhaseResult &r)
+{
+	return fmt::format("{:.3f} {:.3f} {} {} {}", r.metrics.wall, r.metrics.cpu, r.metrics.bytes_read, r.metrics.bytes_written, r.metrics.peak_rss);
+}
+
+
+static std::string results_json(const std::vector<PhaseResult> &results)
+{
+	std::string json = "{\n";
+	json += fmt::format("\t\"version\": \"{}.{}.{} build_{}\",\n", XSTRINGIFY(REDUMPER_VERSION_MAJOR), XSTRINGIFY(REDUMPER_VERSION_MINOR), XSTRINGIFY(REDUMPER_VERSION_PATCH),
+		XSTRINGIFY(REDUMPER_VERSION_BUILD));
+	json += "\t\"phases\": [\n";
+	for(uint32_t i = 0; i < results.size(); ++i)
+	{
+		auto const &r = results[i];
+		json += fmt::format("\t\t{{ \"image\": \"{}\", \"phase\": \"{}\", \"exit_code\": {}, \"wall_s\": {:.3f}, \"cpu_s\": {:.3f}, \"bytes_read\": {}, \"bytes_written\": {}, \"peak_rss\": {}, \"hash\": \"{}\" }}{}\n",
+			r.image, r.phase, r.exit_code, r.metrics.wall, r.metrics.cpu, r.metrics.bytes_read, r.metrics.bytes_written, r.metrics.peak_rss, r.hash, i + 1 < results.size() ? "," : "");
+	}
+	json += "\t]\n}\n";
+
+	return json;
+}
+
+
+// percentage difference or regression marker
+static std::string compare_metric(double value, double baseline, double tolerance, double slack, bool &regression)
+{
+	if(value > baseline * (1 + tolerance / 100) + slack)
+	{
+		regression = true;
+		return fmt::format("{:+.0f}%!", baseline ? (value / baseline - 1) * 100 : 100.);
+	}
+
+	return baseline ? fmt::format("{:+.0f}%", (value / baseline - 1) * 100) : "";
+}
+
+
+int main(int argc, char *argv[])
+{
+	std::string redumper_path;
+	std::filesystem::path corpus_path;
+	std::filesystem::path work_path;
+	std::filesystem::path golden_path;
+	std::filesystem::path baseline_path;
+	std::string json_path;
+	std::string filter;
+	double tolerance = 10.;
+	uint32_t runs = 3;
+	bool update_golden = false;
+	bool update_baseline = false;
+
+	bool usage = false;
+	for(int i = 1; i < argc; ++i)
+	{
+		std::string arg(argv[i]);
+		if(arg.rfind("--redumper=", 0) == 0)
+			redumper_path = std::filesystem::absolute(arg.substr(11)).string();
+		else if(arg.rfind("--corpus=", 0) == 0)
+			corpus_path = arg.substr(9);
+		else if(arg.rfind("--work=", 0) == 0)
+			work_path = arg.substr(7);
+		else if(arg.rfind("--golden=", 0) == 0)
+			golden_path = arg.substr(9);
+		else if(arg.rfind("--baseline=", 0) == 0)
+			baseline_path = arg.substr(11);
+		else if(arg.rfind("--json=", 0) == 0)
+			json_path = arg.substr(7);
+		else if(arg.rfind("--filter=", 0) == 0)
+			filter = arg.substr(9);
+		else if(arg.rfind("--tolerance=", 0) == 0)
+			tolerance = std::stod(arg.substr(12));
+		else if(arg.rfind("--runs=", 0) == 0)
+			runs = std::max(1UL, std::stoul(arg.substr(7)));
+		else if(arg == "--update-golden")
+			update_golden = true;
+		else if(arg == "--update-baseline")
+			update_baseline = true;
+		else
+			usage = true;
+	}
+
+	if(usage || redumper_path.empty() || corpus_path.empty() || work_path.empty())
+	{
+		std::cout << "usage: regression --redumper=<path> --corpus=<layouts directory> --work=<directory> [--golden=<path>] [--baseline=<path>] [--json=<path>]" << std::endl
+		          << "                  [--filter=<substring>] [--tolerance=<percent>] [--runs=<count>] [--update-golden] [--update-baseline]" << std::endl;
+		return 1;
+	}
+
+	int exit_code = 0;
+
+	try
+	{
+		auto golden = records_load(golden_path);
+		auto baseline = update_baseline ? decltype(golden)() : records_load(baseline_path);
+
+		std::vector<std::filesystem::path> layouts;
+		for(auto const &f : std::filesystem::directory_iterator(corpus_path))
+			if(f.path().extension() == ".layout" && (filter.empty() || f.path().stem().string().find(filter) != std::string::npos))
+				layouts.push_back(f.path());
+		std::sort(layouts.begin(), layouts.end());
+
+		std::vector<PhaseResult> results;
+		for(auto const &l : layouts)
+		{
+			auto image_name = l.stem().string();
+			auto image_path = work_path / image_name;
+
+			std::filesystem::remove_all(image_path);
+			std::filesystem::create_directories(image_path);
+
+			auto time_start = std::chrono::steady_clock::now();
+			image_generate((image_path / image_name).string(), image_layout_load(l));
+
+			// the second dump lives outside of the image directory to not be taken for an output
+			auto phases = PHASES;
+			auto pair_layout = std::filesystem::path(l).replace_extension(PAIR_EXTENSION);
+			auto pair_path = work_path / (image_name + PAIR_EXTENSION);
+			if(std::filesystem::exists(pair_layout))
+			{
+				std::filesystem::remove_all(pair_path);
+				std::filesystem::create_directories(pair_path);
+				image_generate((pair_path / image_name).string(), image_layout_load(pair_layout));
+				phases.push_back("compare");
+			}
+			std::cout << fmt::format("{} (generated in {:.3f}s)", image_name, std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count()) << std::endl;
+
+			for(auto const &p : phases)
+			{
+				PhaseResult result;
+				result.image = image_name;
+				result.phase = p;
+
+				// damaged images are expected to be split regardless
+				std::vector<std::string> arguments = { redumper_path, p, "--image-path=" + image_path.string(), "--image-name=" + image_name };
+				if(p == "split")
+					arguments.push_back("--force-split");
+				// extracted files directory is kept between runs
+				else if(p == "extract")
+					arguments.push_back("--overwrite");
+				else if(p == "compare")
+					arguments.push_back("--compare-image=" + (pair_path / image_name).string());
+
+				std::vector<Metrics> metrics;
+				for(uint32_t r = 0; r < runs; ++r)
+				{
+					// extract and split start from scratch every run, their outputs are hashed as new files
+					if(p == "extract" || p == "split")
+						for(auto const &f : directory_files(image_path))
+							if(INPUT_EXTENSIONS.find(f.extension().string()) == INPUT_EXTENSIONS.end())
+								std::filesystem::remove(f);
+
+					auto files_before = directory_files(image_path);
+					auto output_path = work_path / fmt::format("{}.{}.txt", image_name, p);
+					result.exit_code = process_run(metrics.emplace_back(), arguments, output_path);
+
+					std::set<std::filesystem::path> files;
+					for(auto const &f : directory_files(image_path))
+						if(files_before.find(f) == files_before.end())
+							files.insert(f);
+
+					auto hash = phase_hash(output_path, files, work_path.string());
+					if(r && hash != result.hash)
+						result.hash = "nondeterministic";
+					else if(!r)
+						result.hash = hash;
+				}
+
+				// median is robust against scheduling noise
+				auto median = [&metrics](auto member)
+				{
+					std::vector<std::decay_t<decltype(metrics.front().*member)>> values;
+					for(auto const &m : metrics)
+						values.push_back(m.*member);
+					std::sort(values.begin(), values.end());
+					return values[values.size() / 2];
+				};
+				result.metrics.wall = median(&Metrics::wall);
+				result.metrics.cpu = median(&Metrics::cpu);
+				result.metrics.bytes_read = median(&Metrics::bytes_read);
+				result.metrics.bytes_written = median(&Metrics::bytes_written);
+				result.metrics.peak_rss = median(&Metrics::peak_rss);
+
+				std::string status = result.exit_code ? fmt::format("exit code {}", result.exit_code) : "ok";
+				if(!result.exit_code)
+				{
+					auto g = golden.find({ image_name, p });
+					if(g == golden.end())
+						status = update_golden ? "ok" : "no golden hash";
+					else if(g->second.front() != result.hash)
+						status = update_golden ? "golden updated" : "hash mismatch";
+				}
+				if(status != "ok" && status != "golden updated" && status != "no golden hash")
+					exit_code = 1;
+
+				std::string comparison;
+				auto b = baseline.find({ image_name, p });
+				if(b != baseline.end() && b->second.size() == 5)
+				{
+					bool regression = false;
+					comparison = fmt::format(" [wall: {}, cpu: {}, read: {}, written: {}, rss: {}]", compare_metric(result.metrics.wall, std::stod(b->second[0]), tolerance, TIME_SLACK, regression),
+						compare_metric(result.metrics.cpu, std::stod(b->second[1]), tolerance, TIME_SLACK, regression),
+						compare_metric(result.metrics.bytes_read, std::stod(b->second[2]), tolerance, 0, regression),
+						compare_metric(result.metrics.bytes_written, std::stod(b->second[3]), tolerance, 0, regression),
+						compare_metric(result.metrics.peak_rss, std::stod(b->second[4]), tolerance, RSS_SLACK, regression));
+					if(regression)
+					{
+						status += ", regression";
+						exit_code = 1;
+					}
+				}
+
+				std::cout << fmt::format("  {:<10} wall: {:>7.3f}s, cpu: {:>7.3f}s, read: {:>6.1f} MB, written: {:>6.1f} MB, peak RSS: {:>6.1f} MB{} ({})", p, result.metrics.wall, result.metrics.cpu,
+					result.metrics.bytes_read / 1024. / 1024., result.metrics.bytes_written / 1024. / 1024., result.metrics.peak_rss / 1024. / 1024., comparison, status) << std::endl;
+
+				results.push_back(result);
+			}
+		}
+
+		if(update_golden && !golden_path.empty())
+			records_save(golden_path, "# image phase sha1, console output and output files of each phase", results, [](const PhaseResult &r) { return r.hash; });
+
+		if(!baseline_path.empty() && (update_baseline || !std::filesystem::exists(baseline_path)))
+		{
+			records_save(baseline_path, "# image phase wall_s cpu_s bytes_read bytes_written peak_rss", results, baseline_format);
+			std::cout << fmt::format("baseline saved ({})", baseline_path.string()) << std::endl;
+		}
+
+		if(!json_path.empty())
+		{
+			std::ofstream ofs(json_path);
+			ofs << results_json(results);
+			if(ofs.fail())
+				throw_line(fmt::format("unable to write JSON ({})", json_path));
+		}
+	}
+	catch(const std::exception &e)
+	{
+		std::cout << fmt::format("error: {}", e.what()) << std::endl;
+		exit_code = 1;
+	}
+
+	return exit_code;
+}
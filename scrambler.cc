@@ -1,7 +1,9 @@
 #include <climits>
 #include <cstring>
 #include "common.hh"
+#include "profiler.hh"
 #include "scrambler.hh"
+#include "simd.hh"
 
 
 
@@ -16,6 +18,8 @@ Scrambler::Scrambler()
 
 bool Scrambler::Descramble(uint8_t *sector, int32_t *lba, uint32_t size) const
 {
+	PROFILE_SCOPE_BYTES("Scrambler::Descramble", size);
+
 	bool unscrambled = false;
 
 	// zeroed or not enough data to analyze
@@ -127,8 +131,7 @@ void Scrambler::GenerateTable()
 
 void Scrambler::Process(uint8_t *sector_out, const uint8_t *sector_in, uint32_t size) const
 {
-	for(uint32_t i = 0; i < size; ++i)
-		sector_out[i] = sector_in[i] ^ _table[i];
+	simd_xor_table(sector_out, sector_in, _table, size);
 }
 
 }
@@ -14,6 +14,7 @@
 #endif
 
 #include "common.hh"
+#include "profiler.hh"
 #include "scsi.hh"
 
 
@@ -292,6 +293,8 @@ SPTD::~SPTD()
 
 SPTD::Status SPTD::SendCommand(const void *cdb, uint8_t cdb_length, void *buffer, uint32_t buffer_length, uint32_t timeout)
 {
+	PROFILE_SCOPE_BYTES("SPTD::SendCommand", buffer_length);
+
 	Status status = {};
 
 #ifdef _WIN32
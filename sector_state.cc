@@ -0,0 +1,169 @@
+#include "common.hh"
+#include "sector_state.hh"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SECTOR_STATE_SSE2
+#endif
+
+
+
+namespace gpsxre
+{
+
+#ifdef SECTOR_STATE_SSE2
+// SWAR popcount of every byte, summed into two 64-bit lanes
+static __m128i popcount_epi8_sum(__m128i v)
+{
+	v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x55)));
+	v = _mm_add_epi8(_mm_and_si128(v, _mm_set1_epi8(0x33)), _mm_and_si128(_mm_srli_epi16(v, 2), _mm_set1_epi8(0x33)));
+	v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), _mm_set1_epi8(0x0F));
+
+	return _mm_sad_epu8(v, _mm_setzero_si128());
+}
+
+
+// expands 4 state bytes of mask into 4 sample masks
+static void expand_mask(__m128i masks[4], __m128i mask)
+{
+	__m128i lo = _mm_unpacklo_epi8(mask, mask);
+	__m128i hi = _mm_unpackhi_epi8(mask, mask);
+	masks[0] = _mm_unpacklo_epi16(lo, lo);
+	masks[1] = _mm_unpackhi_epi16(lo, lo);
+	masks[2] = _mm_unpacklo_epi16(hi, hi);
+	masks[3] = _mm_unpackhi_epi16(hi, hi);
+}
+#endif
+
+
+uint32_t state_from_c2(std::vector<State> &state, const uint8_t *c2_data)
+{
+	uint32_t c2_count = 0;
+
+	// group 4 C2 consecutive errors into 1 state, this way it aligns to the drive offset
+	// and covers the case where for 1 C2 bit there are 2 damaged sector bytes (scrambled data bytes, usually)
+	uint32_t i = 0;
+
+#ifdef SECTOR_STATE_SSE2
+	// 16 C2 bytes expand to 32 states, high nibble is the first sample
+	__m128i c2_sum = _mm_setzero_si128();
+	for(; i + 32 <= CD_DATA_SIZE_SAMPLES; i += 32)
+	{
+		__m128i c2 = _mm_loadu_si128((const __m128i *)&c2_data[i / 2]);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(c2, 4), _mm_set1_epi8(0x0F));
+		__m128i lo = _mm_and_si128(c2, _mm_set1_epi8(0x0F));
+
+		c2_sum = _mm_add_epi64(c2_sum, popcount_epi8_sum(c2));
+
+		for(uint32_t j = 0; j < 2; ++j)
+		{
+			__m128i quads = j ? _mm_unpackhi_epi8(hi, lo) : _mm_unpacklo_epi8(hi, lo);
+			__m128i error = _mm_andnot_si128(_mm_cmpeq_epi8(quads, _mm_setzero_si128()), _mm_set1_epi8(-1));
+
+			__m128i *s = (__m128i *)&state[i + j * 16];
+			__m128i value = _mm_loadu_si128(s);
+			value = _mm_or_si128(_mm_and_si128(error, _mm_set1_epi8((char)State::ERROR_C2)), _mm_andnot_si128(error, value));
+			_mm_storeu_si128(s, value);
+		}
+	}
+	c2_count = (uint32_t)(_mm_cvtsi128_si32(c2_sum) + _mm_cvtsi128_si32(_mm_srli_si128(c2_sum, 8)));
+#endif
+
+	for(; i < CD_DATA_SIZE_SAMPLES; ++i)
+	{
+		uint8_t c2_quad = c2_data[i / 2];
+		if(i % 2)
+			c2_quad &= 0x0F;
+		else
+			c2_quad >>= 4;
+
+		if(c2_quad)
+		{
+			state[i] = State::ERROR_C2;
+			c2_count += bits_count(c2_quad);
+		}
+	}
+
+	return c2_count;
+}
+
+
+StateMerge state_merge(State *state, uint32_t *samples, const State *state_file, const uint32_t *samples_file, uint32_t count)
+{
+	StateMerge merge = {};
+
+	uint32_t i = 0;
+
+#ifdef SECTOR_STATE_SSE2
+	// state values are small so signed byte comparisons are safe
+	__m128i update = _mm_setzero_si128();
+	__m128i scsi_file = _mm_setzero_si128();
+	__m128i c2_file = _mm_setzero_si128();
+	__m128i scsi = _mm_setzero_si128();
+	__m128i c2 = _mm_setzero_si128();
+	__m128i state_skip = _mm_set1_epi8((char)State::ERROR_SKIP);
+	__m128i state_c2 = _mm_set1_epi8((char)State::ERROR_C2);
+
+	for(; i + 16 <= count; i += 16)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)&state[i]);
+		__m128i sf = _mm_loadu_si128((const __m128i *)&state_file[i]);
+
+		update = _mm_or_si128(update, _mm_cmpgt_epi8(s, sf));
+		scsi_file = _mm_or_si128(scsi_file, _mm_cmpeq_epi8(sf, state_skip));
+		c2_file = _mm_or_si128(c2_file, _mm_cmpeq_epi8(sf, state_c2));
+
+		// inherit older data if state is better
+		__m128i inherit = _mm_cmpgt_epi8(sf, s);
+		__m128i masks[4];
+		expand_mask(masks, inherit);
+		for(uint32_t j = 0; j < 4; ++j)
+		{
+			__m128i *d = (__m128i *)&samples[i + j * 4];
+			__m128i data = _mm_loadu_si128(d);
+			__m128i data_file = _mm_loadu_si128((const __m128i *)&samples_file[i + j * 4]);
+			_mm_storeu_si128(d, _mm_or_si128(_mm_and_si128(masks[j], data_file), _mm_andnot_si128(masks[j], data)));
+		}
+
+		s = _mm_max_epu8(s, sf);
+		_mm_storeu_si128((__m128i *)&state[i], s);
+
+		scsi = _mm_or_si128(scsi, _mm_cmpeq_epi8(s, state_skip));
+		c2 = _mm_or_si128(c2, _mm_cmpeq_epi8(s, state_c2));
+	}
+
+	merge.update = _mm_movemask_epi8(update);
+	merge.scsi_exists_file = _mm_movemask_epi8(scsi_file);
+	merge.c2_exists_file = _mm_movemask_epi8(c2_file);
+	merge.scsi_exists = _mm_movemask_epi8(scsi);
+	merge.c2_exists = _mm_movemask_epi8(c2);
+#endif
+
+	for(; i < count; ++i)
+	{
+		if(state_file[i] == State::ERROR_SKIP)
+			merge.scsi_exists_file = true;
+		else if(state_file[i] == State::ERROR_C2)
+			merge.c2_exists_file = true;
+
+		// new data is improved
+		if(state[i] > state_file[i])
+			merge.update = true;
+
+		// inherit older data if state is better
+		if(state_file[i] > state[i])
+		{
+			state[i] = state_file[i];
+			samples[i] = samples_file[i];
+		}
+
+		if(state[i] == State::ERROR_SKIP)
+			merge.scsi_exists = true;
+		else if(state[i] == State::ERROR_C2)
+			merge.c2_exists = true;
+	}
+
+	return merge;
+}
+
+}
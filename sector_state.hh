@@ -0,0 +1,31 @@
+#pragma once
+
+
+
+#include <cstdint>
+#include <vector>
+#include "redumper.hh"
+
+
+
+namespace gpsxre
+{
+
+struct StateMerge
+{
+	// new state is better than stored one for at least one sample
+	bool update;
+
+	bool scsi_exists_file;
+	bool c2_exists_file;
+	bool scsi_exists;
+	bool c2_exists;
+};
+
+// group 4 C2 consecutive errors into 1 state, returns total C2 bits count
+uint32_t state_from_c2(std::vector<State> &state, const uint8_t *c2_data);
+
+// per sample max of stored and new sector state, samples with better stored state are taken from stored data
+StateMerge state_merge(State *state, uint32_t *samples, const State *state_file, const uint32_t *samples_file, uint32_t count);
+
+}
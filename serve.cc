@@ -0,0 +1,820 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fmt/format.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cmd.hh"
+#include "common.hh"
+#include "json.hh"
+#include "logger.hh"
+#include "redumper.hh"
+#include "scsi.hh"
+#include "signal.hh"
+#include "serve.hh"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+
+namespace gpsxre
+{
+
+#ifndef _WIN32
+
+enum class ServeJobStatus
+{
+	QUEUED,
+	RUNNING,
+	SUCCESS,
+	FAILED,
+	CANCELLED
+};
+
+
+static const std::map<ServeJobStatus, std::string> SERVE_JOB_STATUS_STRING =
+{
+	{ServeJobStatus::QUEUED, "QUEUED"},
+	{ServeJobStatus::RUNNING, "RUNNING"},
+	{ServeJobStatus::SUCCESS, "SUCCESS"},
+	{ServeJobStatus::FAILED, "FAILED"},
+	{ServeJobStatus::CANCELLED, "CANCELLED"}
+};
+
+
+// one request / event per line
+struct ServeClient
+{
+	int fd;
+	std::mutex mutex;
+	std::atomic<bool> done;
+
+	ServeClient(int fd)
+		: fd(fd)
+		, done(false)
+	{
+		;
+	}
+
+	void Send(const std::string &message)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(fd < 0)
+			return;
+
+		std::string line(message + '\n');
+		for(size_t sent = 0; sent < line.length();)
+		{
+			auto n = ::send(fd, line.data() + sent, line.length() - sent, 0);
+			if(n < 0 && errno == EINTR)
+				continue;
+
+			// client is gone or doesn't read (send timeout), drop it
+			if(n <= 0)
+			{
+				::shutdown(fd, SHUT_RDWR);
+				break;
+			}
+
+			sent += n;
+		}
+	}
+
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(fd >= 0)
+		{
+			::close(fd);
+			fd = -1;
+		}
+	}
+};
+
+
+struct ServeJob
+{
+	uint32_t id;
+	// drive path, empty for jobs which don't need a drive
+	std::string queue;
+	std::unique_ptr<Options> options;
+	ServeJobStatus status;
+	std::string error;
+	double duration;
+	std::vector<std::shared_ptr<ServeClient>> watchers;
+	std::chrono::steady_clock::time_point progress_time;
+	// checked on the job thread the same way as Ctrl+C
+	std::atomic<bool> cancel;
+};
+
+
+class JobServer
+{
+public:
+	JobServer(const Options &options);
+
+	void Run();
+
+private:
+	static constexpr uint32_t HISTORY_MAX = 1024;
+	static constexpr uint32_t REQUEST_SIZE_MAX = 1024 * 1024;
+	static constexpr std::chrono::milliseconds PROGRESS_INTERVAL = std::chrono::milliseconds(100);
+
+	std::string _socketPath;
+	uint32_t _offlineJobs;
+
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	bool _stop;
+	uint32_t _nextId;
+	std::map<uint32_t, std::shared_ptr<ServeJob>> _jobs;
+	std::map<std::string, std::deque<std::shared_ptr<ServeJob>>> _queues;
+	std::set<std::string> _busy;
+	std::set<std::string> _workerQueues;
+	std::list<std::thread> _workers;
+
+	void Reader(std::shared_ptr<ServeClient> client);
+	void Handle(std::shared_ptr<ServeClient> client, const std::string &line);
+	void Submit(std::shared_ptr<ServeClient> client, const JSONValue &request, const std::string &id);
+	void Cancel(std::shared_ptr<ServeClient> client, const JSONValue &request, const std::string &id);
+	void Watch(std::shared_ptr<ServeClient> client, const JSONValue &request, const std::string &id);
+	std::string Status();
+	std::string Drives();
+	void Shutdown();
+
+	std::string IdleDrive();
+	void Worker(std::string queue);
+	void RunJob(std::shared_ptr<ServeJob> job);
+	void Message(ServeJob &job, const std::string &text, bool file);
+	void Notify(const ServeJob &job, const std::string &event);
+	void PruneHistory();
+};
+
+
+static std::string serve_finished_event(const ServeJob &job)
+{
+	return fmt::format("{{\"event\":\"finished\",\"job\":{},\"status\":\"{}\",\"duration\":{:.3f},\"error\":{}}}", job.id,
+			enum_to_string(job.status, SERVE_JOB_STATUS_STRING), job.duration, json_string(job.error));
+}
+
+
+static uint32_t serve_job_id(const JSONValue &request)
+{
+	auto job = request.Member("job");
+	if(job == nullptr || job->type != JSONValue::Type::NUMBER)
+		throw_line("job number is not provided");
+
+	return (uint32_t)job->number;
+}
+
+
+JobServer::JobServer(const Options &options)
+	: _socketPath(options.serve_socket)
+	, _offlineJobs(std::max(options.serve_jobs, 1))
+	, _stop(false)
+	, _nextId(1)
+{
+	;
+}
+
+
+void JobServer::Run()
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if(_socketPath.length() >= sizeof(address.sun_path))
+		throw_line(fmt::format("socket path is too long ({})", _socketPath));
+	std::strcpy(address.sun_path, _socketPath.c_str());
+
+	// leftover socket of a previous instance that didn't exit cleanly
+	struct stat st;
+	if(!lstat(_socketPath.c_str(), &st))
+	{
+		if(!S_ISSOCK(st.st_mode))
+			throw_line(fmt::format("file exists and is not a socket ({})", _socketPath));
+
+		int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		bool running = probe >= 0 && !::connect(probe, (sockaddr *)&address, sizeof(address));
+		if(probe >= 0)
+			::close(probe);
+		if(running)
+			throw_line(fmt::format("server is already running ({})", _socketPath));
+
+		::unlink(_socketPath.c_str());
+	}
+
+	int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listen_fd < 0)
+		throw_line(fmt::format("unable to create socket ({})", std::strerror(errno)));
+	if(::bind(listen_fd, (sockaddr *)&address, sizeof(address)) || ::chmod(_socketPath.c_str(), S_IRUSR | S_IWUSR) || ::listen(listen_fd, 16))
+	{
+		auto error = std::strerror(errno);
+		::close(listen_fd);
+		throw_line(fmt::format("unable to listen on socket ({}, {})", _socketPath, error));
+	}
+
+	// writes to disconnected clients fail with an error instead
+	signal(SIGPIPE, SIG_IGN);
+
+	std::string drives;
+	for(auto const &d : SPTD::ListDrives())
+		drives += fmt::format("{}{}", drives.empty() ? "" : ", ", d);
+	LOG("listening on: {}", _socketPath);
+	LOG("drives: {}", drives.empty() ? "none" : drives);
+	LOG("");
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_workerQueues.insert("");
+		for(uint32_t i = 0; i < _offlineJobs; ++i)
+			_workers.emplace_back(&JobServer::Worker, this, "");
+	}
+
+	std::list<std::pair<std::shared_ptr<ServeClient>, std::thread>> clients;
+	for(;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if(_stop)
+				break;
+		}
+
+		// join disconnected clients
+		for(auto it = clients.begin(); it != clients.end();)
+		{
+			if(it->first->done)
+			{
+				it->second.join();
+				it = clients.erase(it);
+			}
+			else
+				++it;
+		}
+
+		pollfd pfd = { listen_fd, POLLIN, 0 };
+		if(::poll(&pfd, 1, 200) <= 0 || !(pfd.revents & POLLIN))
+			continue;
+
+		int fd = ::accept(listen_fd, nullptr, nullptr);
+		if(fd < 0)
+			continue;
+
+		// a client that stops reading must not stall jobs streaming to it
+		timeval timeout = { 5, 0 };
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		auto client = std::make_shared<ServeClient>(fd);
+		clients.emplace_back(client, std::thread(&JobServer::Reader, this, client));
+	}
+
+	::close(listen_fd);
+	::unlink(_socketPath.c_str());
+
+	// running jobs finish, queued ones were cancelled on shutdown
+	for(auto &w : _workers)
+		w.join();
+
+	for(auto &c : clients)
+	{
+		{
+			std::lock_guard<std::mutex> lock(c.first->mutex);
+			if(c.first->fd >= 0)
+				::shutdown(c.first->fd, SHUT_RDWR);
+		}
+		c.second.join();
+	}
+
+	LOG("server stopped");
+}
+
+
+void JobServer::Reader(std::shared_ptr<ServeClient> client)
+{
+	std::string buffer;
+	std::vector<char> chunk(4096);
+	for(;;)
+	{
+		auto n = ::recv(client->fd, chunk.data(), chunk.size(), 0);
+		if(n < 0 && errno == EINTR)
+			continue;
+		if(n <= 0)
+			break;
+
+		buffer.append(chunk.data(), n);
+
+		for(auto pos = buffer.find('\n'); pos != std::string::npos; pos = buffer.find('\n'))
+		{
+			std::string line(buffer, 0, pos);
+			buffer.erase(0, pos + 1);
+			if(!line.empty() && line.back() == '\r')
+				line.pop_back();
+
+			if(!line.empty())
+				Handle(client, line);
+		}
+
+		if(buffer.length() > REQUEST_SIZE_MAX)
+		{
+			client->Send(fmt::format("{{\"event\":\"error\",\"error\":{}}}", json_string("request is too long")));
+			break;
+		}
+	}
+
+	// stop streaming to this client
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for(auto &j : _jobs)
+			j.second->watchers.erase(std::remove(j.second->watchers.begin(), j.second->watchers.end(), client), j.second->watchers.end());
+	}
+
+	client->Close();
+	client->done = true;
+}
+
+
+void JobServer::Handle(std::shared_ptr<ServeClient> client, const std::string &line)
+{
+	// request id is echoed back as is to match the response
+	std::string id;
+
+	try
+	{
+		auto request = json_parse(line);
+		if(request.type != JSONValue::Type::OBJECT)
+			throw_line("request is not an object");
+
+		if(auto i = request.Member("id"))
+		{
+			if(i->type == JSONValue::Type::NUMBER)
+				id = fmt::format(",\"id\":{}", i->number);
+			else if(i->type == JSONValue::Type::STRING)
+				id = fmt::format(",\"id\":{}", json_string(i->string));
+		}
+
+		auto command = request.Member("command");
+		if(command == nullptr || command->type != JSONValue::Type::STRING)
+			throw_line("command is not provided");
+
+		if(command->string == "submit")
+			Submit(client, request, id);
+		else if(command->string == "cancel")
+			Cancel(client, request, id);
+		else if(command->string == "watch")
+			Watch(client, request, id);
+		else if(command->string == "status")
+			client->Send(fmt::format("{{\"event\":\"status\",\"jobs\":{}{}}}", Status(), id));
+		else if(command->string == "drives")
+			client->Send(fmt::format("{{\"event\":\"drives\",\"drives\":{}{}}}", Drives(), id));
+		else if(command->string == "shutdown")
+		{
+			client->Send(fmt::format("{{\"event\":\"shutdown\"{}}}", id));
+			Shutdown();
+		}
+		else
+			throw_line(fmt::format("unknown command ({})", command->string));
+	}
+	catch(const std::exception &e)
+	{
+		client->Send(fmt::format("{{\"event\":\"error\",\"error\":{}{}}}", json_string(e.what()), id));
+	}
+}
+
+
+void JobServer::Submit(std::shared_ptr<ServeClient> client, const JSONValue &request, const std::string &id)
+{
+	// job is described by the regular command line arguments
+	auto args = request.Member("args");
+	if(args == nullptr || args->type != JSONValue::Type::ARRAY)
+		throw_line("args are not provided");
+
+	std::vector<std::string> arguments{ "redumper" };
+	for(auto const &a : args->array)
+	{
+		if(a.type != JSONValue::Type::STRING)
+			throw_line("args element is not a string");
+		arguments.push_back(a.string);
+	}
+	std::vector<const char *> argv;
+	for(auto const &a : arguments)
+		argv.push_back(a.c_str());
+
+	auto job = std::make_shared<ServeJob>();
+	job->options = std::make_unique<Options>((int)argv.size(), argv.data());
+	job->status = ServeJobStatus::QUEUED;
+	job->duration = 0;
+	job->cancel = false;
+	job->watchers.push_back(client);
+
+	auto &options = *job->options;
+	if(options.positional.empty())
+		throw_line("mode is not provided");
+
+	bool drive_required = false;
+	for(auto const &p : options.positional)
+	{
+		if(p != "cd" && p != "dump" && p != "refine" && p != "protection" && p != "split" && p != "info")
+			throw_line(fmt::format("unsupported mode ({})", p));
+
+		if(p == "cd" || p == "dump" || p == "refine")
+			drive_required = true;
+	}
+
+	if(drive_required && options.drive.empty())
+		options.drive = IdleDrive();
+
+	validate_options(options);
+	if(options.image_name.empty())
+		throw_line("image name is not provided");
+
+	job->queue = drive_required ? options.drive : "";
+
+	uint32_t position;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_stop)
+			throw_line("server is shutting down");
+
+		job->id = _nextId++;
+		_jobs[job->id] = job;
+		position = _queues[job->queue].size() + (_busy.find(job->queue) == _busy.end() ? 0 : 1);
+	}
+
+	// acknowledge before the job can start
+	client->Send(fmt::format("{{\"event\":\"accepted\",\"job\":{},\"queue\":{},\"image\":{},\"position\":{}{}}}", job->id, json_string(job->queue),
+			json_string((std::filesystem::path(options.image_path) / options.image_name).string()), position, id));
+	LOG("[job {}] queued (queue: {}): {}", job->id, job->queue.empty() ? "offline" : job->queue, options.command);
+
+	bool cancelled = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_stop)
+		{
+			job->status = ServeJobStatus::CANCELLED;
+			cancelled = true;
+		}
+		else
+		{
+			_queues[job->queue].push_back(job);
+
+			// one worker per drive serializes jobs of the drive
+			if(_workerQueues.insert(job->queue).second)
+				_workers.emplace_back(&JobServer::Worker, this, job->queue);
+		}
+	}
+
+	if(cancelled)
+		Notify(*job, serve_finished_event(*job));
+	else
+		_cv.notify_all();
+}
+
+
+void JobServer::Cancel(std::shared_ptr<ServeClient> client, const JSONValue &request, const std::string &id)
+{
+	auto job_id = serve_job_id(request);
+
+	std::shared_ptr<ServeJob> job;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _jobs.find(job_id);
+		if(it == _jobs.end())
+			throw_line(fmt::format("no such job ({})", job_id));
+		job = it->second;
+
+		// running job stops at the next interruption point and finishes as CANCELLED
+		if(job->status == ServeJobStatus::RUNNING)
+			job->cancel = true;
+		else if(job->status == ServeJobStatus::QUEUED)
+		{
+			auto &queue = _queues[job->queue];
+			queue.erase(std::remove(queue.begin(), queue.end(), job), queue.end());
+			job->status = ServeJobStatus::CANCELLED;
+		}
+		else
+			throw_line(fmt::format("job is not queued or running (job: {}, status: {})", job_id, enum_to_string(job->status, SERVE_JOB_STATUS_STRING)));
+	}
+
+	if(job->cancel)
+	{
+		client->Send(fmt::format("{{\"event\":\"cancelling\",\"job\":{}{}}}", job_id, id));
+		LOG("[job {}] cancelling", job_id);
+		return;
+	}
+
+	client->Send(fmt::format("{{\"event\":\"cancelled\",\"job\":{}{}}}", job_id, id));
+	LOG("[job {}] cancelled", job_id);
+
+	Notify(*job, serve_finished_event(*job));
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	job->watchers.clear();
+	PruneHistory();
+}
+
+
+void JobServer::Watch(std::shared_ptr<ServeClient> client, const JSONValue &request, const std::string &id)
+{
+	auto job_id = serve_job_id(request);
+
+	std::string status;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _jobs.find(job_id);
+		if(it == _jobs.end())
+			throw_line(fmt::format("no such job ({})", job_id));
+
+		auto &job = *it->second;
+		if(job.status == ServeJobStatus::QUEUED || job.status == ServeJobStatus::RUNNING)
+		{
+			if(std::find(job.watchers.begin(), job.watchers.end(), client) == job.watchers.end())
+				job.watchers.push_back(client);
+		}
+		status = enum_to_string(job.status, SERVE_JOB_STATUS_STRING);
+	}
+
+	client->Send(fmt::format("{{\"event\":\"watching\",\"job\":{},\"status\":\"{}\"{}}}", job_id, status, id));
+}
+
+
+std::string JobServer::Status()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::string jobs;
+	for(auto const &j : _jobs)
+	{
+		auto &job = *j.second;
+		jobs += fmt::format("{}{{\"job\":{},\"status\":\"{}\",\"queue\":{},\"command\":{},\"duration\":{:.3f},\"error\":{}}}", jobs.empty() ? "" : ",", job.id,
+				enum_to_string(job.status, SERVE_JOB_STATUS_STRING), json_string(job.queue), json_string(job.options->command), job.duration, json_string(job.error));
+	}
+
+	return "[" + jobs + "]";
+}
+
+
+std::string JobServer::Drives()
+{
+	auto list = SPTD::ListDrives();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for(auto const &q : _queues)
+		if(!q.first.empty())
+			list.insert(q.first);
+
+	std::string drives;
+	for(auto const &d : list)
+	{
+		auto it = _queues.find(d);
+		drives += fmt::format("{}{{\"drive\":{},\"queued\":{},\"running\":{}}}", drives.empty() ? "" : ",", json_string(d),
+				it == _queues.end() ? 0 : it->second.size(), _busy.find(d) == _busy.end() ? "false" : "true");
+	}
+
+	return "[" + drives + "]";
+}
+
+
+void JobServer::Shutdown()
+{
+	std::vector<std::shared_ptr<ServeJob>> cancelled;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_stop)
+			return;
+		_stop = true;
+
+		for(auto &q : _queues)
+		{
+			for(auto &j : q.second)
+			{
+				j->status = ServeJobStatus::CANCELLED;
+				cancelled.push_back(j);
+			}
+			q.second.clear();
+		}
+	}
+	_cv.notify_all();
+
+	LOG("shutdown requested, waiting for running jobs");
+
+	for(auto &j : cancelled)
+		Notify(*j, serve_finished_event(*j));
+}
+
+
+std::string JobServer::IdleDrive()
+{
+	std::set<std::string> busy;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		busy = _busy;
+		for(auto const &q : _queues)
+			if(!q.second.empty())
+				busy.insert(q.first);
+	}
+
+	for(auto const &d : SPTD::ListDrives())
+	{
+		if(busy.find(d) != busy.end())
+			continue;
+
+		try
+		{
+			SPTD sptd(d);
+			if(!cmd_drive_ready(sptd).status_code)
+				return d;
+		}
+		// drive busy
+		catch(const std::exception &)
+		{
+			;
+		}
+	}
+
+	throw_line("no idle ready drives detected on the system");
+}
+
+
+void JobServer::Worker(std::string queue)
+{
+	for(;;)
+	{
+		std::shared_ptr<ServeJob> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			auto &q = _queues[queue];
+			_cv.wait(lock, [&]() { return _stop || !q.empty(); });
+			if(q.empty())
+				break;
+
+			job = q.front();
+			q.pop_front();
+			job->status = ServeJobStatus::RUNNING;
+			if(!queue.empty())
+				_busy.insert(queue);
+		}
+
+		RunJob(job);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		_busy.erase(queue);
+		job->watchers.clear();
+		PruneHistory();
+	}
+}
+
+
+void JobServer::RunJob(std::shared_ptr<ServeJob> job)
+{
+	auto &options = *job->options;
+
+	LOG("[job {}] started", job->id);
+	Notify(*job, fmt::format("{{\"event\":\"started\",\"job\":{}}}", job->id));
+
+	auto start = std::chrono::steady_clock::now();
+
+	ServeJobStatus status;
+	std::string error;
+	try
+	{
+		LogRedirect log_redirect((std::filesystem::path(options.image_path) / options.image_name).string() + ".log",
+				[this, &job](const std::string &text, bool file) { Message(*job, text, file); });
+
+		LOG("{}\n", redumper_version());
+		LOG("command: {}\n", options.command);
+
+		// concurrent jobs share the process SIGINT handling, cancel is per job thread
+		SignalCancel signal_cancel([&job]() { return job->cancel.load(); });
+
+		try
+		{
+			redumper_modes(options);
+		}
+		catch(const std::exception &e)
+		{
+			LOG("error: {}", e.what());
+			throw;
+		}
+
+		status = job->cancel ? ServeJobStatus::CANCELLED : ServeJobStatus::SUCCESS;
+	}
+	catch(const std::exception &e)
+	{
+		status = ServeJobStatus::FAILED;
+		error = e.what();
+	}
+	catch(...)
+	{
+		status = ServeJobStatus::FAILED;
+		error = "unhandled exception";
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		job->status = status;
+		job->error = error;
+		job->duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	LOG("[job {}] finished: {} ({:.1f}s){}", job->id, enum_to_string(job->status, SERVE_JOB_STATUS_STRING), job->duration, error.empty() ? "" : fmt::format(", {}", error));
+	Notify(*job, serve_finished_event(*job));
+}
+
+
+void JobServer::Message(ServeJob &job, const std::string &text, bool file)
+{
+	// file messages are the job log, console only messages are progress updates
+	if(file)
+	{
+		std::string line(text);
+		if(!line.empty() && line.back() == '\n')
+			line.pop_back();
+
+		Notify(job, fmt::format("{{\"event\":\"log\",\"job\":{},\"text\":{}}}", job.id, json_string(line)));
+	}
+	else
+	{
+		int percent;
+		auto line = log_progress_line(text, percent);
+		if(line.empty())
+			return;
+
+		// progress is throttled, this runs on the job thread
+		auto now = std::chrono::steady_clock::now();
+		if(now - job.progress_time < PROGRESS_INTERVAL)
+			return;
+		job.progress_time = now;
+
+		Notify(job, fmt::format("{{\"event\":\"progress\",\"job\":{}{},\"text\":{}}}", job.id, percent < 0 ? "" : fmt::format(",\"percent\":{}", percent), json_string(line)));
+	}
+}
+
+
+void JobServer::Notify(const ServeJob &job, const std::string &event)
+{
+	std::vector<std::shared_ptr<ServeClient>> watchers;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		watchers = job.watchers;
+	}
+
+	for(auto &w : watchers)
+		w->Send(event);
+}
+
+
+void JobServer::PruneHistory()
+{
+	uint32_t finished = 0;
+	for(auto const &j : _jobs)
+		if(j.second->status != ServeJobStatus::QUEUED && j.second->status != ServeJobStatus::RUNNING)
+			++finished;
+
+	// oldest first
+	for(auto it = _jobs.begin(); it != _jobs.end() && finished > HISTORY_MAX;)
+	{
+		if(it->second->status != ServeJobStatus::QUEUED && it->second->status != ServeJobStatus::RUNNING)
+		{
+			it = _jobs.erase(it);
+			--finished;
+		}
+		else
+			++it;
+	}
+}
+
+#endif
+
+
+void redumper_serve(const Options &options)
+{
+#ifdef _WIN32
+	throw_line("serve mode is not supported on this platform");
+#else
+	JobServer server(options);
+	server.Run();
+#endif
+}
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+
+
+#include "options.hh"
+
+
+
+namespace gpsxre
+{
+
+void redumper_serve(const Options &options);
+
+}
@@ -1,15 +1,23 @@
+#include <cstdint>
+#include <mutex>
 #include <signal.h>
 #include "signal.hh"
 
 
 
 static volatile sig_atomic_t g_sigint_flag = 0;
+static volatile sig_atomic_t g_sigint_terminate = 0;
+static std::mutex g_engage_mutex;
+static uint32_t g_engage_count = 0;
 
 
 
 namespace gpsxre
 {
 
+thread_local SignalCancel *Signal::_cancel = nullptr;
+
+
 Signal &Signal::GetInstance()
 {
 	static Signal instance;
@@ -18,27 +26,44 @@ Signal &Signal::GetInstance()
 }
 
 
+void Signal::Install()
+{
+	signal(SIGINT, Handler);
+}
+
+
 void Signal::Engage()
 {
-	g_sigint_flag = 2;
+	std::lock_guard<std::mutex> lock(g_engage_mutex);
+	if(!g_engage_count++)
+		g_sigint_flag = 2;
 }
 
 
 void Signal::Disengage()
 {
-	g_sigint_flag = 0;
+	std::lock_guard<std::mutex> lock(g_engage_mutex);
+	if(g_engage_count && !--g_engage_count)
+		g_sigint_flag = 0;
 }
 
 
 bool Signal::Interrupt()
 {
-	return g_sigint_flag == 1;
+	return g_sigint_flag == 1 || (_cancel != nullptr && _cancel->_cancel && _cancel->_cancel());
 }
 
 
-Signal::Signal()
+bool Signal::Terminate()
 {
-	signal(SIGINT, Handler);
+	return g_sigint_terminate;
+}
+
+
+void Signal::TerminateProcess()
+{
+	signal(SIGINT, SIG_DFL);
+	raise(SIGINT);
 }
 
 
@@ -46,11 +71,43 @@ void Signal::Handler(int sig)
 {
 	if(!g_sigint_flag)
 	{
-		signal(sig, SIG_DFL);
-		raise(sig);
+		// not safe to do anything else here, terminate is handled outside, a repeated SIGINT terminates right away
+		if(g_sigint_terminate)
+		{
+			signal(sig, SIG_DFL);
+			raise(sig);
+		}
+		else
+			g_sigint_terminate = 1;
 	}
 	else if(g_sigint_flag == 2)
 		g_sigint_flag = 1;
 }
 
+
+SignalEngage::SignalEngage()
+{
+	Signal::GetInstance().Engage();
+}
+
+
+SignalEngage::~SignalEngage()
+{
+	Signal::GetInstance().Disengage();
+}
+
+
+SignalCancel::SignalCancel(std::function<bool()> cancel)
+	: _cancel(cancel)
+	, _previous(Signal::_cancel)
+{
+	Signal::_cancel = this;
+}
+
+
+SignalCancel::~SignalCancel()
+{
+	Signal::_cancel = _previous;
+}
+
 }
@@ -2,25 +2,74 @@
 
 
 
+#include <functional>
+
+
+
 namespace gpsxre
 {
 
+class SignalCancel;
+
 class Signal
 {
 public:
 	static Signal &GetInstance();
 
+	// installs process wide SIGINT handler, done by the command line front-end only
+	void Install();
+
+	// engaged sections nest and can run concurrently, SIGINT interrupts all of them until the last one is disengaged
 	void Engage();
 	void Disengage();
 	bool Interrupt();
 
+	// SIGINT received outside of an engaged section, process has to be terminated
+	bool Terminate();
+	void TerminateProcess();
+
 	Signal(Signal const &) = delete;
 	void operator=(Signal const &) = delete;
 
 private:
-	Signal();
+	static thread_local SignalCancel *_cancel;
+
+	Signal() = default;
 
 	static void Handler(int sig);
+
+	friend class SignalCancel;
+};
+
+
+// SIGINT stops the engaged section instead of terminating the process while in scope
+class SignalEngage
+{
+public:
+	SignalEngage();
+	~SignalEngage();
+
+	SignalEngage(const SignalEngage &) = delete;
+	SignalEngage &operator=(const SignalEngage &) = delete;
+};
+
+
+// while in scope, Interrupt() on the calling thread is also true once the callback returns true,
+// used to stop a dump without the process SIGINT handler (library)
+class SignalCancel
+{
+public:
+	SignalCancel(std::function<bool()> cancel);
+	~SignalCancel();
+
+	SignalCancel(const SignalCancel &) = delete;
+	SignalCancel &operator=(const SignalCancel &) = delete;
+
+private:
+	std::function<bool()> _cancel;
+	SignalCancel *_previous;
+
+	friend class Signal;
 };
 
 }
@@ -0,0 +1,416 @@
+#include "common.hh"
+#include "simd.hh"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#if defined(__GNUC__) || defined(__clang__)
+#include <immintrin.h>
+#define SIMD_AVX2
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#define SIMD_AVX2
+#define SIMD_TARGET_AVX2
+#endif
+#endif
+
+
+
+namespace gpsxre
+{
+
+static bool is_zeroed_scalar(const uint8_t *data, uint64_t size)
+{
+	for(uint64_t i = 0; i < size; ++i)
+		if(data[i])
+			return false;
+
+	return true;
+}
+
+
+static uint64_t find_non_zero_scalar(const uint8_t *data, uint64_t size)
+{
+	uint64_t i = 0;
+	for(; i < size; ++i)
+		if(data[i])
+			break;
+
+	return i;
+}
+
+
+static void xor_table_scalar(uint8_t *out, const uint8_t *in, const uint8_t *table, uint64_t size)
+{
+	for(uint64_t i = 0; i < size; ++i)
+		out[i] = in[i] ^ table[i];
+}
+
+
+static uint64_t diff_bytes_count_scalar(const uint8_t *data1, const uint8_t *data2, uint64_t size)
+{
+	uint64_t diff = 0;
+
+	for(uint64_t i = 0; i < size; ++i)
+		if(data1[i] != data2[i])
+			++diff;
+
+	return diff;
+}
+
+
+static uint64_t diff_bits_count_scalar(const uint8_t *data1, const uint8_t *data2, uint64_t size)
+{
+	uint64_t diff = 0;
+
+	for(uint64_t i = 0; i < size; ++i)
+		diff += bits_count((uint8_t)(data1[i] ^ data2[i]));
+
+	return diff;
+}
+
+
+static uint64_t find_byte_pair_scalar(const uint8_t *data, uint64_t size, uint8_t first, uint8_t last, uint64_t distance)
+{
+	for(uint64_t i = 0; i + distance < size; ++i)
+		if(data[i] == first && data[i + distance] == last)
+			return i;
+
+	return size;
+}
+
+
+#ifdef SIMD_SSE2
+// SWAR popcount of every byte, summed into two 64-bit lanes
+static __m128i popcount_sum_sse2(__m128i v)
+{
+	v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x55)));
+	v = _mm_add_epi8(_mm_and_si128(v, _mm_set1_epi8(0x33)), _mm_and_si128(_mm_srli_epi16(v, 2), _mm_set1_epi8(0x33)));
+	v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), _mm_set1_epi8(0x0F));
+
+	return _mm_sad_epu8(v, _mm_setzero_si128());
+}
+
+
+static uint64_t sum_epi64_sse2(__m128i v)
+{
+	uint64_t lanes[2];
+	_mm_storeu_si128((__m128i *)lanes, v);
+
+	return lanes[0] + lanes[1];
+}
+
+
+static bool is_zeroed_sse2(const uint8_t *data, uint64_t size)
+{
+	uint64_t i = 0;
+
+	// accumulate 64 bytes per test to keep the early exit cheap
+	for(; i + 64 <= size; i += 64)
+	{
+		__m128i v = _mm_or_si128(_mm_or_si128(_mm_loadu_si128((const __m128i *)&data[i]), _mm_loadu_si128((const __m128i *)&data[i + 16])),
+			_mm_or_si128(_mm_loadu_si128((const __m128i *)&data[i + 32]), _mm_loadu_si128((const __m128i *)&data[i + 48])));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF)
+			return false;
+	}
+
+	return is_zeroed_scalar(&data[i], size - i);
+}
+
+
+static uint64_t find_non_zero_sse2(const uint8_t *data, uint64_t size)
+{
+	uint64_t i = 0;
+
+	for(; i + 16 <= size; i += 16)
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&data[i]), _mm_setzero_si128())) != 0xFFFF)
+			break;
+
+	return i + find_non_zero_scalar(&data[i], size - i);
+}
+
+
+static void xor_table_sse2(uint8_t *out, const uint8_t *in, const uint8_t *table, uint64_t size)
+{
+	uint64_t i = 0;
+
+	for(; i + 16 <= size; i += 16)
+		_mm_storeu_si128((__m128i *)&out[i], _mm_xor_si128(_mm_loadu_si128((const __m128i *)&in[i]), _mm_loadu_si128((const __m128i *)&table[i])));
+
+	xor_table_scalar(&out[i], &in[i], &table[i], size - i);
+}
+
+
+static uint64_t diff_bytes_count_sse2(const uint8_t *data1, const uint8_t *data2, uint64_t size)
+{
+	uint64_t i = 0;
+	__m128i equal_sum = _mm_setzero_si128();
+
+	while(i + 16 <= size)
+	{
+		// per byte equal counters, flushed before they can overflow
+		__m128i equal = _mm_setzero_si128();
+		for(uint32_t j = 0; j < 255 && i + 16 <= size; ++j, i += 16)
+			equal = _mm_sub_epi8(equal, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&data1[i]), _mm_loadu_si128((const __m128i *)&data2[i])));
+		equal_sum = _mm_add_epi64(equal_sum, _mm_sad_epu8(equal, _mm_setzero_si128()));
+	}
+
+	return i - sum_epi64_sse2(equal_sum) + diff_bytes_count_scalar(&data1[i], &data2[i], size - i);
+}
+
+
+static uint64_t diff_bits_count_sse2(const uint8_t *data1, const uint8_t *data2, uint64_t size)
+{
+	uint64_t i = 0;
+	__m128i sum = _mm_setzero_si128();
+
+	for(; i + 16 <= size; i += 16)
+		sum = _mm_add_epi64(sum, popcount_sum_sse2(_mm_xor_si128(_mm_loadu_si128((const __m128i *)&data1[i]), _mm_loadu_si128((const __m128i *)&data2[i]))));
+
+	return sum_epi64_sse2(sum) + diff_bits_count_scalar(&data1[i], &data2[i], size - i);
+}
+
+
+static uint64_t find_byte_pair_sse2(const uint8_t *data, uint64_t size, uint8_t first, uint8_t last, uint64_t distance)
+{
+	uint64_t i = 0;
+	__m128i f = _mm_set1_epi8((char)first);
+	__m128i l = _mm_set1_epi8((char)last);
+
+	// both ends of the candidate are compared at once
+	for(; i + distance + 16 <= size; i += 16)
+	{
+		__m128i match = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&data[i]), f), _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&data[i + distance]), l));
+		if(_mm_movemask_epi8(match))
+			return i + find_byte_pair_scalar(&data[i], 16 + distance, first, last, distance);
+	}
+
+	uint64_t position = find_byte_pair_scalar(&data[i], size - i, first, last, distance);
+	return position == size - i ? size : i + position;
+}
+#endif
+
+
+#ifdef SIMD_AVX2
+SIMD_TARGET_AVX2 static uint64_t sum_epi64_avx2(__m256i v)
+{
+	uint64_t lanes[4];
+	_mm256_storeu_si256((__m256i *)lanes, v);
+
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+
+SIMD_TARGET_AVX2 static bool is_zeroed_avx2(const uint8_t *data, uint64_t size)
+{
+	uint64_t i = 0;
+
+	for(; i + 128 <= size; i += 128)
+	{
+		__m256i v = _mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256((const __m256i *)&data[i]), _mm256_loadu_si256((const __m256i *)&data[i + 32])),
+			_mm256_or_si256(_mm256_loadu_si256((const __m256i *)&data[i + 64]), _mm256_loadu_si256((const __m256i *)&data[i + 96])));
+		if(!_mm256_testz_si256(v, v))
+			return false;
+	}
+
+	for(; i + 32 <= size; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)&data[i]);
+		if(!_mm256_testz_si256(v, v))
+			return false;
+	}
+
+	return is_zeroed_scalar(&data[i], size - i);
+}
+
+
+SIMD_TARGET_AVX2 static uint64_t find_non_zero_avx2(const uint8_t *data, uint64_t size)
+{
+	uint64_t i = 0;
+
+	for(; i + 32 <= size; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)&data[i]);
+		if(!_mm256_testz_si256(v, v))
+			break;
+	}
+
+	return i + find_non_zero_scalar(&data[i], size - i);
+}
+
+
+SIMD_TARGET_AVX2 static void xor_table_avx2(uint8_t *out, const uint8_t *in, const uint8_t *table, uint64_t size)
+{
+	uint64_t i = 0;
+
+	for(; i + 32 <= size; i += 32)
+		_mm256_storeu_si256((__m256i *)&out[i], _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&in[i]), _mm256_loadu_si256((const __m256i *)&table[i])));
+
+	xor_table_scalar(&out[i], &in[i], &table[i], size - i);
+}
+
+
+SIMD_TARGET_AVX2 static uint64_t diff_bytes_count_avx2(const uint8_t *data1, const uint8_t *data2, uint64_t size)
+{
+	uint64_t i = 0;
+	__m256i equal_sum = _mm256_setzero_si256();
+
+	while(i + 32 <= size)
+	{
+		__m256i equal = _mm256_setzero_si256();
+		for(uint32_t j = 0; j < 255 && i + 32 <= size; ++j, i += 32)
+			equal = _mm256_sub_epi8(equal, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)&data1[i]), _mm256_loadu_si256((const __m256i *)&data2[i])));
+		equal_sum = _mm256_add_epi64(equal_sum, _mm256_sad_epu8(equal, _mm256_setzero_si256()));
+	}
+
+	return i - sum_epi64_avx2(equal_sum) + diff_bytes_count_scalar(&data1[i], &data2[i], size - i);
+}
+
+
+SIMD_TARGET_AVX2 static uint64_t diff_bits_count_avx2(const uint8_t *data1, const uint8_t *data2, uint64_t size)
+{
+	uint64_t i = 0;
+
+	// nibble lookup popcount
+	const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+	__m256i sum = _mm256_setzero_si256();
+
+	for(; i + 32 <= size; i += 32)
+	{
+		__m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)&data1[i]), _mm256_loadu_si256((const __m256i *)&data2[i]));
+		__m256i count = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(v, nibble_mask)), _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble_mask)));
+		sum = _mm256_add_epi64(sum, _mm256_sad_epu8(count, _mm256_setzero_si256()));
+	}
+
+	return sum_epi64_avx2(sum) + diff_bits_count_scalar(&data1[i], &data2[i], size - i);
+}
+
+
+SIMD_TARGET_AVX2 static uint64_t find_byte_pair_avx2(const uint8_t *data, uint64_t size, uint8_t first, uint8_t last, uint64_t distance)
+{
+	uint64_t i = 0;
+	__m256i f = _mm256_set1_epi8((char)first);
+	__m256i l = _mm256_set1_epi8((char)last);
+
+	for(; i + distance + 32 <= size; i += 32)
+	{
+		__m256i match = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)&data[i]), f), _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)&data[i + distance]), l));
+		if(_mm256_movemask_epi8(match))
+			return i + find_byte_pair_scalar(&data[i], 32 + distance, first, last, distance);
+	}
+
+	uint64_t position = find_byte_pair_scalar(&data[i], size - i, first, last, distance);
+	return position == size - i ? size : i + position;
+}
+
+
+static bool cpu_supports_avx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	int info[4];
+	__cpuid(info, 0);
+	if(info[0] < 7)
+		return false;
+
+	// CPU AVX support and OS saves YMM registers
+	__cpuid(info, 1);
+	if((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#endif
+}
+#endif
+
+
+static const SimdKernels KERNELS_SCALAR = { SimdLevel::SCALAR, is_zeroed_scalar, find_non_zero_scalar, xor_table_scalar, diff_bytes_count_scalar, diff_bits_count_scalar, find_byte_pair_scalar };
+#ifdef SIMD_SSE2
+static const SimdKernels KERNELS_SSE2 = { SimdLevel::SSE2, is_zeroed_sse2, find_non_zero_sse2, xor_table_sse2, diff_bytes_count_sse2, diff_bits_count_sse2, find_byte_pair_sse2 };
+#endif
+#ifdef SIMD_AVX2
+static const SimdKernels KERNELS_AVX2 = { SimdLevel::AVX2, is_zeroed_avx2, find_non_zero_avx2, xor_table_avx2, diff_bytes_count_avx2, diff_bits_count_avx2, find_byte_pair_avx2 };
+#endif
+
+
+std::vector<const SimdKernels *> simd_kernels_available()
+{
+	std::vector<const SimdKernels *> kernels;
+
+	kernels.push_back(&KERNELS_SCALAR);
+#ifdef SIMD_SSE2
+	kernels.push_back(&KERNELS_SSE2);
+#endif
+#ifdef SIMD_AVX2
+	if(cpu_supports_avx2())
+		kernels.push_back(&KERNELS_AVX2);
+#endif
+
+	return kernels;
+}
+
+
+const SimdKernels &simd_kernels()
+{
+	static const SimdKernels &kernels = *simd_kernels_available().back();
+
+	return kernels;
+}
+
+
+std::string simd_level_string(SimdLevel level)
+{
+	switch(level)
+	{
+	case SimdLevel::SSE2:
+		return "SSE2";
+	case SimdLevel::AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+
+bool simd_is_zeroed(const uint8_t *data, uint64_t size)
+{
+	return simd_kernels().is_zeroed(data, size);
+}
+
+
+uint64_t simd_find_non_zero(const uint8_t *data, uint64_t size)
+{
+	return simd_kernels().find_non_zero(data, size);
+}
+
+
+void simd_xor_table(uint8_t *out, const uint8_t *in, const uint8_t *table, uint64_t size)
+{
+	simd_kernels().xor_table(out, in, table, size);
+}
+
+
+uint64_t simd_diff_bytes_count(const uint8_t *data1, const uint8_t *data2, uint64_t size)
+{
+	return simd_kernels().diff_bytes_count(data1, data2, size);
+}
+
+
+uint64_t simd_diff_bits_count(const uint8_t *data1, const uint8_t *data2, uint64_t size)
+{
+	return simd_kernels().diff_bits_count(data1, data2, size);
+}
+
+
+uint64_t simd_find_byte_pair(const uint8_t *data, uint64_t size, uint8_t first, uint8_t last, uint64_t distance)
+{
+	return simd_kernels().find_byte_pair(data, size, first, last, distance);
+}
+
+}
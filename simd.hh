@@ -0,0 +1,52 @@
+#pragma once
+
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+
+namespace gpsxre
+{
+
+enum class SimdLevel
+{
+	SCALAR,
+	SSE2,
+	AVX2
+};
+
+// byte buffer primitives, every implementation produces identical results
+struct SimdKernels
+{
+	SimdLevel level;
+
+	bool (*is_zeroed)(const uint8_t *data, uint64_t size);
+	// returns size if all bytes are zero
+	uint64_t (*find_non_zero)(const uint8_t *data, uint64_t size);
+	// in-place operation (out == in) is allowed
+	void (*xor_table)(uint8_t *out, const uint8_t *in, const uint8_t *table, uint64_t size);
+	uint64_t (*diff_bytes_count)(const uint8_t *data1, const uint8_t *data2, uint64_t size);
+	uint64_t (*diff_bits_count)(const uint8_t *data1, const uint8_t *data2, uint64_t size);
+	// first position i where data[i] == first and data[i + distance] == last, returns size if not found
+	uint64_t (*find_byte_pair)(const uint8_t *data, uint64_t size, uint8_t first, uint8_t last, uint64_t distance);
+};
+
+// best implementation supported by the CPU, detected once
+const SimdKernels &simd_kernels();
+
+// all implementations supported by the CPU, starting with scalar
+std::vector<const SimdKernels *> simd_kernels_available();
+
+std::string simd_level_string(SimdLevel level);
+
+bool simd_is_zeroed(const uint8_t *data, uint64_t size);
+uint64_t simd_find_non_zero(const uint8_t *data, uint64_t size);
+void simd_xor_table(uint8_t *out, const uint8_t *in, const uint8_t *table, uint64_t size);
+uint64_t simd_diff_bytes_count(const uint8_t *data1, const uint8_t *data2, uint64_t size);
+uint64_t simd_diff_bits_count(const uint8_t *data1, const uint8_t *data2, uint64_t size);
+uint64_t simd_find_byte_pair(const uint8_t *data, uint64_t size, uint8_t first, uint8_t last, uint64_t distance);
+
+}
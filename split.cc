@@ -1,186 +1,71 @@
 #include <chrono>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <map>
+#include <set>
 #include <sstream>
+#include <tuple>
 #include "systems/system.hh"
+#include "accuraterip.hh"
 #include "common.hh"
 #include "crc32.hh"
+#include "dat_index.hh"
 #include "ecc_edc.hh"
 #include "file_io.hh"
 #include "image_browser.hh"
+#include "interval_set.hh"
 #include "logger.hh"
 #include "md5.hh"
+#include "pattern_scanner.hh"
+#include "profiler.hh"
 #include "scrambler.hh"
 #include "sha1.hh"
 #include "split.hh"
+#include "thread_pool.hh"
+#include "track_sink.hh"
 
 
 
 namespace gpsxre
 {
 
-bool correct_program_subq(ChannelQ *subq, uint32_t sectors_count)
-{
-	uint32_t mcn = sectors_count;
-	std::map<uint8_t, uint32_t> isrc;
-	ChannelQ q_empty;
-	memset(&q_empty, 0, sizeof(q_empty));
-
-	bool invalid_subq = true;
-	uint8_t tno = 0;
-	for(uint32_t lba_index = 0; lba_index < sectors_count; ++lba_index)
-	{
-		if(!subq[lba_index].Valid())
-			continue;
-
-		invalid_subq = false;
-
-		uint8_t adr = subq[lba_index].control_adr & 0x0F;
-		if(adr == 1)
-			tno = subq[lba_index].mode1.tno;
-		else if(adr == 2 && mcn == sectors_count)
-			mcn = lba_index;
-		else if(adr == 3 && tno && isrc.find(tno) == isrc.end())
-			isrc[tno] = lba_index;
-	}
-
-	if(invalid_subq)
-		return false;
-
-	uint32_t q_prev = sectors_count;
-	uint32_t q_next = 0;
-	for(uint32_t lba_index = 0; lba_index < sectors_count; ++lba_index)
-	{
-		if(!memcmp(&subq[lba_index], &q_empty, sizeof(q_empty)))
-			continue;
-
-		if(subq[lba_index].Valid())
-		{
-			uint8_t adr = subq[lba_index].control_adr & 0x0F;
-			if(adr == 1)
-			{
-				if(subq[lba_index].mode1.tno)
-					q_prev = lba_index;
-				else
-					q_prev = sectors_count;
-			}
-		}
-		else
-		{
-			// find next valid Q
-			if(lba_index >= q_next && q_next != sectors_count)
-			{
-				q_next = lba_index + 1;
-				for(; q_next < sectors_count; ++q_next)
-					if(subq[q_next].Valid())
-					{
-						uint8_t adr = subq[q_next].control_adr & 0x0F;
-						if(adr == 1)
-						{
-							if(!subq[q_next].mode1.tno)
-								q_next = 0;
-
-							break;
-						}
-					}
-			}
-
-			std::vector<ChannelQ> candidates;
-			if(q_prev < lba_index)
-			{
-				// mode 1
-				candidates.emplace_back(subchannel_q_generate_mode1(subq[q_prev], lba_index - q_prev));
-
-				// mode 2
-				if(mcn != sectors_count)
-					candidates.emplace_back(subchannel_q_generate_mode2(subq[mcn], subq[q_prev], lba_index - q_prev));
-
-				// mode 3
-				if(!isrc.empty())
-				{
-					auto it = isrc.find(subq[q_prev].mode1.tno);
-					if(it != isrc.end())
-						candidates.emplace_back(subchannel_q_generate_mode3(subq[it->second], subq[q_prev], lba_index - q_prev));
-				}
-			}
-
-			if(q_next > lba_index && q_next != sectors_count)
-			{
-				// mode 1
-				candidates.emplace_back(subchannel_q_generate_mode1(subq[q_next], lba_index - q_next));
-
-				// mode 2
-				if(mcn != sectors_count)
-					candidates.emplace_back(subchannel_q_generate_mode2(subq[mcn], subq[q_next], lba_index - q_next));
-
-				// mode 3
-				if(!isrc.empty())
-				{
-					auto it = isrc.find(subq[q_next].mode1.tno);
-					if(it != isrc.end())
-						candidates.emplace_back(subchannel_q_generate_mode3(subq[it->second], subq[q_next], lba_index - q_next));
-				}
-			}
-
-			if(!candidates.empty())
-			{
-				uint32_t c = 0;
-				for(uint32_t j = 0; j < (uint32_t)candidates.size(); ++j)
-					if(bit_diff((uint32_t *)&subq[lba_index], (uint32_t *)&candidates[j], sizeof(ChannelQ) / sizeof(uint32_t)) < bit_diff((uint32_t *)&subq[lba_index], (uint32_t *)&candidates[c], sizeof(ChannelQ) / sizeof(uint32_t)))
-						c = j;
-
-				subq[lba_index] = candidates[c];
-			}
-		}
-	}
-
-	return true;
-}
-
-
-int32_t track_offset_by_sync(int32_t lba_start, int32_t lba_end, std::fstream &state_fs, std::fstream &scm_fs)
+int32_t track_offset_by_sync(int32_t lba_start, int32_t lba_end, std::fstream &scm_fs)
 {
 	int32_t write_offset = std::numeric_limits<int32_t>::max();
 
-	constexpr uint32_t sectors_to_check = 2;
+	constexpr uint32_t sectors_to_check = 64;
 
 	std::vector<uint8_t> data(sectors_to_check * CD_DATA_SIZE);
-	std::vector<State> state(sectors_to_check * CD_DATA_SIZE_SAMPLES);
+	std::vector<uint8_t> sector(CD_DATA_SIZE);
+	PatternScanner scanner({ std::vector<uint8_t>(std::begin(CD_DATA_SYNC), std::end(CD_DATA_SYNC)) });
+	Scrambler scrambler;
 
-	uint32_t groups_count = (lba_end - lba_start) / sectors_to_check;
-	for(uint32_t i = 0; i < groups_count; ++i)
+	uint64_t range_size = (uint64_t)std::max(lba_end - lba_start, 0) * CD_DATA_SIZE;
+	batch_process_range<int32_t>(std::pair(lba_start, std::max(lba_start, lba_end)), sectors_to_check, [&](int32_t lba, int32_t count) -> bool
 	{
-		int32_t lba = lba_start + i * sectors_to_check;
-		read_entry(scm_fs, data.data(), CD_DATA_SIZE, lba - LBA_START, sectors_to_check, 0, 0);
-		read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba - LBA_START, sectors_to_check, 0, (uint8_t)State::ERROR_SKIP);
-
-		for(auto const &s : state)
-			if(s == State::ERROR_SKIP || s == State::ERROR_C2)
-				continue;
+		read_entry(scm_fs, data.data(), CD_DATA_SIZE, lba - LBA_START, count, 0, 0);
 
-		auto it = std::search(data.begin(), data.end(), std::begin(CD_DATA_SYNC), std::end(CD_DATA_SYNC));
-		if(it != data.end())
+		return scanner.Feed(data.data(), count * CD_DATA_SIZE, [&](uint32_t, uint64_t position)
 		{
-			auto sector_offset = (uint32_t)(it - data.begin());
-
 			// enough data for one sector
-			if(data.size() - sector_offset >= CD_DATA_SIZE)
-			{
-				Sector &sector = *(Sector *)&data[sector_offset];
-				Scrambler scrambler;
-				scrambler.Descramble((uint8_t *)&sector, nullptr);
+			if(range_size - position < CD_DATA_SIZE)
+				return false;
 
-				if(BCDMSF_valid(sector.header.address))
-				{
-					int32_t sector_lba = BCDMSF_to_LBA(sector.header.address);
-					write_offset = ((int32_t)sector_offset - (sector_lba - lba) * (int32_t)CD_DATA_SIZE) / (int32_t)CD_SAMPLE_SIZE;
+			// sector can span chunks, read it separately
+			read_entry(scm_fs, sector.data(), CD_DATA_SIZE, lba_start - LBA_START, 1, -(int32_t)position, 0);
+			scrambler.Descramble(sector.data(), nullptr);
 
-					break;
-				}
-			}
-		}
-	}
+			auto s = (Sector *)sector.data();
+			if(!BCDMSF_valid(s->header.address))
+				return false;
+
+			int32_t sector_lba = BCDMSF_to_LBA(s->header.address);
+			write_offset = ((int32_t)position - (sector_lba - lba_start) * (int32_t)CD_DATA_SIZE) / (int32_t)CD_SAMPLE_SIZE;
+
+			return true;
+		});
+	});
 
 	return write_offset;
 }
@@ -203,14 +88,17 @@ int32_t byte_offset_by_magic(int32_t lba_start, int32_t lba_end, std::fstream &s
 		if(s == State::ERROR_SKIP || s == State::ERROR_C2)
 		{
 			data_correct = false;
-			continue;
+			break;
 		}
 
 	if(data_correct)
 	{
-		auto it = std::search(data.begin(), data.end(), magic.begin(), magic.end());
-		if(it != data.end())
-			write_offset = (uint32_t)(it - data.begin());
+		PatternScanner scanner({ std::vector<uint8_t>(magic.begin(), magic.end()) });
+		scanner.Find(data.data(), data.size(), [&](uint32_t, uint64_t position)
+		{
+			write_offset = (int32_t)position;
+			return true;
+		});
 	}
 
 	return write_offset;
@@ -231,15 +119,17 @@ int32_t track_find_offset_shift(int32_t write_offset, int32_t lba, uint32_t coun
 	std::vector<uint8_t> data(count * CD_DATA_SIZE);
 	read_entry(scm_fs, data.data(), CD_DATA_SIZE, lba - LBA_START, count, -write_offset * CD_SAMPLE_SIZE, 0);
 
+	// first sample aligned sync past the beginning
 	uint32_t sector_shift = 0;
-	for(uint32_t i = 0; i < data.size() - sizeof(CD_DATA_SYNC); i += CD_SAMPLE_SIZE)
+	PatternScanner scanner({ std::vector<uint8_t>(std::begin(CD_DATA_SYNC), std::end(CD_DATA_SYNC)) });
+	scanner.Find(data.data(), data.size() - 1, [&](uint32_t, uint64_t position)
 	{
-		if(i && !memcmp(&data[i], CD_DATA_SYNC, sizeof(CD_DATA_SYNC)))
-		{
-			sector_shift = i % CD_DATA_SIZE;
-			break;
-		}
-	}
+		if(!position || position % CD_SAMPLE_SIZE)
+			return false;
+
+		sector_shift = position % CD_DATA_SIZE;
+		return true;
+	});
 
 	if(sector_shift)
 	{
@@ -293,6 +183,16 @@ uint32_t iso9660_volume_size(std::fstream &scm_fs, uint64_t scm_offset, bool scr
 }
 
 
+int32_t split_track_end(const TOC::Session::Track &t, std::fstream &scm_fs, int32_t write_offset, int32_t lba_start, bool scrap, const Options &options)
+{
+	//FIXME: omit iso9660 volume size if the filesystem is different
+	if(options.iso9660_trim && (t.control & (uint8_t)ChannelQ::Control::DATA) && !t.indices.empty())
+		return t.lba_start + iso9660_volume_size(scm_fs, (-lba_start + t.indices.front()) * CD_DATA_SIZE + write_offset * CD_SAMPLE_SIZE, scrap);
+
+	return t.lba_end;
+}
+
+
 bool optional_track(uint32_t track_number)
 {
 	return track_number == 0x00 || track_number == bcd_decode(CD_LEADOUT_TRACK_NUMBER);
@@ -300,11 +200,12 @@ bool optional_track(uint32_t track_number)
 
 
 bool check_tracks(const TOC &toc, std::fstream &scm_fs, std::fstream &state_fs, int32_t write_offset_data, int32_t write_offset_audio,
-                  const std::vector<std::pair<int32_t, int32_t>> &skip_ranges, int32_t lba_start, bool scrap, const Options &options)
+                  const IntervalSet &skip_ranges, int32_t lba_start, bool scrap, const Options &options)
 {
 	bool no_errors = true;
 
 	std::vector<State> state(CD_DATA_SIZE_SAMPLES);
+	IntervalSet::Cursor skip_cursor(skip_ranges);
 
 	LOG("checking tracks");
 
@@ -327,12 +228,10 @@ bool check_tracks(const TOC &toc, std::fstream &scm_fs, std::fstream &state_fs,
 			uint32_t skip_sectors = 0;
 			uint32_t c2_sectors = 0;
 
-			//FIXME: omit iso9660 volume size if the filesystem is different
-
-			uint32_t track_length = options.iso9660_trim && data_track && !t.indices.empty() ? iso9660_volume_size(scm_fs, (-lba_start + t.indices.front()) * CD_DATA_SIZE + write_offset * CD_SAMPLE_SIZE, scrap) : t.lba_end - t.lba_start;
-			for(int32_t lba = t.lba_start; lba < t.lba_start + (int32_t)track_length; ++lba)
+			int32_t lba_end = split_track_end(t, scm_fs, write_offset, lba_start, scrap, options);
+			for(int32_t lba = t.lba_start; lba < lba_end; ++lba)
 			{
-				if(inside_range(lba, skip_ranges) != nullptr)
+				if(skip_cursor.Find(lba) != nullptr)
 					continue;
 
 				uint32_t lba_index = lba - lba_start;
@@ -379,16 +278,171 @@ bool check_tracks(const TOC &toc, std::fstream &scm_fs, std::fstream &state_fs,
 }
 
 
+// raw state and scrambled data of a track range, any refine change to the range changes the value
+uint32_t track_input_crc_update(uint32_t crc, const State *state, const uint8_t *sector)
+{
+	crc = crc32((const uint8_t *)state, CD_DATA_SIZE_SAMPLES, crc);
+	return crc32(sector, CD_DATA_SIZE, crc);
+}
+
+
+uint32_t track_input_crc(std::fstream &scm_fs, std::fstream &state_fs, int32_t lba_start, int32_t lba_end, int32_t write_offset, int32_t lba_base)
+{
+	constexpr uint32_t CHUNK_SECTORS = 1024;
+
+	std::vector<uint8_t> data(CHUNK_SECTORS * CD_DATA_SIZE);
+	std::vector<State> state(CHUNK_SECTORS * CD_DATA_SIZE_SAMPLES);
+
+	uint32_t crc = crc32_seed();
+	for(int32_t lba = lba_start; lba < lba_end; lba += CHUNK_SECTORS)
+	{
+		uint32_t lba_index = lba - lba_base;
+		uint32_t count = std::min(CHUNK_SECTORS, (uint32_t)(lba_end - lba));
+
+		read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba_index, count, -write_offset, (uint8_t)State::ERROR_SKIP);
+		read_entry(scm_fs, data.data(), CD_DATA_SIZE, lba_index, count, -write_offset * CD_SAMPLE_SIZE, 0);
+
+		for(uint32_t i = 0; i < count; ++i)
+			crc = track_input_crc_update(crc, &state[i * CD_DATA_SIZE_SAMPLES], &data[i * CD_DATA_SIZE]);
+	}
+
+	return crc32_final(crc);
+}
+
+
+// every option that changes split output
+std::string split_options_key(const Options &options, bool scrap)
+{
+	return fmt::format("{} {} {} {} {}", options.leave_unchanged, options.skip_fill, options.iso9660_trim, options.correct_offset_shift, scrap);
+}
+
+
+std::map<std::string, TrackEntry> split_load(const std::filesystem::path &split_path, const std::string &split_key)
+{
+	std::map<std::string, TrackEntry> entries;
+
+	std::fstream fs(split_path, std::fstream::in);
+	if(!fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", split_path.filename().string()));
+
+	std::string line;
+	while(std::getline(fs, line))
+	{
+		auto tokens(tokenize(line, " \t", "\"\""));
+
+		// split options differ, nothing can be reused
+		if(tokens.size() == 2 && tokens[0] == "options" && tokens[1] != split_key)
+		{
+			entries.clear();
+			break;
+		}
+		else if(tokens.size() == 11 && tokens[0] == "track")
+		{
+			TrackEntry e;
+			e.filename = tokens[1];
+			e.lba_start = std::stoi(tokens[2]);
+			e.lba_end = std::stoi(tokens[3]);
+			e.write_offset = std::stoi(tokens[4]);
+			e.input_crc = (uint32_t)std::stoul(tokens[5], nullptr, 16);
+			e.data_mode = (uint8_t)std::stoul(tokens[6]);
+			e.size = std::stoull(tokens[7]);
+			e.crc = (uint32_t)std::stoul(tokens[8], nullptr, 16);
+			e.md5 = tokens[9];
+			e.sha1 = tokens[10];
+			entries[e.filename] = e;
+		}
+	}
+
+	return entries;
+}
+
+
+void split_save(const std::filesystem::path &split_path, const std::string &split_key, const std::vector<TrackEntry> &track_entries)
+{
+	std::fstream fs(split_path, std::fstream::out);
+	if(!fs.is_open())
+		throw_line(fmt::format("unable to create file ({})", split_path.filename().string()));
+
+	fs << fmt::format("options \"{}\"", split_key) << std::endl;
+	for(auto const &e : track_entries)
+		fs << fmt::format("track \"{}\" {} {} {} {:08x} {} {} {:08x} {} {}", e.filename, e.lba_start, e.lba_end, e.write_offset, e.input_crc, e.data_mode, e.size, e.crc, e.md5, e.sha1) << std::endl;
+}
+
+
+std::string track_basename(const TOC &toc, uint32_t session_number, uint32_t track_number, const std::string &image_name)
+{
+	std::string track_string = toc.TrackString(track_number);
+	bool lilo = track_number == 0x00 || track_number == bcd_decode(CD_LEADOUT_TRACK_NUMBER);
+
+	// add session number to lead-in/lead-out track string to make filename unique
+	if(lilo && toc.sessions.size() > 1)
+		track_string = fmt::format("{}.{}", track_string, session_number);
+
+	return fmt::format("{}{}", image_name, toc.TracksCount() > 1 || lilo ? fmt::format(" (Track {})", track_string) : "");
+}
+
+
+// outputs of a previous split with the same options are updated in place, anything else requires --overwrite;
+// checked before any work is done
+void split_check_outputs(const TOC &toc, const std::map<std::string, TrackEntry> &split_entries, const Options &options)
+{
+	if(options.dry_run || options.overwrite)
+		return;
+
+	auto formats = track_sink_formats(options.split_output);
+
+	std::vector<std::string> filenames;
+	for(auto const &s : toc.sessions)
+		for(auto const &t : s.tracks)
+		{
+			// skip empty tracks
+			if(t.lba_end == t.lba_start)
+				continue;
+
+			std::string track_name = track_basename(toc, s.session_number, t.track_number, options.image_name);
+			for(auto const &f : formats)
+			{
+				std::string filename = fmt::format("{}.{}", track_name, f);
+				if(track_sink_applicable(f, t.control & (uint8_t)ChannelQ::Control::DATA) && split_entries.find(filename) == split_entries.end())
+					filenames.push_back(filename);
+			}
+		}
+
+	// CUE-sheets aren't recorded but belong to the recorded split
+	if(split_entries.empty())
+		for(uint32_t i = 0; i < std::max(toc.cd_text_lang.size(), (size_t)1); ++i)
+			filenames.push_back(i ? fmt::format("{}_{:02X}.cue", options.image_name, toc.cd_text_lang[i]) : fmt::format("{}.cue", options.image_name));
+
+	for(auto const &f : filenames)
+		if(std::filesystem::exists(std::filesystem::path(options.image_path) / f))
+			throw_line(fmt::format("file already exists ({})", f));
+}
+
+
 void write_tracks(std::vector<TrackEntry> &track_entries, TOC &toc, std::fstream &scm_fs, std::fstream &state_fs, int32_t write_offset_data, int32_t write_offset_audio,
-                  const std::vector<std::pair<int32_t, int32_t>> &skip_ranges, int32_t lba_start, bool scrap, const Options &options)
+                  const IntervalSet &skip_ranges, int32_t lba_start, bool scrap, const std::map<std::string, TrackEntry> &split_entries, const Options &options)
 {
+	PROFILE_SCOPE("write_tracks");
+
 	Scrambler scrambler;
 	std::vector<uint8_t> sector(CD_DATA_SIZE);
 	std::vector<State> state(CD_DATA_SIZE_SAMPLES);
+	std::vector<uint8_t> subcode(CD_SUBCODE_SIZE);
 
 	bool offset_shift_warning = true;
 
-	LOG("splitting tracks");
+	auto formats = track_sink_formats(options.split_output);
+
+	std::fstream sub_fs;
+	if(std::find(formats.begin(), formats.end(), "sub") != formats.end())
+	{
+		std::filesystem::path sub_path(std::filesystem::path(options.image_path) / (options.image_name + ".subcode"));
+		sub_fs.open(sub_path, std::fstream::in | std::fstream::binary);
+		if(!sub_fs.is_open())
+			throw_line(fmt::format("unable to open file ({})", sub_path.filename().string()));
+	}
+
+	LOG(options.dry_run ? "hashing tracks (dry run)" : "splitting tracks");
 
 	auto time_start = std::chrono::high_resolution_clock::now();
 	for(auto &s : toc.sessions)
@@ -404,44 +458,72 @@ void write_tracks(std::vector<TrackEntry> &track_entries, TOC &toc, std::fstream
 			bool data_mode_set = false;
 			bool force_descramble = false;
 
-			std::string track_string = toc.TrackString(t.track_number);
-			bool lilo = t.track_number == 0x00 || t.track_number == bcd_decode(CD_LEADOUT_TRACK_NUMBER);
+			std::string track_name = track_basename(toc, s.session_number, t.track_number, options.image_name);
+
+			std::vector<std::string> track_formats;
+			for(auto const &f : formats)
+				if(track_sink_applicable(f, data_track))
+					track_formats.push_back(f);
 
-			// add session number to lead-in/lead-out track string to make filename unique
-			if(lilo && toc.sessions.size() > 1)
-				track_string = fmt::format("{}.{}", track_string, s.session_number);
+			int32_t lba_end = split_track_end(t, scm_fs, write_offset, lba_start, scrap, options);
 
-			std::string track_name = fmt::format("{}{}.bin", options.image_name, toc.TracksCount() > 1 || lilo ? fmt::format(" (Track {})", track_string) : "");
-			LOG("writing \"{}\"", track_name);
+			// reuse previously split track if none of its sectors changed and all outputs are in place
+			std::vector<TrackEntry> reused_entries;
+			for(auto const &f : track_formats)
+			{
+				auto it = split_entries.find(fmt::format("{}.{}", track_name, f));
+				if(it == split_entries.end())
+					break;
+
+				auto const &e = it->second;
+				auto track_path = std::filesystem::path(options.image_path) / e.filename;
+				if(e.lba_start != t.lba_start || e.lba_end != lba_end || e.write_offset != write_offset ||
+				   !std::filesystem::exists(track_path) || std::filesystem::file_size(track_path) != e.size)
+					break;
 
-			if(std::filesystem::exists(std::filesystem::path(options.image_path) / track_name) && !options.overwrite)
-				throw_line(fmt::format("file already exists ({})", track_name));
+				reused_entries.push_back(e);
+			}
+			// input is hashed only when there is something to reuse, first split hashes it while writing
+			if(!reused_entries.empty() && reused_entries.size() == track_formats.size() &&
+			   track_input_crc(scm_fs, state_fs, t.lba_start, lba_end, write_offset, lba_start) == reused_entries.front().input_crc)
+			{
+				LOG("unchanged \"{}.bin\"", track_name);
 
-			std::fstream fs_bin(std::filesystem::path(options.image_path) / track_name, std::fstream::out | std::fstream::binary);
-			if(!fs_bin.is_open())
-				throw_line(fmt::format("unable to create file ({})", track_name));
+				if(data_track)
+					t.data_mode = reused_entries.front().data_mode;
+				track_entries.insert(track_entries.end(), reused_entries.begin(), reused_entries.end());
+				continue;
+			}
 
-			TrackEntry track_entry;
-			track_entry.filename = track_name;
+			LOG("{} \"{}.bin\"", options.dry_run ? "hashing" : "writing", track_name);
 
-			uint32_t crc = crc32_seed();
-			MD5 bh_md5;
-			SHA1 bh_sha1;
+			std::vector<std::unique_ptr<TrackSink>> sinks;
+			for(auto const &f : track_formats)
+			{
+				auto track_path = std::filesystem::path(options.image_path) / fmt::format("{}.{}", track_name, f);
+				sinks.push_back(track_sink_create(f, track_path, options.dry_run, lba_end - t.lba_start));
+			}
 
 			std::vector<std::pair<int32_t, int32_t>> descramble_errors;
 
-			int32_t lba_end = t.lba_end;
-			if(options.iso9660_trim && data_track && !t.indices.empty())
-				lba_end = t.lba_start + iso9660_volume_size(scm_fs, (-lba_start + t.indices.front()) * CD_DATA_SIZE + write_offset * CD_SAMPLE_SIZE, scrap);
+			// stored for the next re-split, offset shift correction disables reuse anyway
+			bool hash_input = !options.dry_run;
+			uint32_t input_crc = crc32_seed();
 
 			for(int32_t lba = t.lba_start; lba < lba_end; ++lba)
 			{
 				uint32_t lba_index = lba - lba_start;
 
+				if(!options.leave_unchanged || hash_input)
+					read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba_index, 1, -write_offset, (uint8_t)State::ERROR_SKIP);
+				read_entry(scm_fs, sector.data(), CD_DATA_SIZE, lba_index, 1, -write_offset * CD_SAMPLE_SIZE, 0);
+
+				if(hash_input)
+					input_crc = track_input_crc_update(input_crc, state.data(), sector.data());
+
 				bool generate_sector = false;
 				if(!options.leave_unchanged)
 				{
-					read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba_index, 1, -write_offset, (uint8_t)State::ERROR_SKIP);
 					for(auto const &s : state)
 					{
 						if(s == State::ERROR_SKIP || s == State::ERROR_C2)
@@ -470,8 +552,6 @@ void write_tracks(std::vector<TrackEntry> &track_entries, TOC &toc, std::fstream
 				}
 				else
 				{
-					read_entry(scm_fs, sector.data(), CD_DATA_SIZE, lba_index, 1, -write_offset * CD_SAMPLE_SIZE, 0);
-
 					// data: needs unscramble
 					if(data_track)
 					{
@@ -497,13 +577,13 @@ void write_tracks(std::vector<TrackEntry> &track_entries, TOC &toc, std::fstream
 									if(sync_diff > OFFSET_SHIFT_SYNC_TOLERANCE)
 									{
 										// extract garbage portion to file
-										if(offset_shift > 0)
+										if(offset_shift > 0 && !options.dry_run)
 										{
 											uint32_t garbage_count = offset_shift / CD_DATA_SIZE_SAMPLES + (offset_shift % CD_DATA_SIZE_SAMPLES ? 1 : 0);
 											std::vector<uint8_t> garbage(garbage_count * CD_DATA_SIZE);
 											read_entry(scm_fs, garbage.data(), CD_DATA_SIZE, lba_index, garbage_count, -write_offset * CD_SAMPLE_SIZE, 0);
 
-											std::filesystem::path track_garbage_path(std::filesystem::path(options.image_path) / fmt::format("{}.{:06}", track_name, lba));
+											std::filesystem::path track_garbage_path(std::filesystem::path(options.image_path) / fmt::format("{}.bin.{:06}", track_name, lba));
 											std::fstream fs(track_garbage_path, std::fstream::out | std::fstream::binary);
 											if(!fs.is_open())
 												throw_line(fmt::format("unable to create file ({})", track_garbage_path.filename().string()));
@@ -547,13 +627,11 @@ void write_tracks(std::vector<TrackEntry> &track_entries, TOC &toc, std::fstream
 					}
 				}
 
-				crc = crc32(sector.data(), sector.size(), crc);
-				bh_md5.Update(sector.data(), sector.size());
-				bh_sha1.Update(sector.data(), sector.size());
+				if(sub_fs.is_open())
+					read_entry(sub_fs, subcode.data(), CD_SUBCODE_SIZE, lba_index, 1, 0, 0);
 
-				fs_bin.write((char *)sector.data(), sector.size());
-				if(fs_bin.fail())
-					throw_line(fmt::format("write failed ({})", track_name));
+				for(auto &sink : sinks)
+					sink->Write(sector.data(), subcode.data());
 			}
 
 			for(auto const &d : descramble_errors)
@@ -567,12 +645,22 @@ void write_tracks(std::vector<TrackEntry> &track_entries, TOC &toc, std::fstream
 //				LOG("debug: scram offset: {:08X}", debug_get_scram_offset(d.first, write_offset));
 			}
 
-			track_entry.crc = crc32_final(crc);
-			track_entry.md5 = bh_md5.Final();
-			track_entry.sha1 = bh_sha1.Final();
-			track_entries.push_back(track_entry);
+			for(auto &sink : sinks)
+			{
+				TrackEntry track_entry;
+				sink->Finalize(track_entry);
+				track_entry.lba_start = t.lba_start;
+				track_entry.lba_end = lba_end;
+				track_entry.write_offset = write_offset;
+				track_entry.input_crc = crc32_final(input_crc);
+				track_entry.data_mode = t.data_mode;
+				track_entries.push_back(track_entry);
+			}
 		}
 	}
+
+	if(!options.dry_run)
+		split_save(std::filesystem::path(options.image_path) / (options.image_name + ".split"), split_options_key(options, scrap), track_entries);
 	auto time_stop = std::chrono::high_resolution_clock::now();
 
 	LOG("split complete (time: {}s)", std::chrono::duration_cast<std::chrono::seconds>(time_stop - time_start).count());
@@ -683,6 +771,8 @@ std::vector<std::pair<int32_t, int32_t>> audio_get_toc_index0_ranges(const TOC &
 
 std::vector<std::vector<std::pair<int32_t, int32_t>>> audio_get_silence_ranges(std::fstream &scm_fs, uint32_t sectors_count, uint16_t silence_threshold, const std::vector<std::pair<int32_t, int32_t>> &index0_ranges)
 {
+	PROFILE_SCOPE("audio_get_silence_ranges");
+
 	uint32_t silence_samples_min = std::numeric_limits<uint32_t>::max();
 	for(auto const &r : index0_ranges)
 	{
@@ -879,6 +969,7 @@ int32_t disc_offset_by_overlap(const TOC &toc, std::fstream &scm_fs, int32_t wri
 			if(t1.control & (uint8_t)ChannelQ::Control::DATA && !(t2.control & (uint8_t)ChannelQ::Control::DATA))
 			{
 				static constexpr uint32_t OVERLAP_COUNT = 10;
+				static constexpr uint32_t OVERLAP_HEAD_SIZE = 4 * CD_SAMPLE_SIZE;
 
 				uint32_t sectors_to_check = std::min(std::min((uint32_t)(t1.lba_end - t1.lba_start), (uint32_t)(t2.lba_end - t2.lba_start)), OVERLAP_COUNT);
 
@@ -895,12 +986,28 @@ int32_t disc_offset_by_overlap(const TOC &toc, std::fstream &scm_fs, int32_t wri
 					scrambler.Process(s, s);
 				}
 
-				for(auto it = t1_samples.begin(); it != t1_samples.end(); ++it)
+				// longest overlap of the data track end and the audio track start, candidates are found by the audio track head
+				const uint8_t *t1_data = (uint8_t *)t1_samples.data();
+				const uint8_t *t2_data = (uint8_t *)t2_samples.data();
+				uint64_t size = t1_samples.size() * CD_SAMPLE_SIZE;
+				uint64_t head_size = std::min((uint64_t)OVERLAP_HEAD_SIZE, size);
+				auto overlap = [&](uint64_t position)
+				{
+					if(!memcmp(&t1_data[position], t2_data, size - position))
+						write_offset = (int32_t)((size - position) / CD_SAMPLE_SIZE);
+
+					return write_offset != std::numeric_limits<int32_t>::max();
+				};
+
+				if(size)
 				{
-					if(std::equal(it, t1_samples.end(), t2_samples.begin()))
+					PatternScanner scanner({ std::vector<uint8_t>(t2_data, t2_data + head_size) });
+					if(!scanner.Find(t1_data, size, [&](uint32_t, uint64_t position) { return position % CD_SAMPLE_SIZE ? false : overlap(position); }))
 					{
-						write_offset = t1_samples.end() - it;
-						break;
+						// overlaps shorter than the head
+						for(uint64_t position = size - head_size + CD_SAMPLE_SIZE; position < size; position += CD_SAMPLE_SIZE)
+							if(overlap(position))
+								break;
 					}
 				}
 
@@ -928,14 +1035,14 @@ uint32_t find_non_zero_range(std::fstream &scm_fs, std::fstream &state_fs, int32
 	}
 
 	Scrambler scrambler;
+	std::vector<uint8_t> sector(CD_DATA_SIZE);
+	std::vector<State> state(CD_DATA_SIZE_SAMPLES);
 
 	int32_t lba = lba_start;
 	for(; lba != lba_end; lba += step)
 	{
-		std::vector<uint8_t> sector(CD_DATA_SIZE);
 		read_entry(scm_fs, sector.data(), CD_DATA_SIZE, lba - LBA_START, 1, -write_offset * CD_SAMPLE_SIZE, 0);
 
-		std::vector<State> state(CD_DATA_SIZE_SAMPLES);
 		read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba - LBA_START, 1, -write_offset, (uint8_t)State::ERROR_SKIP);
 
 		// skip all incomplete / erroneous sectors
@@ -1007,25 +1114,12 @@ std::string calculate_universal_hash(std::fstream &scm_fs, std::pair<int32_t, in
 }
 
 
-void redumper_protection(Options &options)
+TOC toc_load(const std::string &image_prefix, uint32_t sectors_count, const Options &options)
 {
-	if(options.image_name.empty())
-		throw_line("no image name provided");
-
-	std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
-
-	std::filesystem::path scm_path(image_prefix + ".scram");
-	std::filesystem::path scp_path(image_prefix + ".scrap");
 	std::filesystem::path sub_path(image_prefix + ".subcode");
-	std::filesystem::path state_path(image_prefix + ".state");
 	std::filesystem::path toc_path(image_prefix + ".toc");
 	std::filesystem::path fulltoc_path(image_prefix + ".fulltoc");
-
-	bool scrap = !std::filesystem::exists(scm_path) && std::filesystem::exists(scp_path);
-	auto scra_path(scrap ? scp_path : scm_path);
-
-	//TODO: rework
-	uint32_t sectors_count = check_file(state_path, CD_DATA_SIZE_SAMPLES);
+	std::filesystem::path cdtext_path(image_prefix + ".cdtext");
 
 	// TOC
 	std::vector<uint8_t> toc_buffer = read_vector(toc_path);
@@ -1034,237 +1128,58 @@ void redumper_protection(Options &options)
 	// FULL TOC
 	if(std::filesystem::exists(fulltoc_path))
 	{
-		std::vector<uint8_t> fulltoc_buffer = read_vector(fulltoc_path);
-		TOC toc_full(fulltoc_buffer, true);
+		std::vector<uint8_t> full_toc_buffer = read_vector(fulltoc_path);
+		TOC toc_full(full_toc_buffer, true);
+
+		// PX-W5224TA: incorrect FULL TOC data in some cases
+		toc_full.DeriveINDEX(toc);
+
 		if(toc_full.sessions.size() > 1)
 			toc = toc_full;
 		else
 			toc.disc_type = toc_full.disc_type;
 	}
 
+	// preload subchannel Q
+	std::vector<ChannelQ> subq;
+	if(std::filesystem::exists(sub_path))
 	{
-		auto &t = toc.sessions.back().tracks.back();
-
-		// fake TOC
-		if(t.lba_end < 0)
-		{
-			LOG("warning: fake TOC detected, using default 74min disc size");
-			t.lba_end = MSF_to_LBA(MSF{74, 0, 0});
-		}
+		std::fstream fs(sub_path, std::fstream::in | std::fstream::binary);
+		if(!fs.is_open())
+			throw_line(fmt::format("unable to open file ({})", sub_path.filename().string()));
 
-		// incomplete dump (dumped with --stop-lba)
-		if(t.lba_end > (int32_t)sectors_count + LBA_START)
+		subq.resize(sectors_count);
+		std::vector<uint8_t> sub_buffer(CD_SUBCODE_SIZE);
+		for(uint32_t lba_index = 0; lba_index < sectors_count; ++lba_index)
 		{
-			LOG("warning: incomplete dump detected, using available dump size");
-			t.lba_end = (int32_t)sectors_count + LBA_START;
+			read_entry(fs, sub_buffer.data(), (uint32_t)sub_buffer.size(), lba_index, 1, 0, 0);
+			subcode_extract_channel((uint8_t *)&subq[lba_index], sub_buffer.data(), Subchannel::Q);
 		}
-	}
-
-	std::fstream scm_fs(scra_path, std::fstream::in | std::fstream::binary);
-	if(!scm_fs.is_open())
-		throw_line(fmt::format("unable to open file ({})", scra_path.filename().string()));
 
-	std::fstream state_fs(state_path, std::fstream::in | std::fstream::binary);
-	if(!state_fs.is_open())
-		throw_line(fmt::format("unable to open file ({})", state_path.filename().string()));
+		// correct Q
+		LOG_F("correcting Q... ");
+		if(!correct_program_subq(subq.data(), sectors_count))
+			subq.clear();
+		LOG("done");
+		LOG("");
 
-	std::string protection("N/A");
+	}
 
-	LOG("scan started");
+	if(subq.empty())
+	{
+		LOG("warning: subchannel data is not available, generating TOC index 0 entries");
+		toc.GenerateIndex0();
+	}
+	else
+		toc.UpdateQ(subq.data(), sectors_count, LBA_START);
 
-	auto scan_time_start = std::chrono::high_resolution_clock::now();
+	LOG("final TOC:");
+	toc.Print();
+	LOG("");
 
-	// PS2 Datel DATA.DAT / BIG.DAT
-	// only one track
-	if(toc.sessions.size() == 1 && toc.sessions.front().tracks.size() == 1)
+	if(!subq.empty())
 	{
-		// data track
-		auto &t = toc.sessions.front().tracks.front();
-		if(t.control & (uint8_t)ChannelQ::Control::DATA)
-		{
-			std::vector<State> state(CD_DATA_SIZE_SAMPLES);
-
-			int32_t write_offset = track_offset_by_sync(t.indices.front(), t.lba_end, state_fs, scm_fs);
-			if(write_offset != std::numeric_limits<int32_t>::max())
-			{
-				// preliminary check
-				bool candidate = false;
-				{
-					constexpr int32_t lba_check = 50;
-					if(lba_check >= t.indices.front() && lba_check < t.lba_end)
-					{
-						read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba_check - LBA_START, 1, -write_offset, (uint8_t)State::ERROR_SKIP);
-						for(auto const &s : state)
-							if(s == State::ERROR_C2)
-							{
-								candidate = true;
-								break;
-							}
-					}
-				}
-
-				if(candidate)
-				{
-					std::string protected_filename;
-					{
-						ImageBrowser browser(scm_fs, -LBA_START * CD_DATA_SIZE + write_offset * CD_SAMPLE_SIZE, 0, !scrap);
-						auto root_dir = browser.RootDirectory();
-
-						// protection file exists
-						auto data_dat = root_dir->SubEntry("DATA.DAT");
-						auto big_dat = root_dir->SubEntry("BIG.DAT");
-
-						std::shared_ptr<ImageBrowser::Entry> protection_dat;
-						if(data_dat && big_dat)
-							protection_dat = data_dat->SectorOffset() < big_dat->SectorOffset() ? data_dat : big_dat;
-						else if(data_dat)
-							protection_dat = data_dat;
-						else if(big_dat)
-							protection_dat = big_dat;
-
-						// first file on disc and starts from LBA 23
-						if(protection_dat->SectorOffset() == 23)
-							protected_filename = protection_dat->Name();
-					}
-
-					if(!protected_filename.empty())
-					{
-						std::pair<int32_t, int32_t> range(0, 0);
-						for(int32_t lba = 25, lba_end = std::min(t.lba_end, 5000); lba < lba_end; ++lba)
-						{
-							read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba - LBA_START, 1, -write_offset, (uint8_t)State::ERROR_SKIP);
-
-							bool error = false;
-							for(auto const &s : state)
-								if(s == State::ERROR_C2)
-								{
-									error = true;
-									break;
-								}
-
-							if(error)
-							{
-								if(!range.first)
-									range.first = lba;
-								range.second = lba + 1;
-							}
-							else
-							{
-								if(range.first)
-									break;
-							}
-						}
-
-						if(range.second > range.first)
-						{
-							protection = fmt::format("PS2/Datel {}, C2: {}, range: {}-{}", protected_filename, range.second - range.first, range.first, range.second - 1);
-
-							auto skip_ranges = string_to_ranges(options.skip);
-							skip_ranges.push_back(range);
-							options.skip = ranges_to_string(skip_ranges);
-						}
-					}
-				}
-			}
-		}
-	}
-
-	LOG("protection: {}", protection);
-
-	auto scan_time_stop = std::chrono::high_resolution_clock::now();
-	LOG("scan complete (time: {}s)", std::chrono::duration_cast<std::chrono::seconds>(scan_time_stop - scan_time_start).count());
-	LOG("");
-}
-
-
-void redumper_split(const Options &options)
-{
-	if(options.image_name.empty())
-		throw_line("no image name provided");
-
-	std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
-
-	std::filesystem::path scm_path(image_prefix + ".scram");
-	std::filesystem::path scp_path(image_prefix + ".scrap");
-	std::filesystem::path sub_path(image_prefix + ".subcode");
-	std::filesystem::path state_path(image_prefix + ".state");
-	std::filesystem::path toc_path(image_prefix + ".toc");
-	std::filesystem::path fulltoc_path(image_prefix + ".fulltoc");
-	std::filesystem::path cdtext_path(image_prefix + ".cdtext");
-
-	bool scrap = !std::filesystem::exists(scm_path) && std::filesystem::exists(scp_path);
-	auto scra_path(scrap ? scp_path : scm_path);
-
-	//TODO: rework?
-	uint32_t sectors_count = check_file(state_path, CD_DATA_SIZE_SAMPLES);
-
-	std::fstream scm_fs(scra_path, std::fstream::in | std::fstream::binary);
-	if(!scm_fs.is_open())
-		throw_line(fmt::format("unable to open file ({})", scra_path.filename().string()));
-
-	std::fstream state_fs(state_path, std::fstream::in | std::fstream::binary);
-	if(!state_fs.is_open())
-		throw_line(fmt::format("unable to open file ({})", state_path.filename().string()));
-
-	// TOC
-	std::vector<uint8_t> toc_buffer = read_vector(toc_path);
-	TOC toc(toc_buffer, false);
-
-	// FULL TOC
-	if(std::filesystem::exists(fulltoc_path))
-	{
-		std::vector<uint8_t> full_toc_buffer = read_vector(fulltoc_path);
-		TOC toc_full(full_toc_buffer, true);
-
-		// PX-W5224TA: incorrect FULL TOC data in some cases
-		toc_full.DeriveINDEX(toc);
-
-		if(toc_full.sessions.size() > 1)
-			toc = toc_full;
-		else
-			toc.disc_type = toc_full.disc_type;
-	}
-
-	// preload subchannel Q
-	std::vector<ChannelQ> subq;
-	if(std::filesystem::exists(sub_path))
-	{
-		std::fstream fs(sub_path, std::fstream::in | std::fstream::binary);
-		if(!fs.is_open())
-			throw_line(fmt::format("unable to open file ({})", sub_path.filename().string()));
-
-		subq.resize(sectors_count);
-		std::vector<uint8_t> sub_buffer(CD_SUBCODE_SIZE);
-		for(uint32_t lba_index = 0; lba_index < sectors_count; ++lba_index)
-		{
-			read_entry(fs, sub_buffer.data(), (uint32_t)sub_buffer.size(), lba_index, 1, 0, 0);
-			subcode_extract_channel((uint8_t *)&subq[lba_index], sub_buffer.data(), Subchannel::Q);
-		}
-
-		// correct Q
-		LOG_F("correcting Q... ");
-		if(!correct_program_subq(subq.data(), sectors_count))
-			subq.clear();
-		LOG("done");
-		LOG("");
-
-	}
-
-	if(subq.empty())
-	{
-		LOG("warning: subchannel data is not available, generating TOC index 0 entries");
-		toc.GenerateIndex0();
-	}
-	else
-		toc.UpdateQ(subq.data(), sectors_count, LBA_START);
-
-	LOG("final TOC:");
-	toc.Print();
-	LOG("");
-
-	if(!subq.empty())
-	{
-		TOC qtoc(subq.data(), sectors_count, LBA_START);
+		TOC qtoc(subq.data(), sectors_count, LBA_START);
 
 		// compare TOC and QTOC
 		if(toc_mismatch(toc, qtoc))
@@ -1310,18 +1225,15 @@ void redumper_split(const Options &options)
 		toc.sessions.front().tracks.insert(toc.sessions.front().tracks.begin(), t0);
 	}
 
-	std::pair<int32_t, int32_t> nonzero_toc_range(toc.sessions.front().tracks.front().lba_start * CD_DATA_SIZE_SAMPLES, toc.sessions.back().tracks.back().lba_start * CD_DATA_SIZE_SAMPLES);
-	auto nonzero_data_range = audio_get_sample_range(scm_fs, sectors_count);
-	LOG("non-zero  TOC sample range: [{:+9} .. {:+9}]", nonzero_toc_range.first, nonzero_toc_range.second);
-	LOG("non-zero data sample range: [{:+9} .. {:+9}]", nonzero_data_range.first, nonzero_data_range.second);
-	LOG("Universal Hash (SHA-1): {}", calculate_universal_hash(scm_fs, nonzero_data_range));
-	LOG("");
+	return toc;
+}
 
-	LOG("detecting offset");
-	auto time_start = std::chrono::high_resolution_clock::now();
 
-	int32_t write_offset = options.force_offset ? *options.force_offset : std::numeric_limits<int32_t>::max();
-	int32_t write_offset_data = scrap ? std::numeric_limits<int32_t>::max() : write_offset;
+void disc_offset_detect(int32_t &write_offset, int32_t &write_offset_data, const TOC &toc, std::fstream &scm_fs, std::fstream &state_fs, uint32_t sectors_count, bool scrap,
+                        const std::pair<int32_t, int32_t> &nonzero_toc_range, const std::pair<int32_t, int32_t> &nonzero_data_range, const Options &options)
+{
+	write_offset = options.force_offset ? *options.force_offset : std::numeric_limits<int32_t>::max();
+	write_offset_data = scrap ? std::numeric_limits<int32_t>::max() : write_offset;
 
 	// data track
 	if(write_offset_data == std::numeric_limits<int32_t>::max())
@@ -1330,7 +1242,7 @@ void redumper_split(const Options &options)
 			for(auto &t : s.tracks)
 				if(t.control & (uint8_t)ChannelQ::Control::DATA)
 				{
-					write_offset_data = track_offset_by_sync(t.indices.empty() ? t.lba_start : t.indices.front(), t.lba_end, state_fs, scm_fs);
+					write_offset_data = track_offset_by_sync(t.indices.empty() ? t.lba_start : t.indices.front(), t.lba_end, scm_fs);
 					if(write_offset_data != std::numeric_limits<int32_t>::max())
 					{
 						if(!scrap)
@@ -1349,7 +1261,7 @@ void redumper_split(const Options &options)
 		if(!(t.control & (uint8_t)ChannelQ::Control::DATA))
 		{
 			uint32_t index0_count = (t.indices.empty() ? t.lba_end : t.indices.front()) - t.lba_start;
-			int32_t track_write_offset = track_offset_by_sync(t.lba_start, t.lba_start + index0_count, state_fs, scm_fs);
+			int32_t track_write_offset = track_offset_by_sync(t.lba_start, t.lba_start + index0_count, scm_fs);
 
 			if(track_write_offset != std::numeric_limits<int32_t>::max() && track_sync_count(t.lba_start, t.lba_start + index0_count, track_write_offset, scm_fs) > index0_count / 2)
 			{
@@ -1476,57 +1388,114 @@ void redumper_split(const Options &options)
 	}
 	if(write_offset_data == std::numeric_limits<int32_t>::max())
 		write_offset_data = write_offset;
+}
 
-	LOG("disc write offset: {:+}", write_offset);
 
-	// identify CD-I tracks, needed for CUE-sheet generation
-	for(auto &s : toc.sessions)
-		for(auto &t : s.tracks)
-			if(t.control & (uint8_t)ChannelQ::Control::DATA)
-			{
-				// CDI
-				try
-				{
-					ImageBrowser browser(scm_fs, -LBA_START * CD_DATA_SIZE + write_offset_data * CD_SAMPLE_SIZE, 0, !scrap);
+// checks audio tracks against AccurateRip database at every offset within a deviation range in one pass per track
+// a match at zero difference confirms detected disc write offset
+void accuraterip_verify(const TOC &toc, std::fstream &scm_fs, int32_t write_offset, const std::filesystem::path &db_path)
+{
+	constexpr uint32_t OFFSET_RANGE = OFFSET_DEVIATION_MAX;
+	constexpr uint32_t PAD_SECTORS = OFFSET_RANGE / CD_DATA_SIZE_SAMPLES + 1;
 
-					auto pvd = browser.GetPVD();
+	// first session only, tracks span from index 01 to the next track index 01
+	std::vector<std::pair<uint32_t, bool>> tracks;
+	std::vector<int32_t> track_offsets;
+	for(auto const &t : toc.sessions.front().tracks)
+	{
+		if(t.track_number == 0x00)
+			continue;
 
-					if(!memcmp(pvd.standard_identifier, iso9660::CDI_STANDARD_INDENTIFIER, sizeof(pvd.standard_identifier)))
-						t.cdi = true;
-				}
-				catch(...)
-				{
-					//FIXME: be verbose
-					;
-				}
-			}
+		if(t.track_number == bcd_decode(CD_LEADOUT_TRACK_NUMBER))
+			track_offsets.push_back(t.lba_start);
+		else
+		{
+			tracks.emplace_back(t.track_number, !(t.control & (uint8_t)ChannelQ::Control::DATA));
+			track_offsets.push_back(t.indices.empty() ? t.lba_start : t.indices.front());
+		}
+	}
 
-	// check if pre-gap is complete
-	for(uint32_t i = 0; i < toc.sessions.size(); ++i)
+	uint32_t id1, id2, cddb_id;
+	accuraterip_disc_id(id1, id2, cddb_id, track_offsets);
+	auto db_name = fmt::format("dBAR-{:03}-{:08x}-{:08x}-{:08x}.bin", tracks.size(), id1, id2, cddb_id);
+
+	LOG("AccurateRip ({}):", db_name);
+
+	auto db_file = std::filesystem::is_directory(db_path) ? db_path / db_name : db_path;
+	if(!std::filesystem::exists(db_file))
 	{
-		auto &t = toc.sessions[i].tracks.front();
+		LOG("warning: AccurateRip database file not found ({})", db_file.string());
+		LOG("");
+		return;
+	}
 
-		int32_t pregap_end = i ? t.indices.front() : 0;
-		int32_t pregap_start = pregap_end - CD_PREGAP_SIZE;
+	auto entries = accuraterip_load(db_file);
 
-		uint32_t unavailable = 0;
-		for(int32_t lba = pregap_start; lba != pregap_end; ++lba)
+	std::set<int32_t> differences;
+	std::vector<uint32_t> samples;
+	for(uint32_t i = 0; i < tracks.size(); ++i)
+	{
+		if(!tracks[i].second)
+			continue;
+
+		bool first = i == 0;
+		bool last = i + 1 == tracks.size();
+		int32_t lba_start = track_offsets[i];
+		int32_t lba_end = track_offsets[i + 1];
+		uint32_t samples_count = (lba_end - lba_start) * CD_DATA_SIZE_SAMPLES;
+
+		uint32_t sectors_count = lba_end - lba_start + 2 * PAD_SECTORS;
+		samples.resize(sectors_count * CD_DATA_SIZE_SAMPLES);
+		read_entry(scm_fs, (uint8_t *)samples.data(), CD_DATA_SIZE, lba_start - PAD_SECTORS - LBA_START, sectors_count, -write_offset * CD_SAMPLE_SIZE, 0);
+		const uint32_t *track_samples = samples.data() + PAD_SECTORS * CD_DATA_SIZE_SAMPLES;
+
+		auto crcs = accuraterip_v1_sweep(track_samples, samples_count, first, last, OFFSET_RANGE);
+
+		// v1 matches at any offset, v2 is evaluated at v1 matched offsets and at zero difference
+		// offset, version, confidence
+		std::vector<std::tuple<int32_t, uint32_t, uint32_t>> matches;
+		std::set<int32_t> v2_offsets{0};
+		for(auto const &e : entries)
 		{
-			std::vector<State> state(CD_DATA_SIZE_SAMPLES);
-			read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba - LBA_START, 1, -write_offset, (uint8_t)State::ERROR_SKIP);
+			if(i >= e.tracks.size() || !e.tracks[i].crc)
+				continue;
 
-			for(auto const &s : state)
-				if(s == State::ERROR_SKIP)
+			for(uint32_t o = 0; o < crcs.size(); ++o)
+				if(crcs[o] == e.tracks[i].crc)
 				{
-					++unavailable;
-					break;
+					int32_t offset = (int32_t)o - (int32_t)OFFSET_RANGE;
+					matches.emplace_back(offset, 1, e.tracks[i].confidence);
+					v2_offsets.insert(offset);
 				}
 		}
+		for(auto o : v2_offsets)
+		{
+			uint32_t crc = accuraterip_v2(track_samples + o, samples_count, first, last);
+			for(auto const &e : entries)
+				if(i < e.tracks.size() && e.tracks[i].crc == crc)
+					matches.emplace_back(o, 2, e.tracks[i].confidence);
+		}
 
-		if(unavailable)
-			LOG("warning: incomplete pre-gap (session: {}, unavailable: {}/{})", toc.sessions[i].session_number, unavailable, pregap_end - pregap_start);
+		if(matches.empty())
+			LOG("  track {:02}: no match (v1: {:08x})", tracks[i].first, crcs[OFFSET_RANGE]);
+		for(auto const &m : matches)
+		{
+			LOG("  track {:02}: match (v{}, confidence: {}, offset difference: {:+})", tracks[i].first, std::get<1>(m), std::get<2>(m), std::get<0>(m));
+			differences.insert(std::get<0>(m));
+		}
 	}
 
+	if(differences.size() == 1 && *differences.begin() == 0)
+		LOG("AccurateRip confirms disc write offset: {:+}", write_offset);
+	else if(differences.size() == 1)
+		LOG("warning: AccurateRip matches a different disc write offset: {:+}", write_offset + *differences.begin());
+	LOG("");
+}
+
+
+// track boundaries as written by split: session pre-gap belongs to the lead-in, lead-in/lead-out are trimmed to non-zero data
+void split_layout(TOC &toc, std::fstream &scm_fs, std::fstream &state_fs, int32_t write_offset, const std::pair<int32_t, int32_t> &nonzero_data_range)
+{
 	// check session pre-gap for non-zero data
 	for(uint32_t i = 0; i < toc.sessions.size(); ++i)
 	{
@@ -1569,6 +1538,101 @@ void redumper_split(const Options &options)
 
 		t.lba_end = t.lba_start + nonzero_count;
 	}
+}
+
+
+SplitResult redumper_split(const Options &options)
+{
+	if(options.image_name.empty())
+		throw_line("no image name provided");
+
+	std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
+
+	std::filesystem::path scm_path(image_prefix + ".scram");
+	std::filesystem::path scp_path(image_prefix + ".scrap");
+	std::filesystem::path state_path(image_prefix + ".state");
+
+	bool scrap = !std::filesystem::exists(scm_path) && std::filesystem::exists(scp_path);
+	auto scra_path(scrap ? scp_path : scm_path);
+
+	//TODO: rework?
+	uint32_t sectors_count = check_file(state_path, CD_DATA_SIZE_SAMPLES);
+
+	std::fstream scm_fs(scra_path, std::fstream::in | std::fstream::binary);
+	if(!scm_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", scra_path.filename().string()));
+
+	std::fstream state_fs(state_path, std::fstream::in | std::fstream::binary);
+	if(!state_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", state_path.filename().string()));
+
+	TOC toc = toc_load(image_prefix, sectors_count, options);
+
+	std::pair<int32_t, int32_t> nonzero_toc_range(toc.sessions.front().tracks.front().lba_start * CD_DATA_SIZE_SAMPLES, toc.sessions.back().tracks.back().lba_start * CD_DATA_SIZE_SAMPLES);
+	auto nonzero_data_range = audio_get_sample_range(scm_fs, sectors_count);
+	LOG("non-zero  TOC sample range: [{:+9} .. {:+9}]", nonzero_toc_range.first, nonzero_toc_range.second);
+	LOG("non-zero data sample range: [{:+9} .. {:+9}]", nonzero_data_range.first, nonzero_data_range.second);
+	LOG("Universal Hash (SHA-1): {}", calculate_universal_hash(scm_fs, nonzero_data_range));
+	LOG("");
+
+	LOG("detecting offset");
+	auto time_start = std::chrono::high_resolution_clock::now();
+
+	int32_t write_offset;
+	int32_t write_offset_data;
+	disc_offset_detect(write_offset, write_offset_data, toc, scm_fs, state_fs, sectors_count, scrap, nonzero_toc_range, nonzero_data_range, options);
+
+	LOG("disc write offset: {:+}", write_offset);
+
+	// identify CD-I tracks, needed for CUE-sheet generation
+	for(auto &s : toc.sessions)
+		for(auto &t : s.tracks)
+			if(t.control & (uint8_t)ChannelQ::Control::DATA)
+			{
+				// CDI
+				try
+				{
+					ImageBrowser browser(scm_fs, -LBA_START * CD_DATA_SIZE + write_offset_data * CD_SAMPLE_SIZE, 0, !scrap);
+
+					auto pvd = browser.GetPVD();
+
+					if(!memcmp(pvd.standard_identifier, iso9660::CDI_STANDARD_INDENTIFIER, sizeof(pvd.standard_identifier)))
+						t.cdi = true;
+				}
+				catch(...)
+				{
+					//FIXME: be verbose
+					;
+				}
+			}
+
+	// check if pre-gap is complete
+	for(uint32_t i = 0; i < toc.sessions.size(); ++i)
+	{
+		auto &t = toc.sessions[i].tracks.front();
+
+		int32_t pregap_end = i ? t.indices.front() : 0;
+		int32_t pregap_start = pregap_end - CD_PREGAP_SIZE;
+
+		uint32_t unavailable = 0;
+		for(int32_t lba = pregap_start; lba != pregap_end; ++lba)
+		{
+			std::vector<State> state(CD_DATA_SIZE_SAMPLES);
+			read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba - LBA_START, 1, -write_offset, (uint8_t)State::ERROR_SKIP);
+
+			for(auto const &s : state)
+				if(s == State::ERROR_SKIP)
+				{
+					++unavailable;
+					break;
+				}
+		}
+
+		if(unavailable)
+			LOG("warning: incomplete pre-gap (session: {}, unavailable: {}/{})", toc.sessions[i].session_number, unavailable, pregap_end - pregap_start);
+	}
+
+	split_layout(toc, scm_fs, state_fs, write_offset, nonzero_data_range);
 
 	// check if session lead-in/lead-out is isolated by one good sector
 	for(uint32_t i = 0; i < toc.sessions.size(); ++i)
@@ -1599,7 +1663,18 @@ void redumper_split(const Options &options)
 	LOG("detection complete (time: {}s)", std::chrono::duration_cast<std::chrono::seconds>(time_stop - time_start).count());
 	LOG("");
 
-	std::vector<std::pair<int32_t, int32_t>> skip_ranges = string_to_ranges(options.skip);
+	if(!options.accuraterip_db.empty())
+		accuraterip_verify(toc, scm_fs, write_offset, options.accuraterip_db);
+
+	IntervalSet skip_ranges(string_to_ranges(options.skip));
+
+	// previous split with the same options, unchanged tracks are reused;
+	// offset shift correction changes write offset in the middle of a track, always split everything in this case
+	std::filesystem::path split_path(std::filesystem::path(options.image_path) / (options.image_name + ".split"));
+	std::map<std::string, TrackEntry> split_entries;
+	if(!options.dry_run && !options.correct_offset_shift && std::filesystem::exists(split_path))
+		split_entries = split_load(split_path, split_options_key(options, scrap));
+	split_check_outputs(toc, split_entries, options);
 
 	// check tracks
 	if(!check_tracks(toc, scm_fs, state_fs, write_offset_data, write_offset, skip_ranges, LBA_START, scrap, options) && !options.force_split)
@@ -1607,44 +1682,32 @@ void redumper_split(const Options &options)
 
 	// write tracks
 	std::vector<TrackEntry> track_entries;
-	write_tracks(track_entries, toc, scm_fs, state_fs, write_offset_data, write_offset, skip_ranges, LBA_START, scrap, options);
+	write_tracks(track_entries, toc, scm_fs, state_fs, write_offset_data, write_offset, skip_ranges, LBA_START, scrap, split_entries, options);
 
 	// write CUE-sheet
-	std::vector<std::string> cue_sheets;
-	LOG("writing CUE-sheet");
-	if(toc.cd_text_lang.size() > 1)
+	// name, content
+	std::vector<std::pair<std::string, std::string>> cue_sheets;
+	LOG(options.dry_run ? "generating CUE-sheet" : "writing CUE-sheet");
+	for(uint32_t i = 0; i < std::max(toc.cd_text_lang.size(), (size_t)1); ++i)
 	{
-		cue_sheets.resize(toc.cd_text_lang.size());
-		for(uint32_t i = 0; i < toc.cd_text_lang.size(); ++i)
-		{
-			cue_sheets[i] = i ? fmt::format("{}_{:02X}.cue", options.image_name, toc.cd_text_lang[i]) : fmt::format("{}.cue", options.image_name);
-			LOG_F("{}... ", cue_sheets[i]);
+		std::string cue_name = i ? fmt::format("{}_{:02X}.cue", options.image_name, toc.cd_text_lang[i]) : fmt::format("{}.cue", options.image_name);
+		LOG_F("{}... ", cue_name);
 
-			if(std::filesystem::exists(std::filesystem::path(options.image_path) / cue_sheets[i]) && !options.overwrite)
-				throw_line(fmt::format("file already exists ({})", cue_sheets[i]));
+		std::stringstream ss;
+		toc.PrintCUE(ss, options.image_name, i);
 
-			std::fstream fs(std::filesystem::path(options.image_path) / cue_sheets[i], std::fstream::out);
+		if(!options.dry_run)
+		{
+			std::fstream fs(std::filesystem::path(options.image_path) / cue_name, std::fstream::out);
 			if(!fs.is_open())
-				throw_line(fmt::format("unable to create file ({})", cue_sheets[i]));
-			toc.PrintCUE(fs, options.image_name, i);
-			LOG("done");
+				throw_line(fmt::format("unable to create file ({})", cue_name));
+			fs << ss.str();
 		}
-	}
-	else
-	{
-		cue_sheets.push_back(fmt::format("{}.cue", options.image_name));
-		LOG_F("{}... ", cue_sheets.front());
-
-		if(std::filesystem::exists(std::filesystem::path(options.image_path) / cue_sheets.front()) && !options.overwrite)
-			throw_line(fmt::format("file already exists ({})", cue_sheets.front()));
 
-		std::fstream fs(std::filesystem::path(options.image_path) / cue_sheets.front(), std::fstream::out);
-		if(!fs.is_open())
-			throw_line(fmt::format("unable to create file ({})", cue_sheets.front()));
-		toc.PrintCUE(fs, options.image_name);
+		cue_sheets.emplace_back(cue_name, ss.str());
 		LOG("done");
-		LOG("");
 	}
+	LOG("");
 
 	if(toc.sessions.size() > 1)
 	{
@@ -1657,25 +1720,56 @@ void redumper_split(const Options &options)
 	LOG("dat:");
 	for(auto const &t : track_entries)
 	{
+		if(std::filesystem::path(t.filename).extension() != ".bin")
+			continue;
+
 		std::string filename = t.filename;
 		replace_all_occurences(filename, "&", "&amp;");
 
-		LOG("<rom name=\"{}\" size=\"{}\" crc=\"{:08x}\" md5=\"{}\" sha1=\"{}\" />", filename, std::filesystem::file_size(std::filesystem::path(options.image_path) / t.filename), t.crc, t.md5, t.sha1);
+		LOG("<rom name=\"{}\" size=\"{}\" crc=\"{:08x}\" md5=\"{}\" sha1=\"{}\" />", filename, t.size, t.crc, t.md5, t.sha1);
 	}
 	LOG("");
 
+	if(!options.dat_index.empty())
+	{
+		std::vector<TrackEntry> dat_entries;
+		for(auto const &t : track_entries)
+			if(std::filesystem::path(t.filename).extension() == ".bin")
+				dat_entries.push_back(t);
+
+		// only main CUE-sheet is a part of DAT
+		auto &c = cue_sheets.front();
+		TrackEntry &cue_entry = dat_entries.emplace_back();
+		cue_entry.filename = c.first;
+		cue_entry.size = c.second.size();
+		cue_entry.crc = crc32((const uint8_t *)c.second.data(), c.second.size());
+		SHA1 bh_sha1;
+		bh_sha1.Update((const uint8_t *)c.second.data(), c.second.size());
+		cue_entry.sha1 = bh_sha1.Final();
+
+		dat_report(DatIndex(options.dat_index), dat_entries);
+	}
+
+	if(!options.split_output.empty())
+	{
+		LOG("additional outputs:");
+		for(auto const &t : track_entries)
+			if(std::filesystem::path(t.filename).extension() != ".bin")
+				LOG("{} (size: {}, crc: {:08x}, md5: {}, sha1: {})", t.filename, t.size, t.crc, t.md5, t.sha1);
+		LOG("");
+	}
+
 	for(auto const &c : cue_sheets)
 	{
-		LOG("CUE [{}]:", c);
-		std::filesystem::path cue_path(std::filesystem::path(options.image_path) / c);
-		std::fstream ifs(cue_path, std::fstream::in);
-		if(!ifs.is_open())
-			throw_line(fmt::format("unable to open file ({})", cue_path.filename().string()));
+		LOG("CUE [{}]:", c.first);
+		std::stringstream ss(c.second);
 		std::string line;
-		while(std::getline(ifs, line))
+		while(std::getline(ss, line))
 			LOG("{}", line);
 		LOG("");
 	}
+
+	return SplitResult{ toc, write_offset, track_entries, cue_sheets };
 }
 
 
@@ -1709,25 +1803,224 @@ std::list<std::pair<std::string, bool>> cue_get_entries(const std::filesystem::p
 }
 
 
-void redumper_info(const Options &options)
+TrackEntry file_hash(const std::filesystem::path &file_path)
+{
+	constexpr uint32_t CHUNK_SIZE = 1024 * CD_DATA_SIZE;
+
+	std::fstream fs(file_path, std::fstream::in | std::fstream::binary);
+	if(!fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", file_path.filename().string()));
+
+	TrackEntry track_entry;
+	track_entry.filename = file_path.filename().string();
+	track_entry.size = 0;
+
+	uint32_t crc = crc32_seed();
+	MD5 bh_md5;
+	SHA1 bh_sha1;
+
+	std::vector<uint8_t> data(CHUNK_SIZE);
+	while(fs)
+	{
+		uint64_t size;
+		{
+			IOSlot io_slot;
+			fs.read((char *)data.data(), data.size());
+			size = fs.gcount();
+		}
+
+		crc = crc32(data.data(), size, crc);
+		bh_md5.Update(data.data(), size);
+		bh_sha1.Update(data.data(), size);
+		track_entry.size += size;
+	}
+
+	track_entry.crc = crc32_final(crc);
+	track_entry.md5 = bh_md5.Final();
+	track_entry.sha1 = bh_sha1.Final();
+
+	return track_entry;
+}
+
+
+// virtual track views of a scrambled image, track layout matches what split would produce
+std::vector<std::function<std::unique_ptr<TrackContext>()>> scram_track_contexts(const Options &options)
 {
 	std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
 
-	auto tracks = cue_get_entries(image_prefix + ".cue");
+	std::filesystem::path scm_path(image_prefix + ".scram");
+	std::filesystem::path scp_path(image_prefix + ".scrap");
+	std::filesystem::path state_path(image_prefix + ".state");
 
-	for(auto const &t : tracks)
+	bool scrap = !std::filesystem::exists(scm_path) && std::filesystem::exists(scp_path);
+	auto scra_path(scrap ? scp_path : scm_path);
+
+	uint32_t sectors_count = check_file(state_path, CD_DATA_SIZE_SAMPLES);
+
+	std::fstream scm_fs(scra_path, std::fstream::in | std::fstream::binary);
+	if(!scm_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", scra_path.filename().string()));
+
+	std::fstream state_fs(state_path, std::fstream::in | std::fstream::binary);
+	if(!state_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", state_path.filename().string()));
+
+	TOC toc = toc_load(image_prefix, sectors_count, options);
+
+	std::pair<int32_t, int32_t> nonzero_toc_range(toc.sessions.front().tracks.front().lba_start * CD_DATA_SIZE_SAMPLES, toc.sessions.back().tracks.back().lba_start * CD_DATA_SIZE_SAMPLES);
+	auto nonzero_data_range = audio_get_sample_range(scm_fs, sectors_count);
+
+	int32_t write_offset;
+	int32_t write_offset_data;
+	disc_offset_detect(write_offset, write_offset_data, toc, scm_fs, state_fs, sectors_count, scrap, nonzero_toc_range, nonzero_data_range, options);
+	LOG("disc write offset: {:+}", write_offset);
+	LOG("");
+
+	split_layout(toc, scm_fs, state_fs, write_offset, nonzero_data_range);
+
+	std::vector<std::function<std::unique_ptr<TrackContext>()>> contexts;
+	for(auto const &s : toc.sessions)
+	{
+		for(auto const &t : s.tracks)
+		{
+			// skip empty tracks
+			if(t.lba_end == t.lba_start)
+				continue;
+
+			bool data_track = t.control & (uint8_t)ChannelQ::Control::DATA;
+			auto track_path = std::filesystem::path(options.image_path) / (track_basename(toc, s.session_number, t.track_number, options.image_name) + ".bin");
+			int32_t lba_start = t.lba_start;
+			int32_t track_write_offset = data_track ? write_offset_data : write_offset;
+			int32_t lba_end = split_track_end(t, scm_fs, track_write_offset, LBA_START, scrap, options);
+			uint8_t fill_byte = optional_track(t.track_number) ? 0x00 : options.skip_fill;
+
+			// virtual view reads the whole track with one offset, an offset shift is only applied by split
+			if(data_track)
+			{
+				int32_t lba = std::max(lba_start, lba_end - (int32_t)OFFSET_SHIFT_MAX_SECTORS);
+				std::vector<uint8_t> sector(CD_DATA_SIZE);
+				read_entry(scm_fs, sector.data(), CD_DATA_SIZE, lba - LBA_START, 1, -track_write_offset * CD_SAMPLE_SIZE, 0);
+				if(memcmp(sector.data(), CD_DATA_SYNC, sizeof(CD_DATA_SYNC)))
+				{
+					int32_t offset_shift = track_find_offset_shift(track_write_offset, lba, lba_end - lba, state_fs, scm_fs);
+					if(offset_shift)
+						LOG("warning: offset shift detected, track is analyzed unshifted, split to apply (track: {}, LBA: {:6}, difference: {:+})", toc.TrackString(t.track_number), lba, offset_shift);
+				}
+			}
+
+			contexts.push_back([=]() { return std::make_unique<TrackContext>(track_path, scra_path, state_path, lba_start, lba_end, track_write_offset, data_track, !scrap, fill_byte); });
+		}
+	}
+
+	return contexts;
+}
+
+
+template<typename T>
+void futures_wait(std::vector<std::future<T>> &futures)
+{
+	for(auto &f : futures)
+		if(f.valid())
+			f.wait();
+}
+
+
+std::vector<std::string> redumper_info(const Options &options, ThreadPool *pool)
+{
+	std::string image_prefix = (std::filesystem::path(options.image_path) / options.image_name).string();
+
+	std::vector<std::function<std::unique_ptr<TrackContext>()>> track_factories;
+	if(std::filesystem::exists(image_prefix + ".cue"))
 	{
-		auto track_path = std::filesystem::path(options.image_path) / t.first;
-		auto systems = System::get().getSystems(track_path);
+		for(auto const &t : cue_get_entries(image_prefix + ".cue"))
+		{
+			auto track_path = std::filesystem::path(options.image_path) / t.first;
+			track_factories.push_back([track_path]() { return std::make_unique<TrackContext>(track_path); });
+		}
+	}
+	// no split yet, analyze scrambled image directly
+	else if(std::filesystem::exists(image_prefix + ".scram") || std::filesystem::exists(image_prefix + ".scrap"))
+		track_factories = scram_track_contexts(options);
+	else
+		throw_line("no CUE-sheet or scrambled image found");
 
-		for(auto const &s : systems)
+	std::unique_ptr<ThreadPool> local_pool;
+	if(pool == nullptr)
+	{
+		local_pool = std::make_unique<ThreadPool>();
+		pool = local_pool.get();
+	}
+
+	std::vector<std::future<std::unique_ptr<TrackContext>>> contexts;
+	std::vector<std::unique_ptr<TrackContext>> track_contexts;
+	std::vector<std::future<std::string>> results;
+	std::vector<std::future<TrackEntry>> hashes;
+
+	std::vector<std::string> outputs;
+	try
+	{
+		// open tracks and gather shared analysis data once per track
+		for(auto const &f : track_factories)
+			contexts.push_back(pool->Enqueue(f));
+
+		// run every system analyzer of every track concurrently
+		for(auto &c : contexts)
 		{
-			std::stringstream ss;
-			s(ss);
-			if(ss.rdbuf()->in_avail())
-				LOG("{}", ss.str());
+			track_contexts.push_back(c.get());
+
+			for(auto const &s : System::get().getSystems(*track_contexts.back()))
+			{
+				results.push_back(pool->Enqueue([s]()
+				{
+					std::stringstream ss;
+					s(ss);
+					return ss.str();
+				}));
+			}
+		}
+
+		// hash split files for DAT matching alongside the analysis
+		if(!options.dat_index.empty() && std::filesystem::exists(image_prefix + ".cue"))
+		{
+			std::vector<std::filesystem::path> files;
+			for(auto const &t : cue_get_entries(image_prefix + ".cue"))
+				files.push_back(std::filesystem::path(options.image_path) / t.first);
+			files.push_back(image_prefix + ".cue");
+
+			for(auto const &f : files)
+				hashes.push_back(pool->Enqueue([f]() { return file_hash(f); }));
+		}
+
+		// output in deterministic order
+		for(auto &r : results)
+		{
+			auto output = r.get();
+			if(!output.empty())
+			{
+				LOG("{}", output);
+				outputs.push_back(output);
+			}
+		}
+
+		if(!hashes.empty())
+		{
+			std::vector<TrackEntry> dat_entries;
+			for(auto &h : hashes)
+				dat_entries.push_back(h.get());
+
+			dat_report(DatIndex(options.dat_index), dat_entries);
 		}
 	}
+	catch(...)
+	{
+		// analyzers reference track contexts and the pool may outlive this call
+		futures_wait(contexts);
+		futures_wait(results);
+		futures_wait(hashes);
+		throw;
+	}
+
+	return outputs;
 }
 
 }
@@ -2,13 +2,23 @@
 
 
 
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
 #include "redumper.hh"
+#include "toc.hh"
 
 
 
 namespace gpsxre
 {
 
+class ThreadPool;
+
+
 constexpr uint32_t OFFSET_DEVIATION_MAX = CD_PREGAP_SIZE * CD_DATA_SIZE_SAMPLES;
 constexpr uint32_t OFFSET_SHIFT_MAX_SECTORS = 4;
 constexpr uint32_t OFFSET_SHIFT_SYNC_TOLERANCE = 2;
@@ -16,14 +26,40 @@ constexpr uint32_t OFFSET_SHIFT_SYNC_TOLERANCE = 2;
 struct TrackEntry
 {
 	std::string filename;
+	uint64_t size;
 
 	uint32_t crc;
 	std::string md5;
 	std::string sha1;
+
+	// split inputs, used to skip unchanged tracks on a subsequent split
+	int32_t lba_start;
+	int32_t lba_end;
+	int32_t write_offset;
+	uint32_t input_crc;
+	uint8_t data_mode;
+};
+
+struct SplitResult
+{
+	// final TOC, as written to the CUE-sheet
+	TOC toc;
+	int32_t write_offset;
+	// every output file, including additional outputs
+	std::vector<TrackEntry> tracks;
+	// name, content
+	std::vector<std::pair<std::string, std::string>> cue_sheets;
 };
 
-void redumper_protection(Options &options);
-void redumper_split(const Options &options);
-void redumper_info(const Options &options);
+int32_t track_offset_by_sync(int32_t lba_start, int32_t lba_end, std::fstream &scm_fs);
+std::list<std::pair<std::string, bool>> cue_get_entries(const std::filesystem::path &cue_path);
+std::string track_basename(const TOC &toc, uint32_t session_number, uint32_t track_number, const std::string &image_name);
+
+TOC toc_load(const std::string &image_prefix, uint32_t sectors_count, const Options &options);
+
+SplitResult redumper_split(const Options &options);
+// returns non-empty outputs of the system analyzers in track order, they are logged too;
+// tasks run on the given pool (must not be called from a task of the same pool) or on a local one
+std::vector<std::string> redumper_info(const Options &options, ThreadPool *pool = nullptr);
 
 }
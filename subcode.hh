@@ -96,5 +96,7 @@ void subcode_extract_channel(uint8_t *subchannel, uint8_t *subcode, Subchannel n
 ChannelQ subchannel_q_generate_mode1(const ChannelQ &base, int32_t shift);
 ChannelQ subchannel_q_generate_mode2(const ChannelQ &base, const ChannelQ &mode1, int32_t shift);
 ChannelQ subchannel_q_generate_mode3(const ChannelQ &base, const ChannelQ &mode1, int32_t shift);
+// replaces damaged Q entries with the closest candidate generated from neighbouring valid entries, returns false if there are no valid entries
+bool correct_program_subq(ChannelQ *subq, uint32_t sectors_count);
 
 }
@@ -1,10 +1,8 @@
 #include <fmt/format.h>
-#include <fstream>
 #include <map>
 #include "common.hh"
 #include "cd.hh"
 #include "ecc_edc.hh"
-#include "file_io.hh"
 #include "cdrom.hh"
 
 
@@ -12,20 +10,22 @@
 namespace gpsxre
 {
 
-SystemCDROM::SystemCDROM(const std::filesystem::path &track_path)
-	: _trackPath(track_path)
+SystemCDROM::SystemCDROM(const TrackContext &context)
+	: _context(context)
 {
 	;
 }
 
 
+uint32_t SystemCDROM::probe(const TrackContext &context)
+{
+	return context.dataSync() ? 100 : 0;
+}
+
+
 void SystemCDROM::operator()(std::ostream &os) const
 {
-	std::fstream fs(_trackPath, std::fstream::in | std::fstream::binary);
-	if(!fs.is_open())
-		throw_line(fmt::format("unable to open file ({})", _trackPath.filename().string()));
-	auto track_size = std::filesystem::file_size(_trackPath);
-	uint32_t sectors_count = track_size / CD_DATA_SIZE;
+	uint32_t sectors_count = _context.sectorsCount();
 
 	uint32_t invalid_sync = 0;
 	uint32_t mode2_form1 = 0;
@@ -41,14 +41,10 @@ void SystemCDROM::operator()(std::ostream &os) const
 	Sector sector;
 	for(int32_t i = 0; i < sectors_count; ++i)
 	{
-		read_entry(fs, (uint8_t *)&sector, CD_DATA_SIZE, i, 1, 0, 0);
+		_context.read((uint8_t *)&sector, i, 1);
 
 		if(memcmp(sector.sync, CD_DATA_SYNC, sizeof(CD_DATA_SYNC)))
 		{
-			// not a data track
-			if(!i)
-				return;
-
 			++invalid_sync;
 			continue;
 		}
@@ -148,7 +144,7 @@ void SystemCDROM::operator()(std::ostream &os) const
 		}
 	}
 
-	os << fmt::format("CD-ROM [{}]:", _trackPath.filename().string()) << std::endl;
+	os << fmt::format("CD-ROM [{}]:", _context.trackName()) << std::endl;
 	os << fmt::format("  sectors count: {}", sectors_count) << std::endl;
 	for(auto const &m : modes)
 		os << fmt::format("  mode{} sectors: {}", m.first, m.second) << std::endl;
@@ -4,6 +4,7 @@
 
 #include <filesystem>
 #include <ostream>
+#include "context.hh"
 
 
 
@@ -13,12 +14,14 @@ namespace gpsxre
 class SystemCDROM
 {
 public:
-	SystemCDROM(const std::filesystem::path &track_path);
+	SystemCDROM(const TrackContext &context);
+
+	static uint32_t probe(const TrackContext &context);
 
 	void operator()(std::ostream &os) const;
 
 private:
-	std::filesystem::path _trackPath;
+	const TrackContext &_context;
 };
 
 }
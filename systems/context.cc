@@ -0,0 +1,202 @@
+#include <cstring>
+#include <fmt/format.h>
+#include "common.hh"
+#include "file_io.hh"
+#include "redumper.hh"
+#include "context.hh"
+
+
+
+namespace gpsxre
+{
+
+TrackContext::TrackContext(const std::filesystem::path &track_path)
+	: _trackPath(track_path)
+	, _sectorsCount(std::filesystem::file_size(track_path) / CD_DATA_SIZE)
+	, _fs(track_path, std::fstream::in | std::fstream::binary)
+	, _virtual(false)
+	, _lbaStart(0)
+	, _writeOffset(0)
+	, _dataTrack(false)
+	, _scrambled(false)
+	, _fillByte(0)
+	, _dataMode(1)
+	, _dataSync(false)
+{
+	if(!_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", _trackPath.filename().string()));
+
+	init();
+
+	if(ImageBrowser::IsDataTrack(_trackPath))
+	{
+		_browser = std::make_unique<ImageBrowser>(_trackPath, 0, std::filesystem::file_size(_trackPath), false);
+		_rootEntries = _browser->RootDirectory()->Entries();
+	}
+}
+
+
+TrackContext::TrackContext(const std::filesystem::path &track_path, const std::filesystem::path &scm_path, const std::filesystem::path &state_path,
+                           int32_t lba_start, int32_t lba_end, int32_t write_offset, bool data_track, bool scrambled, uint8_t fill_byte)
+	: _trackPath(track_path)
+	, _sectorsCount(lba_end - lba_start)
+	, _fs(scm_path, std::fstream::in | std::fstream::binary)
+	, _virtual(true)
+	, _stateFs(state_path, std::fstream::in | std::fstream::binary)
+	, _lbaStart(lba_start)
+	, _writeOffset(write_offset)
+	, _dataTrack(data_track)
+	, _scrambled(scrambled)
+	, _fillByte(fill_byte)
+	, _dataMode(1)
+	, _dataSync(false)
+{
+	if(!_fs.is_open())
+		throw_line(fmt::format("unable to open file ({})", scm_path.filename().string()));
+	if(!_stateFs.is_open())
+		throw_line(fmt::format("unable to open file ({})", state_path.filename().string()));
+
+	init();
+
+	if(_dataSync)
+		_dataMode = _firstSector.header.mode;
+
+	if(_dataTrack && _sectorsCount > iso9660::SYSTEM_AREA_SIZE)
+	{
+		uint64_t file_start_offset = (uint64_t)(_lbaStart - LBA_START) * CD_DATA_SIZE + _writeOffset * CD_SAMPLE_SIZE;
+
+		// no primary volume descriptor is not an error here, analyzers just see a non ISO9660 track
+		try
+		{
+			_browser = std::make_unique<ImageBrowser>(scm_path, file_start_offset, file_start_offset + (uint64_t)_sectorsCount * CD_DATA_SIZE, _scrambled);
+			_rootEntries = _browser->RootDirectory()->Entries();
+		}
+		catch(...)
+		{
+			_browser.reset();
+			_rootEntries.clear();
+		}
+	}
+}
+
+
+void TrackContext::init()
+{
+	memset(&_firstSector, 0, sizeof(_firstSector));
+	if(_sectorsCount)
+	{
+		read((uint8_t *)&_firstSector, 0, 1);
+		_dataSync = !memcmp(_firstSector.sync, CD_DATA_SYNC, sizeof(CD_DATA_SYNC));
+	}
+}
+
+
+const std::filesystem::path &TrackContext::trackPath() const
+{
+	return _trackPath;
+}
+
+
+std::string TrackContext::trackName() const
+{
+	return _trackPath.filename().string();
+}
+
+
+uint32_t TrackContext::sectorsCount() const
+{
+	return _sectorsCount;
+}
+
+
+bool TrackContext::dataSync() const
+{
+	return _dataSync;
+}
+
+
+bool TrackContext::dataTrack() const
+{
+	return _browser != nullptr;
+}
+
+
+const Sector &TrackContext::firstSector() const
+{
+	return _firstSector;
+}
+
+
+void TrackContext::read(uint8_t *data, uint32_t index, uint32_t count) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if(_virtual)
+		readVirtual(data, index, count);
+	else
+		read_entry(_fs, data, CD_DATA_SIZE, index, count, 0, 0);
+}
+
+
+ImageBrowser *TrackContext::browser() const
+{
+	return _browser.get();
+}
+
+
+// same sector reconstruction as split does, without offset shift correction
+void TrackContext::readVirtual(uint8_t *data, uint32_t index, uint32_t count) const
+{
+	std::vector<State> state(CD_DATA_SIZE_SAMPLES);
+
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		int32_t lba = _lbaStart + (int32_t)(index + i);
+		uint32_t lba_index = lba - LBA_START;
+		uint8_t *sector = data + i * CD_DATA_SIZE;
+
+		bool generate_sector = false;
+		read_entry(_stateFs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba_index, 1, -_writeOffset, (uint8_t)State::ERROR_SKIP);
+		for(auto const &s : state)
+		{
+			if(s == State::ERROR_SKIP || s == State::ERROR_C2)
+			{
+				generate_sector = true;
+				break;
+			}
+		}
+
+		if(generate_sector)
+		{
+			if(_dataTrack)
+			{
+				Sector &s = *(Sector *)sector;
+				memcpy(s.sync, CD_DATA_SYNC, sizeof(CD_DATA_SYNC));
+				s.header.address = LBA_to_BCDMSF(lba);
+				s.header.mode = _dataMode;
+				memset(s.mode2.user_data, _fillByte, sizeof(s.mode2.user_data));
+			}
+			else
+				memset(sector, _fillByte, CD_DATA_SIZE);
+		}
+		else
+		{
+			read_entry(_fs, sector, CD_DATA_SIZE, lba_index, 1, -_writeOffset * CD_SAMPLE_SIZE, 0);
+
+			if(_dataTrack && _scrambled)
+				_scrambler.Descramble(sector, &lba);
+		}
+	}
+}
+
+
+std::shared_ptr<ImageBrowser::Entry> TrackContext::rootEntry(const std::string &name) const
+{
+	auto name_case = str_uppercase(name);
+	for(auto const &e : _rootEntries)
+		if(str_uppercase(e->Name()) == name_case)
+			return e;
+
+	return nullptr;
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+
+
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "cd.hh"
+#include "image_browser.hh"
+#include "scrambler.hh"
+
+
+
+namespace gpsxre
+{
+
+// per-track analysis state shared by all system analyzers
+// created once per track, all accessors are safe to call from multiple threads
+class TrackContext
+{
+public:
+	TrackContext(const std::filesystem::path &track_path);
+	// virtual track view, sectors are descrambled on the fly from a scrambled image
+	// track_path is the would-be split track path, lba range is in disc LBA
+	TrackContext(const std::filesystem::path &track_path, const std::filesystem::path &scm_path, const std::filesystem::path &state_path,
+	             int32_t lba_start, int32_t lba_end, int32_t write_offset, bool data_track, bool scrambled, uint8_t fill_byte);
+
+	const std::filesystem::path &trackPath() const;
+	std::string trackName() const;
+	uint32_t sectorsCount() const;
+
+	// first sector contains a valid data sync
+	bool dataSync() const;
+	// ISO9660 primary volume descriptor is present
+	bool dataTrack() const;
+	const Sector &firstSector() const;
+
+	void read(uint8_t *data, uint32_t index, uint32_t count) const;
+	ImageBrowser *browser() const;
+	// root directory is parsed once, lookup is case insensitive
+	std::shared_ptr<ImageBrowser::Entry> rootEntry(const std::string &name) const;
+
+private:
+	std::filesystem::path _trackPath;
+	uint32_t _sectorsCount;
+
+	mutable std::fstream _fs;
+	mutable std::mutex _mutex;
+
+	// virtual track view
+	bool _virtual;
+	mutable std::fstream _stateFs;
+	int32_t _lbaStart;
+	int32_t _writeOffset;
+	bool _dataTrack;
+	bool _scrambled;
+	uint8_t _fillByte;
+	uint8_t _dataMode;
+	Scrambler _scrambler;
+
+	Sector _firstSector;
+	bool _dataSync;
+	std::unique_ptr<ImageBrowser> _browser;
+	std::list<std::shared_ptr<ImageBrowser::Entry>> _rootEntries;
+
+	void init();
+	void readVirtual(uint8_t *data, uint32_t index, uint32_t count) const;
+};
+
+}
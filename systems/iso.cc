@@ -1,5 +1,4 @@
 #include <fmt/format.h>
-#include "image_browser.hh"
 #include "hex_bin.hh"
 #include "iso.hh"
 
@@ -8,23 +7,27 @@
 namespace gpsxre
 {
 
-SystemISO::SystemISO(const std::filesystem::path &track_path)
-	: _trackPath(track_path)
-	, _trackSize(std::filesystem::file_size(track_path))
+SystemISO::SystemISO(const TrackContext &context)
+	: _context(context)
 {
 	;
 }
 
 
+uint32_t SystemISO::probe(const TrackContext &context)
+{
+	return context.dataTrack() ? 100 : 0;
+}
+
+
 void SystemISO::operator()(std::ostream &os) const
 {
-	if(ImageBrowser::IsDataTrack(_trackPath))
+	auto browser = _context.browser();
+	if(browser != nullptr)
 	{
-		ImageBrowser browser(_trackPath, 0, _trackSize, false);
-
-		os << fmt::format("ISO9660 [{}]:", _trackPath.filename().string()) << std::endl;
+		os << fmt::format("ISO9660 [{}]:", _context.trackName()) << std::endl;
 
-		auto pvd = browser.GetPVD();
+		auto pvd = browser->GetPVD();
 		os << "  PVD:" << std::endl;
 		os << fmt::format("{}", hexdump((uint8_t *)&pvd, 0x320, 96));
 	}
@@ -4,6 +4,7 @@
 
 #include <filesystem>
 #include <ostream>
+#include "context.hh"
 
 
 
@@ -13,13 +14,14 @@ namespace gpsxre
 class SystemISO
 {
 public:
-	SystemISO(const std::filesystem::path &track_path);
+	SystemISO(const TrackContext &context);
+
+	static uint32_t probe(const TrackContext &context);
 
 	void operator()(std::ostream &os) const;
 
 private:
-	std::filesystem::path _trackPath;
-	uint64_t _trackSize;
+	const TrackContext &_context;
 };
 
 }
@@ -34,28 +34,44 @@ const std::set<uint32_t> SystemPSX::_LIBCRYPT_SECTORS_COUNT =
 };
 
 
-SystemPSX::SystemPSX(const std::filesystem::path &track_path)
-	: _trackPath(track_path)
-	, _trackSize(std::filesystem::file_size(track_path))
+SystemPSX::SystemPSX(const TrackContext &context)
+	: _context(context)
 {
 	;
 }
 
 
-void SystemPSX::operator()(std::ostream &os) const
+uint32_t SystemPSX::probe(const TrackContext &context)
 {
-	if(ImageBrowser::IsDataTrack(_trackPath))
+	uint32_t score = 0;
+
+	// boot file is mandatory, either referenced by SYSTEM.CNF or default PSX.EXE
+	if(context.dataTrack() && (context.rootEntry("SYSTEM.CNF") || context.rootEntry("PSX.EXE")))
 	{
-		ImageBrowser browser(_trackPath, 0, _trackSize, false);
+		score = 50;
+
+		// PSX discs are CD-XA
+		if(context.firstSector().header.mode == 2)
+			score = 100;
+	}
+
+	return score;
+}
 
-		auto exe_path = findEXE(browser);
+
+void SystemPSX::operator()(std::ostream &os) const
+{
+	auto browser = _context.browser();
+	if(browser != nullptr)
+	{
+		auto exe_path = findEXE(*browser);
 		if(!exe_path.empty())
 		{
-			auto exe_file = browser.RootDirectory()->SubEntry(exe_path);
+			auto exe_file = browser->RootDirectory()->SubEntry(exe_path);
 			auto exe = exe_file->Read();
 			if(exe.size() >= _EXE_MAGIC.length() && std::string((char *)exe.data(), _EXE_MAGIC.length()) == _EXE_MAGIC)
 			{
-				os << fmt::format("PSX [{}]:", _trackPath.filename().string()) << std::endl;
+				os << fmt::format("PSX [{}]:", _context.trackName()) << std::endl;
 				os << fmt::format("  EXE: {}", exe_path) << std::endl;
 
 				{
@@ -78,13 +94,13 @@ void SystemPSX::operator()(std::ostream &os) const
 
 				{
 					std::stringstream ss;
-					bool antimod = findAntiModchipStrings(ss, browser);
+					bool antimod = findAntiModchipStrings(ss, *browser);
 					os << fmt::format("  anti-modchip: {}", antimod ? "yes" : "no") << std::endl;
 					if(antimod)
 						os << ss.str() << std::endl;
 				}
 
-				std::filesystem::path sub_path = track_extract_basename(_trackPath.string()) + ".subcode";
+				std::filesystem::path sub_path = track_extract_basename(_context.trackPath().string()) + ".subcode";
 				if(std::filesystem::exists(sub_path))
 				{
 					std::stringstream ss;
@@ -243,15 +259,10 @@ bool SystemPSX::detectEdcFast() const
 {
 	bool edc = false;
 
-	std::fstream fs(_trackPath, std::fstream::in | std::fstream::binary);
-	if(!fs.is_open())
-		throw_line(fmt::format("unable to open file ({})", _trackPath.filename().string()));
-
-	uint32_t sectors_count = _trackSize / CD_DATA_SIZE;
-	if(sectors_count >= iso9660::SYSTEM_AREA_SIZE)
+	if(_context.sectorsCount() >= iso9660::SYSTEM_AREA_SIZE)
 	{
 		Sector sector;
-		read_entry(fs, (uint8_t *)&sector, CD_DATA_SIZE, iso9660::SYSTEM_AREA_SIZE - 1, 1, 0, 0);
+		_context.read((uint8_t *)&sector, iso9660::SYSTEM_AREA_SIZE - 1, 1);
 
 		if(sector.header.mode == 2 && sector.mode2.xa.sub_header.submode & (uint8_t)CDXAMode::FORM2)
 			edc = sector.mode2.xa.form2.edc;
@@ -272,7 +283,7 @@ bool SystemPSX::detectLibCrypt(std::ostream &os, std::filesystem::path sub_path)
 	std::vector<int32_t> candidates;
 
 	std::vector<uint8_t> sub_buffer(CD_SUBCODE_SIZE);
-	int32_t lba_end = _trackSize / CD_DATA_SIZE;
+	int32_t lba_end = _context.sectorsCount();
 	for(uint32_t i = 0; i < _LIBCRYPT_SECTORS_BASE.size(); ++i)
 	{
 		int32_t lba1 = _LIBCRYPT_SECTORS_BASE[i];
@@ -7,6 +7,7 @@
 #include <set>
 #include <string>
 #include <vector>
+#include "context.hh"
 #include "image_browser.hh"
 
 
@@ -17,7 +18,9 @@ namespace gpsxre
 class SystemPSX
 {
 public:
-	SystemPSX(const std::filesystem::path &track_path);
+	SystemPSX(const TrackContext &context);
+
+	static uint32_t probe(const TrackContext &context);
 
 	void operator()(std::ostream &os) const;
 
@@ -27,8 +30,7 @@ private:
 	static const uint32_t _LIBCRYPT_SECTORS_SHIFT;
 	static const std::set<uint32_t> _LIBCRYPT_SECTORS_COUNT;
 
-	std::filesystem::path _trackPath;
-	uint64_t _trackSize;
+	const TrackContext &_context;
 
 	std::string findEXE(ImageBrowser &browser) const;
 	std::pair<std::string, std::string> deduceSerial(std::string exe_path) const;
@@ -11,19 +11,33 @@ namespace gpsxre
 System System::_system;
 
 
+System::System()
+{
+	registerSystem("CD-ROM", SystemCDROM::probe, [](const TrackContext &context) { return SystemCDROM(context); });
+	registerSystem("ISO9660", SystemISO::probe, [](const TrackContext &context) { return SystemISO(context); });
+	registerSystem("PSX", SystemPSX::probe, [](const TrackContext &context) { return SystemPSX(context); });
+}
+
+
 System &System::get()
 {
 	return _system;
 }
 
 
-std::list<std::function<void(std::ostream &os)>> System::getSystems(const std::filesystem::path &track_path) const
+void System::registerSystem(const std::string &name, Probe probe, Factory factory)
+{
+	_entries.push_back(Entry{name, probe, factory});
+}
+
+
+std::list<System::Callback> System::getSystems(const TrackContext &context) const
 {
-	std::list<std::function<void(std::ostream &os)>> systems;
+	std::list<Callback> systems;
 
-	systems.emplace_back(SystemCDROM(track_path));
-	systems.emplace_back(SystemISO(track_path));
-	systems.emplace_back(SystemPSX(track_path));
+	for(auto const &e : _entries)
+		if(e.probe(context) >= PROBE_THRESHOLD)
+			systems.emplace_back(e.factory(context));
 
 	return systems;
 }
@@ -2,10 +2,13 @@
 
 
 
-#include <filesystem>
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <ostream>
+#include <string>
+#include <vector>
+#include "context.hh"
 
 
 
@@ -18,10 +21,30 @@ public:
 	static System &get();
 
 	typedef std::function<void(std::ostream &os)> Callback;
-	std::list<Callback> getSystems(const std::filesystem::path &track_path) const;
+
+	// cheap check over shared track data, returns match confidence [0 .. 100]
+	typedef std::function<uint32_t(const TrackContext &context)> Probe;
+	typedef std::function<Callback(const TrackContext &context)> Factory;
+
+	// systems probed below this confidence are not instantiated
+	static constexpr uint32_t PROBE_THRESHOLD = 50;
+
+	void registerSystem(const std::string &name, Probe probe, Factory factory);
+	std::list<Callback> getSystems(const TrackContext &context) const;
 
 private:
+	struct Entry
+	{
+		std::string name;
+		Probe probe;
+		Factory factory;
+	};
+
 	static System _system;
+
+	std::vector<Entry> _entries;
+
+	System();
 };
 
 }
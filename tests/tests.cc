@@ -1,13 +1,39 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fmt/format.h>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <new>
 #include <set>
+#include <signal.h>
+#include <sstream>
+#include <thread>
+#include <tuple>
 #include <vector>
 
+#include "accuraterip.hh"
+#include "bounded_queue.hh"
 #include "cd.hh"
 #include "common.hh"
+#include "drive.hh"
 #include "file_io.hh"
+#include "generator/image_generator.hh"
+#include "interval_set.hh"
+#include "json.hh"
+#include "logger.hh"
+#include "pattern_scanner.hh"
+#include "profiler.hh"
 #include "scrambler.hh"
+#include "sector_state.hh"
+#include "signal.hh"
+#include "simd.hh"
+#include "subcode.hh"
 
 
 
@@ -15,6 +41,34 @@ using namespace gpsxre;
 
 
 
+// heap allocation counter, used to verify allocation free hot paths
+static std::atomic<uint64_t> g_allocations(0);
+
+
+void *operator new(std::size_t size)
+{
+	++g_allocations;
+
+	if(void *p = std::malloc(size))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+
+void operator delete(void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+
+
 bool test_scale()
 {
 	bool success = true;
@@ -168,6 +222,1029 @@ bool test_unscramble()
 
 
 
+bool test_accuraterip()
+{
+	bool success = true;
+
+	constexpr uint32_t OFFSET_RANGE = 1000;
+
+	// pseudo random audio with padding for the offset range
+	std::vector<uint32_t> samples(20 * CD_DATA_SIZE_SAMPLES + 2 * OFFSET_RANGE);
+	uint32_t seed = 0x12345678;
+	for(auto &s : samples)
+	{
+		seed = seed * 1103515245 + 12345;
+		s = seed;
+	}
+	const uint32_t *track = samples.data() + OFFSET_RANGE;
+	uint32_t samples_count = (uint32_t)samples.size() - 2 * OFFSET_RANGE;
+
+	std::vector<std::pair<bool, bool>> cases = { {false, false}, {true, false}, {false, true}, {true, true} };
+	for(auto const &c : cases)
+	{
+		std::cout << fmt::format("AccurateRip v1 sweep (first: {}, last: {})... ", c.first, c.second) << std::flush;
+
+		auto crcs = accuraterip_v1_sweep(track, samples_count, c.first, c.second, OFFSET_RANGE);
+
+		bool match = crcs.size() == 2 * OFFSET_RANGE + 1;
+		for(int32_t o = -(int32_t)OFFSET_RANGE; match && o <= (int32_t)OFFSET_RANGE; ++o)
+		{
+			if(crcs[o + OFFSET_RANGE] != accuraterip_v1(track + o, samples_count, c.first, c.second))
+			{
+				std::cout << fmt::format("failure, offset: {:+}", o);
+				match = false;
+			}
+		}
+
+		if(match)
+			std::cout << "success";
+		else
+			success = false;
+
+		std::cout << std::endl;
+	}
+
+	return success;
+}
+
+
+bool test_interval_set()
+{
+	bool success = true;
+
+	std::vector<std::pair<int32_t, int32_t>> cases =
+	{
+		{10, 20}, {30, 40}, {15, 25}, {40, 45}, {-100, -90}, {60, 60}, {50, 55}, {0, 100}
+	};
+
+	// sets are built incrementally and checked against linear lookup in a plain vector after each insertion
+	std::vector<std::pair<int32_t, int32_t>> ranges;
+	IntervalSet set;
+	for(auto const &c : cases)
+	{
+		std::cout << fmt::format("interval set (add: [{} .. {}))... ", c.first, c.second) << std::flush;
+
+		ranges.push_back(c);
+		set.Add(c);
+
+		bool match = true;
+
+		auto const &intervals = set.Intervals();
+		for(uint32_t i = 1; i < intervals.size(); ++i)
+			if(intervals[i - 1].second >= intervals[i].first)
+				match = false;
+
+		auto contains = [&ranges](int32_t v)
+		{
+			for(auto const &r : ranges)
+				if(v >= r.first && v < r.second)
+					return true;
+			return false;
+		};
+
+		// ascending cursor is monotonic, descending one exercises binary search fallback
+		IntervalSet::Cursor cursor(set);
+		IntervalSet::Cursor cursor_reverse(set);
+		for(int32_t v = -120; match && v < 120; ++v)
+		{
+			if((set.Find(v) != nullptr) != contains(v) || (cursor.Find(v) != nullptr) != contains(v) || (cursor_reverse.Find(-v) != nullptr) != contains(-v))
+			{
+				std::cout << fmt::format("failure, value: {}", v);
+				match = false;
+			}
+		}
+
+		if(match)
+			std::cout << "success";
+		else
+			success = false;
+
+		std::cout << std::endl;
+	}
+
+	return success;
+}
+
+
+bool test_sector_unpack()
+{
+	bool success = true;
+
+	// reference: generic copy through the shifted C2 concatenation used before per order specialization
+	auto unpack_generic = [](uint8_t *sector, const uint8_t *response, DriveConfig::SectorOrder sector_order, uint32_t c2_shift)
+	{
+		auto layout = sector_order_layout(sector_order);
+		uint32_t sectors_count = c2_shift / CD_C2_SIZE + (c2_shift % CD_C2_SIZE ? 1 : 0) + 1;
+
+		memset(sector, 0x00, CD_RAW_DATA_SIZE);
+
+		if(layout.data_offset != CD_RAW_DATA_SIZE)
+			memcpy(sector + 0, response + layout.data_offset, CD_DATA_SIZE);
+
+		if(layout.c2_offset != CD_RAW_DATA_SIZE)
+		{
+			std::vector<uint8_t> c2_buffer(CD_C2_SIZE * sectors_count);
+			for(uint32_t i = 0; i < sectors_count; ++i)
+				memcpy(c2_buffer.data() + CD_C2_SIZE * i, response + layout.size * i + layout.c2_offset, CD_C2_SIZE);
+
+			memcpy(sector + CD_DATA_SIZE, c2_buffer.data() + c2_shift, CD_C2_SIZE);
+		}
+
+		if(layout.subcode_offset != CD_RAW_DATA_SIZE)
+			memcpy(sector + CD_DATA_SIZE + CD_C2_SIZE, response + layout.subcode_offset, CD_SUBCODE_SIZE);
+	};
+
+	// name, order, unpackers without / with C2 split
+	std::vector<std::tuple<std::string, DriveConfig::SectorOrder, SectorUnpacker, SectorUnpacker>> orders =
+	{
+		{ "DATA_C2_SUB", DriveConfig::SectorOrder::DATA_C2_SUB, sector_unpack<DriveConfig::SectorOrder::DATA_C2_SUB, false>, sector_unpack<DriveConfig::SectorOrder::DATA_C2_SUB, true> },
+		{ "DATA_SUB_C2", DriveConfig::SectorOrder::DATA_SUB_C2, sector_unpack<DriveConfig::SectorOrder::DATA_SUB_C2, false>, sector_unpack<DriveConfig::SectorOrder::DATA_SUB_C2, true> },
+		{ "DATA_SUB", DriveConfig::SectorOrder::DATA_SUB, sector_unpack<DriveConfig::SectorOrder::DATA_SUB, false>, sector_unpack<DriveConfig::SectorOrder::DATA_SUB, false> },
+		{ "DATA_C2", DriveConfig::SectorOrder::DATA_C2, sector_unpack<DriveConfig::SectorOrder::DATA_C2, false>, sector_unpack<DriveConfig::SectorOrder::DATA_C2, true> }
+	};
+
+	uint32_t seed = 0x2468ACE0;
+	for(auto const &o : orders)
+	{
+		for(uint32_t c2_shift : { 0, 1, 293, 294, 295, 600 })
+		{
+			std::cout << fmt::format("sector unpack (order: {}, C2 shift: {})... ", std::get<0>(o), c2_shift) << std::flush;
+
+			uint32_t sectors_count = c2_shift / CD_C2_SIZE + (c2_shift % CD_C2_SIZE ? 1 : 0) + 1;
+			std::vector<uint8_t> response(CD_RAW_DATA_SIZE * sectors_count);
+			for(auto &r : response)
+			{
+				seed = seed * 1103515245 + 12345;
+				r = (uint8_t)(seed >> 16);
+			}
+
+			std::vector<uint8_t> sector_expected(CD_RAW_DATA_SIZE);
+			unpack_generic(sector_expected.data(), response.data(), std::get<1>(o), c2_shift);
+
+			// stale content must be overwritten
+			std::vector<uint8_t> sector(CD_RAW_DATA_SIZE, 0xAA);
+			auto unpacker = c2_shift % CD_C2_SIZE ? std::get<3>(o) : std::get<2>(o);
+			unpacker(sector.data(), response.data(), c2_shift);
+
+			if(sector == sector_expected)
+				std::cout << "success";
+			else
+			{
+				std::cout << "failure";
+				success = false;
+			}
+			std::cout << std::endl;
+		}
+	}
+
+	return success;
+}
+
+
+bool test_sector_state()
+{
+	bool success = true;
+
+	uint32_t seed = 0x87654321;
+	auto random = [&seed]()
+	{
+		seed = seed * 1103515245 + 12345;
+		return seed >> 8;
+	};
+
+	// sparse C2 and mixed states to hit every branch
+	for(uint32_t density : { 0, 1, 8, 64, 256 })
+	{
+		std::cout << fmt::format("sector state (density: {})... ", density) << std::flush;
+
+		std::vector<uint8_t> c2(CD_C2_SIZE);
+		for(auto &c : c2)
+			c = random() % 256 < density ? (uint8_t)random() : 0;
+
+		// clean sectors for sparse cases so that merge flags aren't always set
+		uint32_t state_min = density < 8 ? (uint32_t)State::SUCCESS_C2_OFF + density : 0;
+		std::vector<State> state(CD_DATA_SIZE_SAMPLES);
+		for(auto &s : state)
+			s = (State)(state_min + random() % (5 - state_min));
+
+		// reference
+		std::vector<State> state_expected(state);
+		uint32_t c2_count_expected = 0;
+		for(uint32_t i = 0; i < CD_DATA_SIZE_SAMPLES; ++i)
+		{
+			uint8_t c2_quad = i % 2 ? c2[i / 2] & 0x0F : c2[i / 2] >> 4;
+			if(c2_quad)
+			{
+				state_expected[i] = State::ERROR_C2;
+				c2_count_expected += bits_count(c2_quad);
+			}
+		}
+
+		uint32_t c2_count = state_from_c2(state, c2.data());
+		bool match = c2_count == c2_count_expected && state == state_expected;
+
+		std::vector<State> state_file(CD_DATA_SIZE_SAMPLES);
+		for(auto &s : state_file)
+			s = (State)(state_min + random() % (5 - state_min));
+		std::vector<uint32_t> samples(CD_DATA_SIZE_SAMPLES);
+		std::vector<uint32_t> samples_file(CD_DATA_SIZE_SAMPLES);
+		for(uint32_t i = 0; i < CD_DATA_SIZE_SAMPLES; ++i)
+		{
+			samples[i] = random();
+			samples_file[i] = random();
+		}
+
+		// reference
+		StateMerge merge_expected = {};
+		std::vector<State> merged_expected(state);
+		std::vector<uint32_t> samples_expected(samples);
+		for(uint32_t i = 0; i < CD_DATA_SIZE_SAMPLES; ++i)
+		{
+			merge_expected.scsi_exists_file |= state_file[i] == State::ERROR_SKIP;
+			merge_expected.c2_exists_file |= state_file[i] == State::ERROR_C2;
+			merge_expected.update |= merged_expected[i] > state_file[i];
+			if(state_file[i] > merged_expected[i])
+			{
+				merged_expected[i] = state_file[i];
+				samples_expected[i] = samples_file[i];
+			}
+			merge_expected.scsi_exists |= merged_expected[i] == State::ERROR_SKIP;
+			merge_expected.c2_exists |= merged_expected[i] == State::ERROR_C2;
+		}
+
+		auto merge = state_merge(state.data(), samples.data(), state_file.data(), samples_file.data(), CD_DATA_SIZE_SAMPLES);
+		match = match && state == merged_expected && samples == samples_expected && merge.update == merge_expected.update && merge.scsi_exists_file == merge_expected.scsi_exists_file
+			&& merge.c2_exists_file == merge_expected.c2_exists_file && merge.scsi_exists == merge_expected.scsi_exists && merge.c2_exists == merge_expected.c2_exists;
+
+		if(match)
+			std::cout << "success";
+		else
+		{
+			std::cout << "failure";
+			success = false;
+		}
+
+		std::cout << std::endl;
+	}
+
+	return success;
+}
+
+
+bool test_simd()
+{
+	bool success = true;
+
+	uint32_t seed = 0x13572468;
+	auto random = [&seed]()
+	{
+		seed = seed * 1103515245 + 12345;
+		return seed >> 8;
+	};
+
+	// sizes around vector widths and unrolled blocks, unaligned offsets
+	const uint32_t sizes[] = { 0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 2352, 8191, 10000 };
+	const uint32_t offset_max = 3;
+
+	for(auto kernels : simd_kernels_available())
+	{
+		std::cout << fmt::format("SIMD primitives ({})... ", simd_level_string(kernels->level)) << std::flush;
+
+		bool match = true;
+		for(uint32_t size : sizes)
+		{
+			for(uint32_t offset = 0; offset <= offset_max; ++offset)
+			{
+				std::vector<uint8_t> buffer1(size + offset_max);
+				std::vector<uint8_t> buffer2(size + offset_max);
+				std::vector<uint8_t> table(size + offset_max);
+				for(uint32_t i = 0; i < buffer1.size(); ++i)
+				{
+					buffer1[i] = (uint8_t)random();
+					// mostly equal data
+					buffer2[i] = random() % 4 ? buffer1[i] : (uint8_t)random();
+					table[i] = (uint8_t)random();
+				}
+				const uint8_t *data1 = &buffer1[offset];
+				const uint8_t *data2 = &buffer2[offset];
+
+				// reference
+				uint64_t diff_bytes = 0;
+				uint64_t diff_bits = 0;
+				std::vector<uint8_t> xored(size);
+				for(uint32_t i = 0; i < size; ++i)
+				{
+					diff_bytes += data1[i] != data2[i];
+					diff_bits += bits_count((uint8_t)(data1[i] ^ data2[i]));
+					xored[i] = data1[i] ^ table[offset + i];
+				}
+
+				match = match && kernels->diff_bytes_count(data1, data2, size) == diff_bytes && kernels->diff_bits_count(data1, data2, size) == diff_bits;
+
+				std::vector<uint8_t> out(size);
+				kernels->xor_table(out.data(), data1, &table[offset], size);
+				match = match && out == xored;
+
+				// in-place
+				kernels->xor_table(&buffer1[offset], data1, &table[offset], size);
+				match = match && std::equal(xored.begin(), xored.end(), &buffer1[offset]);
+
+				// sparse alphabet so that pairs are frequent
+				for(uint32_t distance : { 0, 1, 11, 40 })
+				{
+					uint8_t first = random() % 4;
+					uint8_t last = random() % 4;
+					std::vector<uint8_t> pairs(size + offset_max);
+					for(auto &p : pairs)
+						p = random() % 4;
+
+					uint64_t expected = size;
+					for(uint64_t i = 0; i + distance < size; ++i)
+						if(pairs[offset + i] == first && pairs[offset + i + distance] == last)
+						{
+							expected = i;
+							break;
+						}
+
+					match = match && kernels->find_byte_pair(&pairs[offset], size, first, last, distance) == expected;
+				}
+
+				// zero buffer with a single non-zero byte at every position
+				std::vector<uint8_t> zero(size + offset_max);
+				match = match && kernels->is_zeroed(&zero[offset], size) && kernels->find_non_zero(&zero[offset], size) == size;
+				for(uint32_t i = 0; i < size; ++i)
+				{
+					zero[offset + i] = 1 << i % 8;
+					match = match && !kernels->is_zeroed(&zero[offset], size) && kernels->find_non_zero(&zero[offset], size) == i;
+					zero[offset + i] = 0;
+				}
+
+				// garbage outside of the range is ignored
+				if(offset)
+					zero[offset - 1] = 0xFF;
+				zero[offset + size] = 0xFF;
+				match = match && kernels->is_zeroed(&zero[offset], size) && kernels->find_non_zero(&zero[offset], size) == size;
+			}
+		}
+
+		if(match)
+			std::cout << "success";
+		else
+		{
+			std::cout << "failure";
+			success = false;
+		}
+
+		std::cout << std::endl;
+	}
+
+	return success;
+}
+
+
+bool test_pattern_scanner()
+{
+	bool success = true;
+
+	uint32_t seed = 0x2468ACE0;
+	auto random = [&seed]()
+	{
+		seed = seed * 1103515245 + 12345;
+		return seed >> 8;
+	};
+
+	// overlapping and nested patterns, single byte pattern and sync
+	std::vector<std::vector<uint8_t>> patterns = {
+		{ 1, 2, 1, 2 },
+		{ 2, 1 },
+		{ 3 },
+		{ 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+		std::vector<uint8_t>(std::begin(CD_DATA_SYNC), std::end(CD_DATA_SYNC))
+	};
+	PatternScanner scanner(patterns);
+
+	for(uint32_t size : { 0, 1, 7, 64, 1000, 100000 })
+	{
+		std::cout << fmt::format("pattern scanner (size: {})... ", size) << std::flush;
+
+		std::vector<uint8_t> data(size);
+		for(auto &d : data)
+			d = 1 + random() % 3;
+		// sprinkle syncs
+		for(uint32_t i = 0; i + sizeof(CD_DATA_SYNC) <= size; i += 1 + random() % 5000)
+			std::copy(std::begin(CD_DATA_SYNC), std::end(CD_DATA_SYNC), &data[i]);
+
+		// reference
+		std::vector<std::pair<uint64_t, uint32_t>> matches_expected;
+		for(uint64_t i = 0; i < size; ++i)
+			for(uint32_t j = 0; j < patterns.size(); ++j)
+				if(i + patterns[j].size() <= size && std::equal(patterns[j].begin(), patterns[j].end(), &data[i]))
+					matches_expected.emplace_back(i, j);
+
+		std::vector<std::pair<uint64_t, uint32_t>> matches;
+		scanner.Find(data.data(), data.size(), [&](uint32_t pattern_index, uint64_t position)
+		{
+			matches.emplace_back(position, pattern_index);
+			return false;
+		});
+		bool match = matches == matches_expected;
+
+		// random chunks, including tiny ones shorter than the longest pattern
+		for(uint32_t chunk_max : { 1, 5, 13, 4096 })
+		{
+			matches.clear();
+			scanner.Reset();
+			for(uint64_t i = 0; i < size;)
+			{
+				uint64_t chunk = std::min((uint64_t)(1 + random() % chunk_max), size - i);
+				scanner.Feed(&data[i], chunk, [&](uint32_t pattern_index, uint64_t position)
+				{
+					matches.emplace_back(position, pattern_index);
+					return false;
+				});
+				i += chunk;
+			}
+
+			// boundary matches are reported before the ones fully contained in the chunk
+			std::sort(matches.begin(), matches.end());
+			match = match && matches == matches_expected;
+		}
+
+		// interruption
+		if(!matches_expected.empty())
+		{
+			uint64_t position_first = std::numeric_limits<uint64_t>::max();
+			bool interrupted = scanner.Find(data.data(), data.size(), [&](uint32_t, uint64_t position)
+			{
+				position_first = position;
+				return true;
+			});
+			match = match && interrupted && position_first == matches_expected.front().first;
+		}
+
+		if(match)
+			std::cout << "success";
+		else
+		{
+			std::cout << "failure";
+			success = false;
+		}
+
+		std::cout << std::endl;
+	}
+
+	return success;
+}
+
+
+bool test_bounded_queue()
+{
+	bool success = true;
+
+	std::cout << "bounded queue (capacity)... " << std::flush;
+	{
+		BoundedQueue<uint32_t> queue(4);
+		bool match = true;
+		for(uint32_t i = 0; i < 4; ++i)
+			match = match && queue.Push(std::move(i));
+		uint32_t overflow = 4;
+		match = match && !queue.Push(std::move(overflow)) && !queue.Empty();
+		for(uint32_t i = 0; i < 4; ++i)
+		{
+			uint32_t value;
+			match = match && queue.Pop(value) && value == i;
+		}
+		uint32_t value;
+		match = match && !queue.Pop(value) && queue.Empty();
+
+		if(match)
+			std::cout << "success";
+		else
+		{
+			std::cout << "failure";
+			success = false;
+		}
+		std::cout << std::endl;
+	}
+
+	// every value is delivered once and in order for each producer
+	std::cout << "bounded queue (producers: 4)... " << std::flush;
+	{
+		constexpr uint32_t producers_count = 4;
+		constexpr uint32_t values_count = 100000;
+
+		BoundedQueue<uint64_t> queue(64);
+		std::vector<std::thread> producers;
+		for(uint32_t p = 0; p < producers_count; ++p)
+			producers.emplace_back([&queue, p]()
+			{
+				for(uint64_t i = 0; i < values_count; ++i)
+				{
+					uint64_t value = (uint64_t)p << 32 | i;
+					while(!queue.Push(std::move(value)))
+						std::this_thread::yield();
+				}
+			});
+
+		bool match = true;
+		std::vector<uint64_t> next(producers_count);
+		for(uint64_t received = 0; received < producers_count * values_count;)
+		{
+			uint64_t value;
+			if(!queue.Pop(value))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			uint32_t p = (uint32_t)(value >> 32);
+			match = match && p < producers_count && (uint32_t)value == next[p];
+			if(p < producers_count)
+				++next[p];
+			++received;
+		}
+
+		for(auto &t : producers)
+			t.join();
+
+		if(match && queue.Empty())
+			std::cout << "success";
+		else
+		{
+			std::cout << "failure";
+			success = false;
+		}
+		std::cout << std::endl;
+	}
+
+	return success;
+}
+
+
+bool test_logger()
+{
+	constexpr uint32_t THREADS_COUNT = 4;
+	constexpr uint32_t MESSAGES_COUNT = 10000;
+
+	std::cout << fmt::format("logger sync (threads: {}, messages: {})... ", THREADS_COUNT, MESSAGES_COUNT) << std::flush;
+
+	auto log_path = std::filesystem::temp_directory_path() / "redumper_test_logger.log";
+	std::filesystem::remove(log_path);
+
+	// writer is idle after Sync(), capture its console output meanwhile
+	Logger::Get().Sync();
+	std::stringstream console;
+	auto cout_buffer = std::cout.rdbuf(console.rdbuf());
+
+	Logger::Get().Reset(log_path);
+
+	// many times the queue capacity, producers have to wait for the writer
+	std::vector<std::thread> threads;
+	for(uint32_t t = 0; t < THREADS_COUNT; ++t)
+		threads.emplace_back([t]()
+		{
+			for(uint32_t i = 0; i < MESSAGES_COUNT; ++i)
+				LOG("{} {}", t, i);
+		});
+	for(auto &t : threads)
+		t.join();
+
+	Logger::Get().Sync();
+
+	// everything logged before Sync() has to be in the file already
+	std::stringstream file;
+	{
+		std::ifstream fs(log_path);
+		file << fs.rdbuf();
+	}
+
+	Logger::Get().Reset("");
+	std::cout.rdbuf(cout_buffer);
+	std::filesystem::remove(log_path);
+
+	// skip log header
+	std::string messages(file.str());
+	messages.erase(0, messages.find('\n') + 1);
+
+	// complete and in per thread order, console receives the same sequence
+	bool success = messages == console.str();
+	std::vector<uint32_t> next(THREADS_COUNT);
+	std::stringstream ss(messages);
+	for(std::string line; success && std::getline(ss, line);)
+	{
+		uint32_t t, i;
+		if(std::sscanf(line.c_str(), "%u %u", &t, &i) != 2 || t >= THREADS_COUNT || i != next[t])
+			success = false;
+		else
+			++next[t];
+	}
+	for(auto n : next)
+		if(n != MESSAGES_COUNT)
+			success = false;
+
+	if(success)
+		std::cout << "success";
+	else
+		std::cout << "failure";
+	std::cout << std::endl;
+
+	return success;
+}
+
+
+bool test_profile_probe()
+{
+	std::cout << "profile probe... " << std::flush;
+
+	ProfileProbe probe("test");
+
+	// 90 fast calls and 10 slow ones
+	for(uint32_t i = 0; i < 90; ++i)
+		probe.Record(100, 10);
+	for(uint32_t i = 0; i < 10; ++i)
+		probe.Record(100000, 0);
+
+	bool success = probe.Calls() == 100 && probe.Duration() == 90 * 100 + 10 * 100000 && probe.Bytes() == 900;
+	// buckets are powers of 2
+	success = success && probe.Percentile(50) == 127 && probe.Percentile(90) == 127 && probe.Percentile(99) == 131071;
+
+	probe.Reset();
+	success = success && !probe.Calls() && !probe.Duration() && !probe.Bytes() && !probe.Percentile(99);
+
+	if(success)
+		std::cout << "success";
+	else
+		std::cout << "failure";
+	std::cout << std::endl;
+
+	return success;
+}
+
+
+bool test_image_generator()
+{
+	std::cout << "image generator... " << std::flush;
+
+	bool success = true;
+
+	// malformed layouts are rejected
+	for(auto description : { "track mode3 100", "track audio 0", "track audio 100\nfile A.BIN 10", "session\ntrack audio 100", "track audio 100 index0 75", "" })
+	{
+		try
+		{
+			image_layout_parse(description);
+			success = false;
+		}
+		catch(...)
+		{
+			;
+		}
+	}
+
+	auto layout = image_layout_parse("write_offset -12 # comment\ntrack mode1 100\nfile \"A#.BIN\" 3000 \"HEAD\"\ntrack audio 50 index0 10\nskip 20 2\nc2 30\nqerror 40");
+	success = success && layout.write_offset == -12 && layout.sessions.size() == 1 && layout.sessions.front().tracks.size() == 2 && layout.sessions.front().tracks.back().index0 == 10;
+	success = success && layout.sessions.front().tracks.front().files.front().name == "A#.BIN" && layout.sessions.front().tracks.front().files.front().size == 3000;
+
+	auto image_prefix = (std::filesystem::temp_directory_path() / fmt::format("redumper_tests_{}", (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count())).string();
+	image_generate(image_prefix, layout, 2);
+
+	// -150 .. 160 + lead-out
+	uint32_t sectors_count = 160 + layout.leadout_size - LBA_START;
+	success = success && check_file(image_prefix + ".scram", CD_DATA_SIZE) == sectors_count && check_file(image_prefix + ".state", CD_DATA_SIZE_SAMPLES) == sectors_count
+	       && check_file(image_prefix + ".subcode", CD_SUBCODE_SIZE) == sectors_count && std::filesystem::exists(image_prefix + ".toc") && !std::filesystem::exists(image_prefix + ".cdtext");
+
+	std::fstream scm_fs(image_prefix + ".scram", std::fstream::in | std::fstream::binary);
+	std::fstream state_fs(image_prefix + ".state", std::fstream::in | std::fstream::binary);
+	Scrambler scrambler;
+	std::vector<uint8_t> sector(CD_DATA_SIZE);
+	std::vector<State> state(CD_DATA_SIZE_SAMPLES);
+	for(int32_t lba : { -150, 0, 17, 20, 30, 99 })
+	{
+		read_entry(scm_fs, sector.data(), CD_DATA_SIZE, lba - LBA_START, 1, 12 * CD_SAMPLE_SIZE, 0);
+		read_entry(state_fs, (uint8_t *)state.data(), CD_DATA_SIZE_SAMPLES, lba - LBA_START, 1, 12, 0);
+
+		uint32_t c2 = std::count(state.begin(), state.end(), State::ERROR_C2);
+		uint32_t skip = std::count(state.begin(), state.end(), State::ERROR_SKIP);
+
+		int32_t sector_lba = lba;
+		bool descrambled = scrambler.Descramble(sector.data(), &sector_lba);
+		if(lba == 20)
+			success = success && skip == CD_DATA_SIZE_SAMPLES && is_zeroed(sector.data(), sector.size());
+		else if(lba == 30)
+			success = success && c2 && !skip;
+		else
+			success = success && descrambled && !c2 && !skip;
+	}
+	// volume descriptor
+	read_entry(scm_fs, sector.data(), CD_DATA_SIZE, 16 - LBA_START, 1, 12 * CD_SAMPLE_SIZE, 0);
+	scrambler.Process(sector.data(), sector.data());
+	success = success && !memcmp(&sector[17], "CD001", 5);
+
+	scm_fs.close();
+	state_fs.close();
+	for(auto extension : { ".scram", ".state", ".subcode", ".toc", ".fulltoc" })
+		std::filesystem::remove(image_prefix + extension);
+
+	if(success)
+		std::cout << "success";
+	else
+		std::cout << "failure";
+	std::cout << std::endl;
+
+	return success;
+}
+
+
+bool test_json()
+{
+	bool success = true;
+
+	std::cout << "JSON (parse)... " << std::flush;
+	{
+		bool match = true;
+		try
+		{
+			auto v = json_parse(" {\"command\": \"submit\", \"id\": -12.5e1, \"args\": [\"split\", \"--image-name=a \\\"b\\\"\\u00e9\\ud83d\\ude00\"], \"flag\": true, \"none\": null, \"nested\": {\"empty\": []}} ");
+			auto command = v.Member("command");
+			auto id = v.Member("id");
+			auto args = v.Member("args");
+			auto flag = v.Member("flag");
+			auto none = v.Member("none");
+			auto nested = v.Member("nested");
+			match = v.type == JSONValue::Type::OBJECT && v.object.size() == 6 && v.Member("missing") == nullptr;
+			match = match && command != nullptr && command->type == JSONValue::Type::STRING && command->string == "submit";
+			match = match && id != nullptr && id->type == JSONValue::Type::NUMBER && id->number == -125;
+			match = match && args != nullptr && args->type == JSONValue::Type::ARRAY && args->array.size() == 2 && args->array[1].string == "--image-name=a \"b\"\xC3\xA9\xF0\x9F\x98\x80";
+			match = match && flag != nullptr && flag->boolean && none != nullptr && none->type == JSONValue::Type::NUL;
+			match = match && nested != nullptr && nested->Member("empty") != nullptr && nested->Member("empty")->type == JSONValue::Type::ARRAY;
+		}
+		catch(...)
+		{
+			match = false;
+		}
+
+		// malformed input throws
+		std::string deep(100, '[');
+		for(auto const &t : { "", "{", "{\"a\" 1}", "[1,]", "\"abc", "\"\\x\"", "tru", "{} {}", "\"\n\"", deep.c_str() })
+		{
+			try
+			{
+				json_parse(t);
+				match = false;
+			}
+			catch(const std::exception &)
+			{
+				;
+			}
+		}
+
+		if(match)
+			std::cout << "success";
+		else
+		{
+			std::cout << "failure";
+			success = false;
+		}
+		std::cout << std::endl;
+	}
+
+	std::cout << "JSON (string)... " << std::flush;
+	{
+		auto s = json_string("a\"\\\n\x01" "b");
+		bool match = s == "\"a\\\"\\\\\\n\\u0001b\"" && json_parse(s).string == "a\"\\\n\x01" "b";
+
+		if(match)
+			std::cout << "success";
+		else
+		{
+			std::cout << "failure";
+			success = false;
+		}
+		std::cout << std::endl;
+	}
+
+	return success;
+}
+
+
+bool test_io_slot()
+{
+	std::cout << "I/O slot (limit: 2)... " << std::flush;
+
+	std::atomic<uint32_t> active(0);
+	std::atomic<uint32_t> active_max(0);
+	{
+		IOLimit io_limit(2);
+
+		std::vector<std::thread> threads;
+		for(uint32_t t = 0; t < 8; ++t)
+			threads.emplace_back([&active, &active_max]()
+			{
+				for(uint32_t i = 0; i < 100; ++i)
+				{
+					IOSlot io_slot;
+					uint32_t a = ++active;
+					for(uint32_t m = active_max; a > m && !active_max.compare_exchange_weak(m, a);)
+						;
+					std::this_thread::yield();
+					--active;
+				}
+			});
+		for(auto &t : threads)
+			t.join();
+	}
+
+	bool success = active_max <= 2 && !active;
+	if(success)
+		std::cout << "success";
+	else
+		std::cout << "failure";
+	std::cout << std::endl;
+
+	return success;
+}
+
+
+bool test_signal_cancel()
+{
+	std::cout << "signal cancel... " << std::flush;
+
+	bool success = true;
+
+	auto &signal = Signal::GetInstance();
+	signal.Engage();
+
+	bool cancel = false;
+	{
+		SignalCancel signal_cancel([&cancel]() { return cancel; });
+		success = success && !signal.Interrupt();
+		cancel = true;
+		success = success && signal.Interrupt();
+
+		// cancel is per calling thread
+		bool interrupt_other = true;
+		std::thread([&signal, &interrupt_other]() { interrupt_other = signal.Interrupt(); }).join();
+		success = success && !interrupt_other;
+
+		{
+			SignalCancel signal_cancel_empty(nullptr);
+			success = success && !signal.Interrupt();
+		}
+		success = success && signal.Interrupt();
+	}
+	success = success && !signal.Interrupt();
+
+	signal.Disengage();
+
+	// no process handler without Install()
+	struct sigaction sa;
+	success = success && sigaction(SIGINT, nullptr, &sa) == 0 && sa.sa_handler == SIG_DFL;
+
+	if(success)
+		std::cout << "success";
+	else
+		std::cout << "failure";
+	std::cout << std::endl;
+
+	return success;
+}
+
+
+bool test_signal_engage()
+{
+	std::cout << "signal engage nesting... " << std::flush;
+
+	bool success = true;
+
+	auto &signal = Signal::GetInstance();
+	signal.Install();
+
+	{
+		SignalEngage signal_engage;
+
+		// concurrent section ends first, outer section must stay engaged
+		std::thread([]() { SignalEngage signal_engage_other; }).join();
+
+		raise(SIGINT);
+		success = success && signal.Interrupt() && !signal.Terminate();
+	}
+	success = success && !signal.Interrupt() && !signal.Terminate();
+
+	::signal(SIGINT, SIG_DFL);
+
+	if(success)
+		std::cout << "success";
+	else
+		std::cout << "failure";
+	std::cout << std::endl;
+
+	return success;
+}
+
+
+bool test_dump_allocations()
+{
+	std::cout << "dump / refine steady state allocations... " << std::flush;
+
+	auto image_prefix = (std::filesystem::temp_directory_path() / fmt::format("redumper_tests_alloc_{}", (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count())).string();
+	std::fstream fs_scm(image_prefix + ".scram", std::fstream::out | std::fstream::in | std::fstream::binary | std::fstream::trunc);
+	std::fstream fs_state(image_prefix + ".state", std::fstream::out | std::fstream::in | std::fstream::binary | std::fstream::trunc);
+	std::fstream fs_sub(image_prefix + ".subcode", std::fstream::out | std::fstream::in | std::fstream::binary | std::fstream::trunc);
+
+	// PLEXTOR style read: C2 shifted into the next sector
+	uint32_t c2_shift = 295;
+	int32_t read_offset = 30;
+	auto unpacker = sector_unpack<DriveConfig::SectorOrder::DATA_C2_SUB, true>;
+
+	IntervalSet error_ranges;
+	error_ranges.Add({ 5000, 5100 });
+	IntervalSet::Cursor error_cursor(error_ranges);
+
+	// same per sector buffers as the dump / refine loop hoists out of it
+	std::vector<uint8_t> sector_buffer(CD_RAW_DATA_SIZE);
+	std::vector<uint8_t> read_scratch(CD_RAW_DATA_SIZE * 2);
+	std::vector<State> sector_state_file(CD_DATA_SIZE_SAMPLES);
+	std::vector<uint8_t> sector_data_file(CD_DATA_SIZE);
+	std::vector<uint8_t> sector_subcode_file(CD_SUBCODE_SIZE);
+	std::vector<State> sector_state(CD_DATA_SIZE_SAMPLES);
+	std::vector<uint8_t> sector_data(CD_DATA_SIZE);
+	std::vector<uint8_t> sector_subcode(CD_SUBCODE_SIZE);
+
+	uint32_t seed = 0x13579BDF;
+	auto sector_cycle = [&](int32_t lba, bool refine)
+	{
+		// drive response
+		for(auto &r : read_scratch)
+		{
+			seed = seed * 1103515245 + 12345;
+			r = (uint8_t)(seed >> 16);
+		}
+		unpacker(sector_buffer.data(), read_scratch.data(), c2_shift);
+
+		memcpy(sector_data.data(), sector_buffer.data(), CD_DATA_SIZE);
+		memcpy(sector_subcode.data(), sector_buffer.data() + CD_DATA_SIZE + CD_C2_SIZE, CD_SUBCODE_SIZE);
+		std::fill(sector_state.begin(), sector_state.end(), State::SUCCESS);
+		state_from_c2(sector_state, sector_buffer.data() + CD_DATA_SIZE);
+
+		ChannelQ Q;
+		subcode_extract_channel((uint8_t *)&Q, sector_subcode.data(), Subchannel::Q);
+
+		uint32_t lba_index = lba - LBA_START;
+		if(refine)
+		{
+			read_entry(fs_state, (uint8_t *)sector_state_file.data(), CD_DATA_SIZE_SAMPLES, lba_index, 1, read_offset, (uint8_t)State::ERROR_SKIP);
+			read_entry(fs_scm, sector_data_file.data(), CD_DATA_SIZE, lba_index, 1, read_offset * CD_SAMPLE_SIZE, 0);
+
+			auto merge = state_merge(sector_state.data(), (uint32_t *)sector_data.data(), sector_state_file.data(), (uint32_t *)sector_data_file.data(), CD_DATA_SIZE_SAMPLES);
+			if(merge.update)
+			{
+				write_entry(fs_scm, sector_data.data(), CD_DATA_SIZE, lba_index, 1, read_offset * CD_SAMPLE_SIZE);
+				write_entry(fs_state, (uint8_t *)sector_state.data(), CD_DATA_SIZE_SAMPLES, lba_index, 1, read_offset);
+			}
+
+			read_entry(fs_sub, sector_subcode_file.data(), CD_SUBCODE_SIZE, lba_index, 1, 0, 0);
+			if(error_cursor.Find(lba) == nullptr)
+				write_entry(fs_sub, sector_subcode.data(), CD_SUBCODE_SIZE, lba_index, 1, 0);
+		}
+		else
+		{
+			write_entry(fs_scm, sector_data.data(), CD_DATA_SIZE, lba_index, 1, read_offset * CD_SAMPLE_SIZE);
+			write_entry(fs_sub, sector_subcode.data(), CD_SUBCODE_SIZE, lba_index, 1, 0);
+			write_entry(fs_state, (uint8_t *)sector_state.data(), CD_DATA_SIZE_SAMPLES, lba_index, 1, read_offset);
+		}
+	};
+
+	// warm up: stream buffers and the first write of each file
+	sector_cycle(0, false);
+	sector_cycle(0, true);
+
+	uint64_t allocations = g_allocations;
+	for(int32_t lba = 1; lba < 10000; ++lba)
+		sector_cycle(lba, false);
+	for(int32_t lba = 1; lba < 10000; ++lba)
+		sector_cycle(lba, true);
+	allocations = g_allocations - allocations;
+
+	fs_scm.close();
+	fs_state.close();
+	fs_sub.close();
+	std::filesystem::remove(image_prefix + ".scram");
+	std::filesystem::remove(image_prefix + ".state");
+	std::filesystem::remove(image_prefix + ".subcode");
+
+	bool success = !allocations;
+	if(success)
+		std::cout << "success";
+	else
+		std::cout << fmt::format("failure (allocations: {})", allocations);
+	std::cout << std::endl;
+
+	return success;
+}
+
+
+
+
 int main(int argc, char *argv[])
 {
 	int success = 0;
@@ -178,6 +1255,36 @@ int main(int argc, char *argv[])
 	std::cout << std::endl;
 	success |= (int)!test_unscramble();
 	std::cout << std::endl;
+	success |= (int)!test_accuraterip();
+	std::cout << std::endl;
+	success |= (int)!test_interval_set();
+	std::cout << std::endl;
+	success |= (int)!test_sector_unpack();
+	std::cout << std::endl;
+	success |= (int)!test_sector_state();
+	std::cout << std::endl;
+	success |= (int)!test_simd();
+	std::cout << std::endl;
+	success |= (int)!test_pattern_scanner();
+	std::cout << std::endl;
+	success |= (int)!test_bounded_queue();
+	std::cout << std::endl;
+	success |= (int)!test_logger();
+	std::cout << std::endl;
+	success |= (int)!test_profile_probe();
+	std::cout << std::endl;
+	success |= (int)!test_image_generator();
+	std::cout << std::endl;
+	success |= (int)!test_json();
+	std::cout << std::endl;
+	success |= (int)!test_io_slot();
+	std::cout << std::endl;
+	success |= (int)!test_signal_cancel();
+	std::cout << std::endl;
+	success |= (int)!test_signal_engage();
+	std::cout << std::endl;
+	success |= (int)!test_dump_allocations();
+	std::cout << std::endl;
 
 	return success;
 }
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include "thread_pool.hh"
+
+
+
+namespace gpsxre
+{
+
+ThreadPool::ThreadPool(uint32_t threads_count)
+	: _stop(false)
+{
+	if(!threads_count)
+		threads_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for(uint32_t i = 0; i < threads_count; ++i)
+		_threads.emplace_back(&ThreadPool::Worker, this);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cv.notify_all();
+
+	for(auto &t : _threads)
+		t.join();
+}
+
+
+uint32_t ThreadPool::ThreadsCount() const
+{
+	return (uint32_t)_threads.size();
+}
+
+
+void ThreadPool::Worker()
+{
+	for(;;)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+
+			// drain the queue before exiting
+			if(_tasks.empty())
+				break;
+
+			task = std::move(_tasks.front());
+			_tasks.pop();
+		}
+
+		task();
+	}
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+
+namespace gpsxre
+{
+
+class ThreadPool
+{
+public:
+	// threads_count = 0 uses hardware concurrency
+	ThreadPool(uint32_t threads_count = 0);
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const &) = delete;
+	void operator=(ThreadPool const &) = delete;
+
+	template<typename F>
+	auto Enqueue(F f) -> std::future<decltype(f())>
+	{
+		auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+		auto future = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.emplace([task]() { (*task)(); });
+		}
+		_cv.notify_one();
+
+		return future;
+	}
+
+	uint32_t ThreadsCount() const;
+
+private:
+	std::vector<std::thread> _threads;
+	std::queue<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	bool _stop;
+
+	void Worker();
+};
+
+}
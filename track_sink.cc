@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <fmt/format.h>
+#include "cd.hh"
+#include "common.hh"
+#include "crc32.hh"
+#include "file_io.hh"
+#include "logger.hh"
+#include "track_sink.hh"
+
+
+
+namespace gpsxre
+{
+
+TrackSink::TrackSink(const std::filesystem::path &track_path, bool dry_run)
+	: _trackPath(track_path)
+	, _dryRun(dry_run)
+	, _size(0)
+	, _crc(crc32_seed())
+{
+	if(!_dryRun)
+	{
+		_fs.open(_trackPath, std::fstream::out | std::fstream::binary);
+		if(!_fs.is_open())
+			throw_line(fmt::format("unable to create file ({})", _trackPath.filename().string()));
+	}
+}
+
+
+TrackSink::~TrackSink()
+{
+	;
+}
+
+
+const std::filesystem::path &TrackSink::TrackPath() const
+{
+	return _trackPath;
+}
+
+
+void TrackSink::Write(const uint8_t *sector, const uint8_t *subcode)
+{
+	WriteSector(sector, subcode);
+}
+
+
+void TrackSink::Finalize(TrackEntry &track_entry)
+{
+	track_entry.filename = _trackPath.filename().string();
+	track_entry.size = _size;
+	track_entry.crc = crc32_final(_crc);
+	track_entry.md5 = _md5.Final();
+	track_entry.sha1 = _sha1.Final();
+
+	if(!_dryRun)
+		_fs.close();
+}
+
+
+void TrackSink::Output(const uint8_t *data, uint64_t size)
+{
+	_crc = crc32(data, size, _crc);
+	_md5.Update(data, size);
+	_sha1.Update(data, size);
+	_size += size;
+
+	if(!_dryRun)
+	{
+		IOSlot io_slot;
+		_fs.write((char *)data, size);
+		if(_fs.fail())
+			throw_line(fmt::format("write failed ({})", _trackPath.filename().string()));
+	}
+}
+
+
+BinSink::BinSink(const std::filesystem::path &track_path, bool dry_run)
+	: TrackSink(track_path, dry_run)
+{
+	;
+}
+
+
+void BinSink::WriteSector(const uint8_t *sector, const uint8_t *)
+{
+	Output(sector, CD_DATA_SIZE);
+}
+
+
+IsoSink::IsoSink(const std::filesystem::path &track_path, bool dry_run)
+	: TrackSink(track_path, dry_run)
+	, _blocksCount(0)
+	, _zeroWarning(true)
+{
+	;
+}
+
+
+void IsoSink::WriteSector(const uint8_t *sector, const uint8_t *)
+{
+	auto s = (const Sector *)sector;
+
+	if(s->header.mode == 1)
+		Output(s->mode1.user_data, FORM1_DATA_SIZE);
+	else if(s->header.mode == 2 && !(s->mode2.xa.sub_header.submode & (uint8_t)CDXAMode::FORM2))
+		Output(s->mode2.xa.form1.user_data, FORM1_DATA_SIZE);
+	// Mode2 Form2, Mode0 or damaged sectors don't have 2048 byte representation, keep block to LBA mapping intact
+	else
+	{
+		if(_zeroWarning)
+		{
+			LOG("warning: sector without 2048 byte user data, ISO block is zero filled (file: {}, block: {})", TrackPath().filename().string(), _blocksCount);
+			_zeroWarning = false;
+		}
+
+		uint8_t zero[FORM1_DATA_SIZE] = {};
+		Output(zero, sizeof(zero));
+	}
+
+	++_blocksCount;
+}
+
+
+WavSink::WavSink(const std::filesystem::path &track_path, bool dry_run, uint32_t sectors_count)
+	: TrackSink(track_path, dry_run)
+{
+	struct
+	{
+		char riff_id[4];
+		uint32_t riff_size;
+		char wave_id[4];
+		char fmt_id[4];
+		uint32_t fmt_size;
+		uint16_t format;
+		uint16_t channels;
+		uint32_t sample_rate;
+		uint32_t byte_rate;
+		uint16_t block_align;
+		uint16_t bits_per_sample;
+		char data_id[4];
+		uint32_t data_size;
+	} header = { {'R', 'I', 'F', 'F'}, 0, {'W', 'A', 'V', 'E'}, {'f', 'm', 't', ' '}, 16, 1, 2, 44100, 44100 * CD_SAMPLE_SIZE, CD_SAMPLE_SIZE, 16, {'d', 'a', 't', 'a'}, 0 };
+
+	header.data_size = sectors_count * CD_DATA_SIZE;
+	header.riff_size = header.data_size + sizeof(header) - 8;
+
+	Output((uint8_t *)&header, sizeof(header));
+}
+
+
+void WavSink::WriteSector(const uint8_t *sector, const uint8_t *)
+{
+	Output(sector, CD_DATA_SIZE);
+}
+
+
+SubSink::SubSink(const std::filesystem::path &track_path, bool dry_run)
+	: TrackSink(track_path, dry_run)
+{
+	;
+}
+
+
+void SubSink::WriteSector(const uint8_t *, const uint8_t *subcode)
+{
+	Output(subcode, CD_SUBCODE_SIZE);
+}
+
+
+std::vector<std::string> track_sink_formats(const std::string &split_output)
+{
+	// raw image is always generated as CUE-sheet refers to it
+	std::vector<std::string> formats{"bin"};
+
+	for(auto const &f : tokenize(split_output, ",", nullptr))
+	{
+		if(f != "iso" && f != "wav" && f != "sub" && f != "bin")
+			throw_line(fmt::format("unsupported split output format ({})", f));
+
+		if(std::find(formats.begin(), formats.end(), f) == formats.end())
+			formats.push_back(f);
+	}
+
+	return formats;
+}
+
+
+bool track_sink_applicable(const std::string &format, bool data_track)
+{
+	if(format == "iso")
+		return data_track;
+	else if(format == "wav")
+		return !data_track;
+
+	return true;
+}
+
+
+std::unique_ptr<TrackSink> track_sink_create(const std::string &format, const std::filesystem::path &track_path, bool dry_run, uint32_t sectors_count)
+{
+	std::unique_ptr<TrackSink> sink;
+
+	if(format == "bin")
+		sink = std::make_unique<BinSink>(track_path, dry_run);
+	else if(format == "iso")
+		sink = std::make_unique<IsoSink>(track_path, dry_run);
+	else if(format == "wav")
+		sink = std::make_unique<WavSink>(track_path, dry_run, sectors_count);
+	else if(format == "sub")
+		sink = std::make_unique<SubSink>(track_path, dry_run);
+	else
+		throw_line(fmt::format("unsupported split output format ({})", format));
+
+	return sink;
+}
+
+}
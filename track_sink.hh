@@ -0,0 +1,100 @@
+#pragma once
+
+
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "md5.hh"
+#include "sha1.hh"
+#include "split.hh"
+
+
+
+namespace gpsxre
+{
+
+// track output format, every sink of a track is fed from the same descrambled sector stream
+class TrackSink
+{
+public:
+	TrackSink(const std::filesystem::path &track_path, bool dry_run);
+	virtual ~TrackSink();
+
+	void Write(const uint8_t *sector, const uint8_t *subcode);
+	// fills filename, size and hashes of the output
+	void Finalize(TrackEntry &track_entry);
+
+protected:
+	const std::filesystem::path &TrackPath() const;
+	void Output(const uint8_t *data, uint64_t size);
+
+private:
+	std::filesystem::path _trackPath;
+	std::fstream _fs;
+	bool _dryRun;
+
+	uint64_t _size;
+	uint32_t _crc;
+	MD5 _md5;
+	SHA1 _sha1;
+
+	virtual void WriteSector(const uint8_t *sector, const uint8_t *subcode) = 0;
+};
+
+
+// raw 2352 byte sectors
+class BinSink : public TrackSink
+{
+public:
+	BinSink(const std::filesystem::path &track_path, bool dry_run);
+
+private:
+	virtual void WriteSector(const uint8_t *sector, const uint8_t *subcode);
+};
+
+
+// 2048 byte user data of Mode1 / Mode2 Form1 sectors, zero filled block for any other sector
+class IsoSink : public TrackSink
+{
+public:
+	IsoSink(const std::filesystem::path &track_path, bool dry_run);
+
+private:
+	uint32_t _blocksCount;
+	bool _zeroWarning;
+
+	virtual void WriteSector(const uint8_t *sector, const uint8_t *subcode);
+};
+
+
+// 44.1kHz 16-bit stereo PCM, header is written upfront as sectors count is known
+class WavSink : public TrackSink
+{
+public:
+	WavSink(const std::filesystem::path &track_path, bool dry_run, uint32_t sectors_count);
+
+private:
+	virtual void WriteSector(const uint8_t *sector, const uint8_t *subcode);
+};
+
+
+// 96 byte raw (multiplexed) subchannel
+class SubSink : public TrackSink
+{
+public:
+	SubSink(const std::filesystem::path &track_path, bool dry_run);
+
+private:
+	virtual void WriteSector(const uint8_t *sector, const uint8_t *subcode);
+};
+
+
+// formats supported: bin, iso, wav, sub
+std::vector<std::string> track_sink_formats(const std::string &split_output);
+bool track_sink_applicable(const std::string &format, bool data_track);
+std::unique_ptr<TrackSink> track_sink_create(const std::string &format, const std::filesystem::path &track_path, bool dry_run, uint32_t sectors_count);
+
+}